@@ -2,6 +2,16 @@
 
 #include "DAC.h"
 #include "frdm_bsp.h"
+#include "profile.h"
+
+#define STREAM_DMA_CH      0           // DMA channel 0 is paced by PIT0 (DMAMUX trigger mode)
+#define STREAM_PIT_CH      0
+#define DMAMUX_ALWAYS_ON   60          // Always enabled DMA request source
+#define DMA_SIZE_16BIT     2
+
+static uint16_t stream_buf[2][DAC_STREAM_BLOCK];  // Ping-pong sample blocks
+static volatile uint8_t stream_idx;                // Block being played
+static DAC_Refill stream_refill;                   // Sample source
 
 void DAC_Init(void)
 {
@@ -9,6 +19,8 @@ void DAC_Init(void)
 	SIM->SCGC6 |= SIM_SCGC6_DAC0_MASK;          // Dołączenie sygnału zegara do DAC0
 	DAC0->C1 |= DAC_C1_DACBFEN_MASK;						// Włączenie bufora 2x16 bit
 	DAC0->C0 |= (DAC_C0_DACEN_MASK | DAC_C0_DACTRGSEL_MASK);	// Włączenie DAC0, wyzwalanie programowe
+	SIM->SCGC6 |= (SIM_SCGC6_DMAMUX_MASK | SIM_SCGC6_PIT_MASK);	// Zegary dla strumienia DMA (DAC_Stream_Start)
+	SIM->SCGC7 |= SIM_SCGC7_DMA_MASK;
 }
 
 uint8_t DAC_Load_Trig(uint16_t load)
@@ -23,3 +35,61 @@ uint8_t DAC_Load_Trig(uint16_t load)
 	DAC0->C0 |= DAC_C0_DACSWTRG_MASK;		// Przełączenie na następną daną z bufora (przed chwilą załadowaną)
 	return (0);
 }
+
+static uint32_t bus_clock(void)
+{
+	return SystemCoreClock / (((SIM->CLKDIV1 & SIM_CLKDIV1_OUTDIV4_MASK) >> SIM_CLKDIV1_OUTDIV4_SHIFT) + 1);
+}
+
+static void stream_block(uint8_t idx)
+{
+	DMA0->DMA[STREAM_DMA_CH].SAR = HAL_ADDR(stream_buf[idx]);
+	DMA0->DMA[STREAM_DMA_CH].DSR_BCR = DMA_DSR_BCR_BCR(sizeof(stream_buf[idx]));
+}
+
+/* Koniec bloku DMA - start drugiej polowy bufora i wypelnienie zwolnionej */
+void DMA0_IRQHandler(void)
+{
+	PROF_ENTER(PROF_DMA0);
+	HAL_W1C(DMA0->DMA[STREAM_DMA_CH].DSR_BCR, DMA_DSR_BCR_DONE_MASK);	// Skasowanie DONE i bledow
+	stream_idx ^= 1;
+	stream_block(stream_idx);
+	stream_refill(stream_buf[stream_idx ^ 1], DAC_STREAM_BLOCK);
+	PROF_EXIT(PROF_DMA0);
+}
+
+void DAC_Stream_Start(uint32_t sample_rate_hz, DAC_Refill refill)
+{
+	stream_refill = refill;
+	stream_idx = 0;
+	refill(stream_buf[0], DAC_STREAM_BLOCK);
+	refill(stream_buf[1], DAC_STREAM_BLOCK);
+
+	DAC0->C1 &= ~DAC_C1_DACBFEN_MASK;						// Bez bufora - zapis DAT0 od razu na wyjscie
+
+	DMAMUX0->CHCFG[STREAM_DMA_CH] = 0;
+	HAL_W1C(DMA0->DMA[STREAM_DMA_CH].DSR_BCR, DMA_DSR_BCR_DONE_MASK);
+	DMA0->DMA[STREAM_DMA_CH].DAR = HAL_ADDR(&DAC0->DAT[0].DATL);
+	DMA0->DMA[STREAM_DMA_CH].DCR = DMA_DCR_EINT_MASK | DMA_DCR_ERQ_MASK | DMA_DCR_CS_MASK |	// Jedna probka na wyzwolenie
+	                               DMA_DCR_SINC_MASK | DMA_DCR_SSIZE(DMA_SIZE_16BIT) | DMA_DCR_DSIZE(DMA_SIZE_16BIT);
+	stream_block(0);
+	NVIC_SetPriority(DMA0_IRQn, 0);
+	NVIC_ClearPendingIRQ(DMA0_IRQn);
+	NVIC_EnableIRQ(DMA0_IRQn);
+	DMAMUX0->CHCFG[STREAM_DMA_CH] = DMAMUX_CHCFG_ENBL_MASK | DMAMUX_CHCFG_TRIG_MASK | DMAMUX_CHCFG_SOURCE(DMAMUX_ALWAYS_ON);
+
+	PIT->MCR &= ~PIT_MCR_MDIS_MASK;
+	PIT->CHANNEL[STREAM_PIT_CH].TCTRL = 0;
+	PIT->CHANNEL[STREAM_PIT_CH].LDVAL = bus_clock() / sample_rate_hz - 1;	// Takt probkowania
+	PIT->CHANNEL[STREAM_PIT_CH].TCTRL = PIT_TCTRL_TEN_MASK;
+}
+
+void DAC_Stream_Stop(void)
+{
+	PIT->CHANNEL[STREAM_PIT_CH].TCTRL = 0;
+	DMAMUX0->CHCFG[STREAM_DMA_CH] = 0;
+	DMA0->DMA[STREAM_DMA_CH].DCR = 0;
+	HAL_W1C(DMA0->DMA[STREAM_DMA_CH].DSR_BCR, DMA_DSR_BCR_DONE_MASK);
+	NVIC_DisableIRQ(DMA0_IRQn);
+	DAC0->C1 |= DAC_C1_DACBFEN_MASK;						// Powrot do trybu z buforem
+}
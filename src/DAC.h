@@ -1,4 +1,11 @@
-#include "MKL05Z4.h"
+#include "hal.h"
 
 void DAC_Init(void);
 uint8_t DAC_Load_Trig(uint16_t load);
+
+#define DAC_STREAM_BLOCK   64          // Samples per DMA block (half of the ping-pong buffer)
+
+typedef void (*DAC_Refill)(uint16_t* block, uint16_t len);
+
+void DAC_Stream_Start(uint32_t sample_rate_hz, DAC_Refill refill);
+void DAC_Stream_Stop(void);
@@ -6,17 +6,64 @@
  * 
  * This file implements the RCW-0001 ultrasonic sensor interface:
  * - Trigger pin initialization
- * - Measurement control
+ * - Hardware-timed pings: TPM0 CH0 output compare drives the trigger
+ * - Echo to ping matching and ranging statistics
+ * - Both-edge echo capture with overflow extension and adaptive
+ *   TPM1 prescaler (finest setting that covers the last echo)
+ * - Integer conversion of echo time to distance
  *-------------------------------------------------------------------------*/
 
 #include "RCW-0001.h"
 #include "TPM.h"
+#include "power.h"
 
 /*-------------------------------------------------------------------------
  * Constants
  *-------------------------------------------------------------------------*/
 #define TRIGGER_PIN          11          // PTB11 pin number
+#define TRIGGER_MUX_GPIO     1
+#define TRIGGER_MUX_TPM      2           // PTB11 - TPM0_CH0
+#define TRIGGER_CH           0           // TPM0 channel driving the trigger
 #define TRIGGER_PULSE_US     10          // Trigger pulse duration in microseconds
+#define WAIT_MAX_TICKS       0x8000      // Longest compare step (half a TPM0 wrap)
+#define SOON_TICKS           2           // CnV is loaded on the next count, matches one later
+#define ECHO_PIN             13          // PTB13 - TPM1_CH1
+#define ECHO_CH              1
+#define ECHO_HEADROOM_TICKS  0x8000      // Expected echo must fit in half a wrap
+#define PS_MAX               (RCW_PRESCALERS - 1)
+
+// TPM0 channel modes: output compare, set / clear output on match
+#define OC_SET   (TPM_CnSC_MSA_MASK | TPM_CnSC_ELSB_MASK | TPM_CnSC_ELSA_MASK | TPM_CnSC_CHIE_MASK)
+#define OC_CLEAR (TPM_CnSC_MSA_MASK | TPM_CnSC_ELSB_MASK | TPM_CnSC_CHIE_MASK)
+
+/*-------------------------------------------------------------------------
+ * Ping Generator States
+ *-------------------------------------------------------------------------*/
+#define PING_IDLE            0           // Stopped, trigger pin is GPIO low
+#define PING_RISE            1           // Rising edge scheduled
+#define PING_FALL            2           // Falling edge scheduled
+#define PING_WAIT            3           // Waiting out the echo window (pin low)
+#define SOUND_MM_PER_S       343000      // Speed of sound in air at 20 C
+
+/*-------------------------------------------------------------------------
+ * Static Variables
+ *-------------------------------------------------------------------------*/
+static uint32_t threshold_ticks[RCW_PRESCALERS];  // Echo ticks below threshold distance
+static uint32_t mm_per_tick_q24[RCW_PRESCALERS];  // Millimetres per tick, Q24
+
+static volatile uint8_t ping_state = PING_IDLE;
+static volatile uint8_t stop_req;                 // Stop after the current pulse
+static volatile uint8_t echo_pending;             // Current ping has no echo yet
+static uint16_t ping_edge;                        // TPM0 count of the last rising edge
+static uint32_t period_ticks;                     // Ping period [TPM0 ticks]
+static uint32_t wait_left;                        // Ticks until the next rising edge
+static uint16_t pulse_ticks;
+static RCW_Stats stats;
+
+static uint8_t echo_high;                         // Rising edge captured
+static uint16_t echo_rise;                        // TPM1 count at rising edge
+static uint16_t echo_wraps;                       // TPM1 overflows since rising edge
+static uint8_t echo_ps = RCW_PS_INIT;             // TPM1 prescaler in use
 
 /*-------------------------------------------------------------------------
  * Function: Init_Trigger_Pin
@@ -28,23 +75,351 @@ void Init_Trigger_Pin(void) {
     // Enable clock for Port B
     SIM->SCGC5 |= SIM_SCGC5_PORTB_MASK;
     
-    // Configure pin as GPIO
-    PORTB->PCR[TRIGGER_PIN] = PORT_PCR_MUX(1);
+    // Configure pin as GPIO, switched to TPM0_CH0 while ranging
+    PORTB->PCR[TRIGGER_PIN] = PORT_PCR_MUX(TRIGGER_MUX_GPIO);
     
     // Set pin as output and initialize to low state
     PTB->PDDR |= (1 << TRIGGER_PIN);
-    PTB->PCOR = (1 << TRIGGER_PIN);
+    HAL_GPIO_CLR(PTB, 1 << TRIGGER_PIN);
+}
+
+/*-------------------------------------------------------------------------
+ * Function: ranging_release
+ * Purpose: Let the CPU enter VLPS once the pings have stopped and no
+ *          echo is being measured (TPM0/TPM1 have no clock there)
+ * Parameters: None
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+static void ranging_release(void) {
+    if (ping_state == PING_IDLE && !echo_high) {
+        Power_Hold(POWER_HOLD_RANGING, 0);
+    }
+}
+
+/*-------------------------------------------------------------------------
+ * Function: ping_compare
+ * Purpose: Program the next trigger edge on TPM0 CH0
+ * Parameters:
+ * mode - OC_SET or OC_CLEAR
+ * at - TPM0 count of the match
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+static void ping_compare(uint32_t mode, uint16_t at) {
+    // Mode changes must be acknowledged by the TPM before the new mode is written
+    TPM0->CONTROLS[TRIGGER_CH].CnSC = 0;
+    while (TPM0->CONTROLS[TRIGGER_CH].CnSC & (TPM_CnSC_MSA_MASK | TPM_CnSC_ELSB_MASK)) HAL_POLL();
+    TPM0->CONTROLS[TRIGGER_CH].CnV = at;
+    TPM0->CONTROLS[TRIGGER_CH].CnSC = mode;
+}
+
+/*-------------------------------------------------------------------------
+ * Function: ping_compare_soon
+ * Purpose: Program the next trigger edge on TPM0 CH0 as soon as possible.
+ *          The count is read after the mode switch, with interrupts
+ *          masked, so the match cannot be passed before it is armed.
+ * Parameters: mode - OC_SET or OC_CLEAR
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+static void ping_compare_soon(uint32_t mode) {
+    uint32_t primask = __get_PRIMASK();
+
+    TPM0->CONTROLS[TRIGGER_CH].CnSC = 0;
+    while (TPM0->CONTROLS[TRIGGER_CH].CnSC & (TPM_CnSC_MSA_MASK | TPM_CnSC_ELSB_MASK)) HAL_POLL();
+    __disable_irq();
+    TPM0->CONTROLS[TRIGGER_CH].CnV = (uint16_t)(TPM0->CNT + SOON_TICKS);
+    TPM0->CONTROLS[TRIGGER_CH].CnSC = mode;
+    __set_PRIMASK(primask);
+}
+
+/*-------------------------------------------------------------------------
+ * Function: ping_wait
+ * Purpose: Schedule the next step of the low phase. Periods longer than
+ *          one TPM0 wrap are split into several clear-on-match steps,
+ *          which leave the already low pin unchanged.
+ * Parameters: from - TPM0 count the wait starts at
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+static void ping_wait(uint16_t from) {
+    if (wait_left > WAIT_MAX_TICKS) {
+        // Split evenly near the end so that no step is too short to hit
+        uint16_t step = (wait_left > 2 * WAIT_MAX_TICKS) ? WAIT_MAX_TICKS : wait_left / 2;
+        
+        wait_left -= step;
+        ping_state = PING_WAIT;
+        ping_compare(OC_CLEAR, from + step);
+    } else {
+        ping_state = PING_RISE;
+        ping_compare(OC_SET, from + wait_left);
+    }
+}
+
+/*-------------------------------------------------------------------------
+ * Function: ping_irq
+ * Purpose: TPM0 CH0 match - advance the ping generator
+ * Parameters: ch - channel (unused)
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+static void ping_irq(uint8_t ch) {
+    uint16_t at = TPM0->CONTROLS[TRIGGER_CH].CnV;
+    
+    (void)ch;
+    switch (ping_state) {
+    case PING_RISE:
+        // Trigger went high - a new ping is in flight
+        if (echo_pending) {
+            stats.missed++;                 // Previous ping got no echo
+        }
+        echo_pending = 1;
+        stats.pings++;
+        ping_edge = at;
+        ping_state = PING_FALL;
+        if ((uint16_t)(TPM0->CNT - at) >= pulse_ticks) {
+            ping_compare_soon(OC_CLEAR);    // Late interrupt - end pulse now
+        } else {
+            ping_compare(OC_CLEAR, at + pulse_ticks);
+        }
+        break;
+        
+    case PING_FALL:
+        if (stop_req) {
+            TPM0->CONTROLS[TRIGGER_CH].CnSC = 0;
+            PORTB->PCR[TRIGGER_PIN] = PORT_PCR_MUX(TRIGGER_MUX_GPIO);
+            ping_state = PING_IDLE;
+            ranging_release();
+            break;
+        }
+        wait_left = period_ticks;           // Next rise one period after this one
+        ping_wait(ping_edge);
+        break;
+        
+    case PING_WAIT:
+        ping_wait(at);
+        break;
+        
+    default:
+        break;
+    }
+}
+
+/*-------------------------------------------------------------------------
+ * Function: RCW_Ranging_Start
+ * Purpose: Start periodic pings generated by TPM0 CH0 (Init_TPM0 first)
+ * Parameters: period_ms - ping period, at least RCW_ECHO_WINDOW_MS
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+void RCW_Ranging_Start(uint16_t period_ms) {
+    if (ping_state != PING_IDLE) {
+        stop_req = 0;                       // Stop still pending - keep running
+        return;
+    }
+    if (period_ms < RCW_ECHO_WINDOW_MS) {
+        period_ms = RCW_ECHO_WINDOW_MS;     // Never ping into a running echo
+    }
+    period_ticks = TPM0_UsToTicks((uint32_t)period_ms * 1000);
+    pulse_ticks = TPM0_UsToTicks(TRIGGER_PULSE_US) + 1;  // Never shorter than 10 us
+    stop_req = 0;
+    echo_pending = 0;
+    
+    Power_Hold(POWER_HOLD_RANGING, 1);      // TPM0/TPM1 stop in VLPS
+    TPM0_SetHandler(TRIGGER_CH, ping_irq);
+    PORTB->PCR[TRIGGER_PIN] = PORT_PCR_MUX(TRIGGER_MUX_TPM);
+    wait_left = TPM0_UsToTicks(1000);       // First ping 1 ms from now
+    ping_wait(TPM0->CNT);
 }
 
 /*-------------------------------------------------------------------------
- * Function: Start_Measurement
- * Purpose: Generate trigger pulse to start distance measurement
+ * Function: RCW_Ranging_Stop
+ * Purpose: Stop pings, a pulse in progress is completed first
  * Parameters: None
  * Returns: None
  *-------------------------------------------------------------------------*/
-void Start_Measurement(void) {
-    // Generate trigger pulse
-    PTB->PSOR = (1 << TRIGGER_PIN);     // Set trigger pin high
-    TPM0_us(TRIGGER_PULSE_US);     			// Wait for specified duration
-    PTB->PCOR = (1 << TRIGGER_PIN);     // Set trigger pin low
+void RCW_Ranging_Stop(void) {
+    uint32_t primask = __get_PRIMASK();
+    
+    __disable_irq();
+    if (ping_state == PING_FALL) {
+        stop_req = 1;                       // Trigger is high - stop on falling edge
+    } else if (ping_state != PING_IDLE) {
+        TPM0->CONTROLS[TRIGGER_CH].CnSC = 0;
+        PORTB->PCR[TRIGGER_PIN] = PORT_PCR_MUX(TRIGGER_MUX_GPIO);
+        ping_state = PING_IDLE;
+    }
+    ranging_release();
+    echo_pending = 0;
+    __set_PRIMASK(primask);
+}
+
+/*-------------------------------------------------------------------------
+ * Function: RCW_EchoAccept
+ * Purpose: Match a captured echo to the ping in flight. Called from the
+ *          echo capture interrupt; stray echoes are counted and dropped.
+ * Parameters: None
+ * Returns: uint8_t - 1 if the echo belongs to the current ping
+ *-------------------------------------------------------------------------*/
+uint8_t RCW_EchoAccept(void) {
+    if (!echo_pending) {
+        stats.stray++;
+        return 0;
+    }
+    echo_pending = 0;
+    stats.echoes++;
+    return 1;
+}
+
+/*-------------------------------------------------------------------------
+ * Function: echo_prescaler
+ * Purpose: Pick the finest prescaler that fits an echo of this length
+ *          with headroom, so the next echo needs no overflow interrupts
+ *          and has the best resolution. Moves up or down in one step.
+ * Parameters: width - echo length in ticks at prescaler ps
+ *             ps - prescaler the echo was measured with
+ * Returns: uint8_t - prescaler for the next echo
+ *-------------------------------------------------------------------------*/
+static uint8_t echo_prescaler(uint32_t width, uint8_t ps) {
+    uint64_t fine = (uint64_t)width << ps;       // Echo length at prescaler 1
+    uint8_t next = 0;
+    
+    while (next < PS_MAX && (fine >> next) >= ECHO_HEADROOM_TICKS) {
+        next++;
+    }
+    return next;
+}
+
+/*-------------------------------------------------------------------------
+ * Function: RCW_CaptureIrq
+ * Purpose: Handle TPM1 interrupt in both-edge capture mode. Rising edge
+ *          stores a timestamp, falling edge computes the pulse width.
+ *          Overflows in between extend the width past 16 bits.
+ * Parameters:
+ * ticks - echo length, scaled to fit 16 bits
+ * ps - prescaler that ticks is expressed in
+ * Returns: uint8_t - 1 when a complete echo was measured
+ *-------------------------------------------------------------------------*/
+uint8_t RCW_CaptureIrq(uint16_t* ticks, uint8_t* ps) {
+    uint32_t status = TPM1->STATUS;
+    uint16_t cnv = TPM1->CONTROLS[ECHO_CH].CnV;
+    uint8_t done = 0;
+    
+    HAL_W1C(TPM1->STATUS, status & (TPM_STATUS_CH1F_MASK | TPM_STATUS_TOF_MASK));
+    
+    if (!(status & TPM_STATUS_CH1F_MASK)) {
+        // Overflow only - echo still high
+        if (echo_high && (status & TPM_STATUS_TOF_MASK)) {
+            echo_wraps++;
+        }
+        return 0;
+    }
+    
+    if (PTB->PDIR & (1 << ECHO_PIN)) {
+        // Rising edge. TOF is stale here (overflows are not enabled
+        // between echoes) and was just cleared, so a wrap after the edge
+        // is seen from the counter: if TOF is clear again, it came
+        // before the clear and is counted now, otherwise the overflow
+        // interrupt counts it.
+        echo_rise = cnv;
+        echo_wraps = (TPM1->CNT < cnv && !(TPM1->STATUS & TPM_STATUS_TOF_MASK)) ? 1 : 0;
+        echo_high = 1;
+        TPM1->SC |= TPM_SC_TOIE_MASK;
+    } else if (echo_high) {
+        // Falling edge. An overflow flagged together with an early
+        // capture happened before the edge.
+        uint32_t width;
+        uint8_t p = echo_ps;
+        
+        if ((status & TPM_STATUS_TOF_MASK) && cnv < 0x8000) {
+            echo_wraps++;
+        }
+        TPM1->SC &= ~(TPM_SC_TOIE_MASK | TPM_SC_TOF_MASK);
+        echo_high = 0;
+        ranging_release();
+        
+        width = ((uint32_t)echo_wraps << 16) + cnv - echo_rise;
+        
+        // Adapt prescaler for the next ping (echo is over, counter is idle)
+        echo_ps = echo_prescaler(width, p);
+        if (echo_ps != p) {
+            TPM1_SetPrescaler(echo_ps);
+        }
+        
+        // Report in the coarsest needed unit so that ticks fit 16 bits
+        while (width > 0xFFFF && p < PS_MAX) {
+            width >>= 1;
+            p++;
+        }
+        *ticks = (width > 0xFFFF) ? 0xFFFF : (uint16_t)width;
+        *ps = p;
+        done = 1;
+    }
+    return done;
+}
+
+/*-------------------------------------------------------------------------
+ * Function: RCW_GetStats
+ * Purpose: Get ranging statistics and the achieved measurement rate
+ * Parameters: out - statistics copy
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+void RCW_GetStats(RCW_Stats* out) {
+    uint32_t tick_hz = TPM0_UsToTicks(1000000);
+    uint32_t primask = __get_PRIMASK();
+    
+    __disable_irq();
+    *out = stats;
+    __set_PRIMASK(primask);
+    
+    // Valid measurements per second = ping rate * share of pings with an echo
+    out->rate_mhz = 0;
+    if (out->pings != 0 && period_ticks != 0) {
+        out->rate_mhz = (uint32_t)((uint64_t)tick_hz * 1000 * out->echoes /
+                                   ((uint64_t)period_ticks * out->pings));
+    }
+}
+
+/*-------------------------------------------------------------------------
+ * Function: RCW_InitScale
+ * Purpose: Precompute per-prescaler echo tick limits and mm scale factors
+ *          so that no floating point is needed per measurement
+ * Parameters:
+ * clock_hz - TPM1 counter clock before prescaler
+ * threshold_mm - alarm distance in millimetres
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+void RCW_InitScale(uint32_t clock_hz, uint16_t threshold_mm) {
+    for (uint8_t ps = 0; ps < RCW_PRESCALERS; ps++) {
+        // distance < threshold  <=>  ticks < threshold_mm * 2 * clock / (343000 * 2^ps)
+        // (round trip), rounded up so the integer compare matches the exact formula
+        uint64_t num = (uint64_t)threshold_mm * 2 * clock_hz;
+        uint64_t den = (uint64_t)SOUND_MM_PER_S << ps;
+        threshold_ticks[ps] = (uint32_t)((num + den - 1) / den);
+
+        // mm = ticks * 2^ps * 343000 / (2 * clock)
+        num = (uint64_t)SOUND_MM_PER_S << (ps + 24);
+        den = (uint64_t)2 * clock_hz;
+        mm_per_tick_q24[ps] = (uint32_t)((num + den / 2) / den);
+    }
+}
+
+/*-------------------------------------------------------------------------
+ * Function: RCW_InRange
+ * Purpose: Check if an echo is closer than the threshold distance
+ * Parameters:
+ * ticks - captured echo length (TPM1 CnV)
+ * ps - TPM1 prescaler setting (0..7)
+ * Returns: uint8_t - 1 if object is within threshold, 0 otherwise
+ *-------------------------------------------------------------------------*/
+uint8_t RCW_InRange(uint16_t ticks, uint8_t ps) {
+    return (ticks > 0 && ticks < threshold_ticks[ps]);
+}
+
+/*-------------------------------------------------------------------------
+ * Function: RCW_TicksToMm
+ * Purpose: Convert echo length to distance for reporting
+ * Parameters:
+ * ticks - captured echo length (TPM1 CnV)
+ * ps - TPM1 prescaler setting (0..7)
+ * Returns: uint16_t - distance in millimetres
+ *-------------------------------------------------------------------------*/
+uint16_t RCW_TicksToMm(uint16_t ticks, uint8_t ps) {
+    uint32_t mm = (uint32_t)(((uint64_t)ticks * mm_per_tick_q24[ps] + (1u << 23)) >> 24);
+    return (mm > 0xFFFF) ? 0xFFFF : (uint16_t)mm;
 }
\ No newline at end of file
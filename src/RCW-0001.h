@@ -1,4 +1,24 @@
-#include "MKL05Z4.h"
+#include "hal.h"
+
+#define RCW_PRESCALERS      8           // TPM1 prescaler settings 1..128
+#define RCW_ECHO_WINDOW_MS  60          // Minimum ping period (sensor echo window)
+#define RCW_DUAL_EDGE       1           // 1: both edges on PTB13, 0: EXTRG_IN + jumper
+#define RCW_PS_INIT         5           // First prescaler (32), covers the full range
+
+typedef struct {
+    uint32_t pings;                     // Trigger pulses generated
+    uint32_t echoes;                    // Echoes matched to a ping
+    uint32_t missed;                    // Pings without an echo before the next ping
+    uint32_t stray;                     // Echoes with no ping in flight (dropped)
+    uint32_t rate_mhz;                  // Achieved measurement rate [mHz]
+} RCW_Stats;
 
 void Init_Trigger_Pin(void);
-void Start_Measurement(void);
+void RCW_Ranging_Start(uint16_t period_ms);
+void RCW_Ranging_Stop(void);
+uint8_t RCW_EchoAccept(void);
+uint8_t RCW_CaptureIrq(uint16_t* ticks, uint8_t* ps);
+void RCW_GetStats(RCW_Stats* out);
+void RCW_InitScale(uint32_t clock_hz, uint16_t threshold_mm);
+uint8_t RCW_InRange(uint16_t ticks, uint8_t ps);
+uint16_t RCW_TicksToMm(uint16_t ticks, uint8_t ps);
\ No newline at end of file
@@ -6,19 +6,30 @@
  * 
  * This file implements Timer/PWM Module functionality:
  * - Input Capture and Output Compare initialization
- * - TPM0 initialization for microsecond delays
- * - Microsecond delay function
+ * - TPM1 free-running both-edge input capture (no jumper needed)
+ * - TPM0 free-running counter, extended by its overflow interrupt to a
+ *   32-bit microsecond clock readable from any context
+ * - TPM0 channel interrupt dispatch (output compare users)
+ * - Deadline checks and the microsecond delay built on that clock
  *-------------------------------------------------------------------------*/
 
 #include "TPM.h"
+#include "profile.h"
 
 /*-------------------------------------------------------------------------
  * Constants
  *-------------------------------------------------------------------------*/
-#define SYSTEM_CLOCK_HZ     41943040    // MCGFLLCLK frequency
-#define TPM0_CLOCK_HZ       48000000    // TPM0 clock frequency
-#define TICKS_PER_US        48          // Clock ticks per microsecond for TPM0
+#define TPM0_PS             6           // TPM0 prescaler 64 (~1.5 us tick, ~100 ms wrap)
 #define MAX_TIMER_COUNT     0xFFFF      // Maximum 16-bit timer value
+#define TPM0_IRQ_PRIORITY   1
+
+/*-------------------------------------------------------------------------
+ * Static Variables
+ *-------------------------------------------------------------------------*/
+static uint32_t ticks_per_us_q16;                   // TPM0 ticks per us, Q16
+static uint32_t us_per_tick_q16;                    // us per TPM0 tick, Q16
+static volatile uint64_t wrap_us_q16 = 0;           // Clock at the last counter wrap [us, Q16]
+static TPM_ChannelFn tpm0_handler[TPM0_CHANNELS];   // Channel compare handlers
 
 /*-------------------------------------------------------------------------
  * Function: InCap_OutComp_Init
@@ -32,15 +43,9 @@ void InCap_OutComp_Init(void)
     // Enable clock for Port B
     SIM->SCGC5 |= SIM_SCGC5_PORTB_MASK;
     
-    // Configure pin multiplexing
+    // Configure pin multiplexing (PTB11 trigger is set up by Init_Trigger_Pin)
     PORTB->PCR[0] |= PORT_PCR_MUX(2);      // PTB0 - EXTRG_IN
     PORTB->PCR[13] |= PORT_PCR_MUX(2);     // PTB13 - TPM1_CH1 (Input Capture)
-    PORTB->PCR[11] |= PORT_PCR_MUX(1);     // PTB11 - GPIO
-    PORTB->PCR[11] &= (~PORT_PCR_SRE_MASK);// Disable Slew Rate
-    
-    // Configure GPIO output
-    PTB->PDDR |= (1 << 11);                // Set PTB11 as output
-    PTB->PCOR = (1 << 11);                 // Clear PTB11
     
     // Enable TPM1 clock and configure clock source
     SIM->SCGC6 |= SIM_SCGC6_TPM1_MASK;
@@ -69,9 +74,61 @@ void InCap_OutComp_Init(void)
     TPM1->SC |= TPM_SC_CMOD(1);
 }
 
+/*-------------------------------------------------------------------------
+ * Function: InCap_DualEdge_Init
+ * Purpose: Free-running TPM1 capturing both edges of the echo on CH1
+ *          (PTB13). Pulse width is the difference of the two captures.
+ * Parameters: ps - initial prescaler setting (0..7)
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+void InCap_DualEdge_Init(uint8_t ps)
+{
+    // Enable clock for Port B, echo goes straight to PTB13
+    SIM->SCGC5 |= SIM_SCGC5_PORTB_MASK;
+    PORTB->PCR[13] = PORT_PCR_MUX(2);      // PTB13 - TPM1_CH1 (Input Capture)
+    
+    // Enable TPM1 clock and configure clock source
+    SIM->SCGC6 |= SIM_SCGC6_TPM1_MASK;
+    SIM->SOPT2 |= SIM_SOPT2_TPMSRC(1);     // Select MCGFLLCLK as clock source
+    
+    // Free-running up counter, no trigger start/stop
+    TPM1->SC = 0;
+    TPM1->CONF = 0;
+    TPM1->CNT = 0;
+    TPM1->MOD = MAX_TIMER_COUNT;
+    
+    // Channel 1 captures rising and falling edges
+    TPM1->CONTROLS[1].CnSC = (TPM_CnSC_ELSA_MASK | TPM_CnSC_ELSB_MASK | TPM_CnSC_CHIE_MASK);
+    HAL_W1C(TPM1->STATUS, TPM_STATUS_CH1F_MASK | TPM_STATUS_TOF_MASK);
+    NVIC_ClearPendingIRQ(TPM1_IRQn);
+    NVIC_EnableIRQ(TPM1_IRQn);
+    
+    // Start TPM1, overflow interrupt is enabled only while an echo is high
+    TPM1->SC = TPM_SC_PS(ps) | TPM_SC_CMOD(1);
+}
+
+/*-------------------------------------------------------------------------
+ * Function: TPM1_SetPrescaler
+ * Purpose: Change TPM1 prescaler, counter keeps its value
+ * Parameters: ps - prescaler setting (0..7)
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+void TPM1_SetPrescaler(uint8_t ps)
+{
+    uint32_t sc = TPM1->SC & ~(TPM_SC_PS_MASK | TPM_SC_CMOD_MASK | TPM_SC_TOF_MASK);
+    
+    // PS may only be written while the counter is disabled
+    TPM1->SC = sc;
+    while (TPM1->SC & TPM_SC_CMOD_MASK) HAL_POLL();
+    TPM1->SC = sc | TPM_SC_PS(ps) | TPM_SC_CMOD(1);
+}
+
 /*-------------------------------------------------------------------------
  * Function: Init_TPM0
- * Purpose: Initialize TPM0 for microsecond delay functionality
+ * Purpose: Start TPM0 as a free-running 16-bit counter. It is never
+ *          stopped or reloaded, so the microsecond clock and output
+ *          compare channels can share it. Call before any driver waits
+ *          on the clock.
  * Parameters: None
  * Returns: None
  *-------------------------------------------------------------------------*/
@@ -80,35 +137,139 @@ void Init_TPM0(void) {
     SIM->SCGC6 |= SIM_SCGC6_TPM0_MASK;
     SIM->SOPT2 |= SIM_SOPT2_TPMSRC(1);     // Select MCGFLLCLK
     
-    // Configure TPM0
+    // Tick rate from the actual core clock (TPM clock = MCGFLLCLK)
+    ticks_per_us_q16 = (uint32_t)(((uint64_t)SystemCoreClock << 16) / (1000000u << TPM0_PS));
+    us_per_tick_q16 = (uint32_t)(((uint64_t)1000000u << (16 + TPM0_PS)) / SystemCoreClock);
+    
+    // Configure TPM0, the overflow interrupt extends the clock
     TPM0->SC = 0;                          // Disable timer during configuration
-    TPM0->MOD = TICKS_PER_US - 1;          // Set modulo for 1µs period
-    TPM0->SC = TPM_SC_PS(0);               // Set prescaler to 1
+    TPM0->CNT = 0;
+    TPM0->MOD = MAX_TIMER_COUNT;           // Full 16-bit range
+    HAL_W1C(TPM0->STATUS, TPM_STATUS_TOF_MASK);
+    TPM0->SC = TPM_SC_PS(TPM0_PS) | TPM_SC_TOIE_MASK;
+    NVIC_SetPriority(TPM0_IRQn, TPM0_IRQ_PRIORITY);
+    NVIC_ClearPendingIRQ(TPM0_IRQn);
+    NVIC_EnableIRQ(TPM0_IRQn);
     TPM0->SC |= TPM_SC_CMOD(1);            // Start timer
 }
 
 /*-------------------------------------------------------------------------
- * Function: TPM0_Delay_us
- * Purpose: Generate precise microsecond delay
+ * Function: TPM0_UsToTicks
+ * Purpose: Convert microseconds to TPM0 ticks, rounded up
+ * Parameters: us - time in microseconds
+ * Returns: uint32_t - TPM0 ticks
+ *-------------------------------------------------------------------------*/
+uint32_t TPM0_UsToTicks(uint32_t us) {
+    return (uint32_t)(((uint64_t)us * ticks_per_us_q16 + 0xFFFF) >> 16);
+}
+
+/*-------------------------------------------------------------------------
+ * Function: TPM0_SetHandler
+ * Purpose: Register the compare handler of a TPM0 channel
+ * Parameters:
+ * ch - channel number
+ * fn - handler called from TPM0_IRQHandler, 0 to remove
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+void TPM0_SetHandler(uint8_t ch, TPM_ChannelFn fn) {
+    tpm0_handler[ch] = fn;
+}
+
+/*-------------------------------------------------------------------------
+ * Function: TPM0_IRQHandler
+ * Purpose: Count counter wraps, dispatch TPM0 channel flags to
+ *          registered handlers
+ * Parameters: None
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+void TPM0_IRQHandler(void) {
+    PROF_ENTER(PROF_TPM0);
+    uint32_t flags = TPM0->STATUS & ((1 << TPM0_CHANNELS) - 1);
+    
+    if (TPM0->STATUS & TPM_STATUS_TOF_MASK) {
+        HAL_W1C(TPM0->STATUS, TPM_STATUS_TOF_MASK);
+        wrap_us_q16 += (uint64_t)us_per_tick_q16 << 16;    // 65536 ticks
+    }
+    HAL_W1C(TPM0->STATUS, flags);          // Clear before handlers re-arm
+    for (uint8_t ch = 0; ch < TPM0_CHANNELS; ch++) {
+        if ((flags & (1 << ch)) && tpm0_handler[ch]) {
+            tpm0_handler[ch](ch);
+        }
+    }
+    PROF_EXIT(PROF_TPM0);
+}
+
+/*-------------------------------------------------------------------------
+ * Function: TPM0_Micros
+ * Purpose: Read the microsecond clock. Safe from any context; wraps
+ *          after ~71 minutes, so compare times by their difference.
+ * Parameters: None
+ * Returns: uint32_t - time since Init_TPM0 [us]
+ *-------------------------------------------------------------------------*/
+uint32_t TPM0_Micros(void) {
+    uint32_t primask = __get_PRIMASK();
+    uint64_t base;
+    uint32_t cnt;
+    
+    __disable_irq();
+    base = wrap_us_q16;
+    cnt = TPM0->CNT;
+    if (TPM0->STATUS & TPM_STATUS_TOF_MASK) {
+        // Wrapped, interrupt not yet taken: re-read the count past the wrap
+        cnt = TPM0->CNT;
+        base += (uint64_t)us_per_tick_q16 << 16;
+    }
+    __set_PRIMASK(primask);
+    
+    return (uint32_t)((base + (uint64_t)cnt * us_per_tick_q16) >> 16);
+}
+
+/*-------------------------------------------------------------------------
+ * Function: TPM0_Resume
+ * Purpose: Advance the clock by the time TPM0 was frozen in VLPS, so it
+ *          stays monotonic and close to real time across a stop
+ * Parameters: stopped_us - time spent in VLPS [us]
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+void TPM0_Resume(uint32_t stopped_us) {
+    uint32_t primask = __get_PRIMASK();
+    
+    __disable_irq();
+    wrap_us_q16 += (uint64_t)stopped_us << 16;
+    __set_PRIMASK(primask);
+}
+
+/*-------------------------------------------------------------------------
+ * Function: TPM0_Deadline
+ * Purpose: Deadline for a non-blocking timeout
+ * Parameters: us - timeout from now [us], below 2^31
+ * Returns: uint32_t - deadline for TPM0_Expired
+ *-------------------------------------------------------------------------*/
+uint32_t TPM0_Deadline(uint32_t us) {
+    return TPM0_Micros() + us;
+}
+
+/*-------------------------------------------------------------------------
+ * Function: TPM0_Expired
+ * Purpose: Check a deadline set with TPM0_Deadline
+ * Parameters: deadline - deadline [us]
+ * Returns: uint8_t - 1 once the deadline has passed
+ *-------------------------------------------------------------------------*/
+uint8_t TPM0_Expired(uint32_t deadline) {
+    return (int32_t)(TPM0_Micros() - deadline) >= 0;
+}
+
+/*-------------------------------------------------------------------------
+ * Function: TPM0_us
+ * Purpose: Busy-wait on the microsecond clock. Does not touch TPM0, so
+ *          it can be used from interrupts and main at the same time.
  * Parameters: 
  * us - Number of microseconds to delay
  * Returns: None
  *-------------------------------------------------------------------------*/
 void TPM0_us(uint32_t us) {
-    uint32_t target_ticks = us * TICKS_PER_US;
-    
-    while (target_ticks > 0) {
-        // Handle delays longer than maximum timer value
-        uint32_t current_delay = (target_ticks > MAX_TIMER_COUNT) ? 
-                                MAX_TIMER_COUNT : target_ticks;
-        
-        TPM0->CNT = 0;                     // Reset counter
-        TPM0->MOD = current_delay;         // Set target value
-        
-        // Wait for overflow
-        while (!(TPM0->SC & TPM_SC_TOF_MASK));
-        TPM0->SC |= TPM_SC_TOF_MASK;       // Clear overflow flag
-        
-        target_ticks -= current_delay;
-    }
+    // Start may be read up to one tick late
+    uint32_t deadline = TPM0_Deadline(us + ((us_per_tick_q16 + 0xFFFF) >> 16));
+    
+    while (!TPM0_Expired(deadline)) HAL_POLL();
 }
\ No newline at end of file
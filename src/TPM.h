@@ -1,5 +1,17 @@
-#include "MKL05Z4.h"
+#include "hal.h"
+
+#define TPM0_CHANNELS       6
+
+typedef void (*TPM_ChannelFn)(uint8_t ch);
 
 void InCap_OutComp_Init(void);
+void InCap_DualEdge_Init(uint8_t ps);
+void TPM1_SetPrescaler(uint8_t ps);
 void Init_TPM0(void);
-void TPM0_us(uint32_t us);
\ No newline at end of file
+void TPM0_us(uint32_t us);
+uint32_t TPM0_Micros(void);
+void TPM0_Resume(uint32_t stopped_us);
+uint32_t TPM0_Deadline(uint32_t us);
+uint8_t TPM0_Expired(uint32_t deadline);
+uint32_t TPM0_UsToTicks(uint32_t us);
+void TPM0_SetHandler(uint8_t ch, TPM_ChannelFn fn);
\ No newline at end of file
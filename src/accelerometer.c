@@ -8,6 +8,7 @@
  * - Interrupt configuration
  * - Accelerometer initialization and configuration
  * - MMA8451Q sensor setup
+ * - Background draining of samples (FIFO batches or single samples)
  *-------------------------------------------------------------------------*/
 
 #include "accelerometer.h"
@@ -22,13 +23,36 @@
 #define CTRL_REG4       0x2D        // Control register 4
 #define CTRL_REG5       0x2E        // Control register 5
 #define XYZ_DATA_CFG    0x0E        // Sensitivity configuration register
-#define STATUS_REG      0x00        // Status register
+#define STATUS_REG      0x00        // Status register (F_STATUS in FIFO mode)
+#define F_SETUP         0x09        // FIFO setup register
+
+#define ZYXDR_MASK      0x08        // STATUS: new X/Y/Z data ready
+#define F_OVF_MASK      0x80        // F_STATUS: FIFO overflow, oldest samples lost
+#define F_CNT_MASK      0x3F        // F_STATUS: samples stored in FIFO
+#define F_MODE_CIRCULAR 0x40        // F_SETUP: circular buffer mode
+#define INT_EN_DRDY     0x01        // CTRL_REG4: data ready interrupt
+#define INT_EN_FIFO     0x40        // CTRL_REG4: FIFO interrupt
+#define INT_CFG_INT2    0x00        // CTRL_REG5: bit clear routes the source to INT2
+
+#define BATCH_FREE      0           // Batch buffer states
+#define BATCH_BUSY      1
+#define BATCH_READY     2
 
 /*-------------------------------------------------------------------------
  * Static Variables
  *-------------------------------------------------------------------------*/
 static uint8_t sens = 0;            // Sensitivity setting
 
+static AccelBatch batch[2];         // Ping-pong sample buffers
+static I2C_Xfer batch_xfer[2];      // Transfer descriptor per buffer
+static uint8_t fill_idx = 0;        // Next buffer to fill (I2C IRQ context)
+static uint8_t read_idx = 0;        // Next buffer to hand out (main context)
+static volatile uint8_t drain_pending = 0;  // Drain requested while no buffer was free
+static volatile uint32_t lost = 0;  // FIFO overflow events
+static void (*batch_notify)(const AccelBatch* batch) = 0;  // Called when a batch is ready
+
+static void batch_done(I2C_Xfer* xfer);
+
 /*-------------------------------------------------------------------------
  * Function: InitInterrupt
  * Purpose: Initialize interrupt for accelerometer
@@ -65,8 +89,151 @@ void InitAccelerometer(void) {
     // Configuration sequence for MMA8451Q
     I2C_WriteReg(MMA8451Q_ADDR, CTRL_REG1, 0x00);    // Set to standby mode
     I2C_WriteReg(MMA8451Q_ADDR, XYZ_DATA_CFG, sens); // Set sensitivity
-    I2C_WriteReg(MMA8451Q_ADDR, CTRL_REG4, 0x01);    // Enable ZYXDR data ready interrupt
-    I2C_WriteReg(MMA8451Q_ADDR, CTRL_REG5, 0x02);    // Route ZYXDR interrupt to INT2 pin
+#if ACCEL_FIFO_MODE
+    I2C_WriteReg(MMA8451Q_ADDR, F_SETUP,             // Circular FIFO with watermark
+                 F_MODE_CIRCULAR | ACCEL_FIFO_WATERMARK);
+    I2C_WriteReg(MMA8451Q_ADDR, CTRL_REG4, INT_EN_FIFO); // Enable FIFO interrupt
+    I2C_WriteReg(MMA8451Q_ADDR, CTRL_REG5, INT_CFG_INT2); // Route FIFO interrupt to INT2 pin
+#else
+    I2C_WriteReg(MMA8451Q_ADDR, CTRL_REG4, INT_EN_DRDY); // Enable ZYXDR data ready interrupt
+    I2C_WriteReg(MMA8451Q_ADDR, CTRL_REG5, INT_CFG_INT2); // Route ZYXDR interrupt to INT2 pin
+#endif
     I2C_WriteReg(MMA8451Q_ADDR, CTRL_REG1, 0x01);    // Activate the device
     I2C_WriteReg(MMA8451Q_ADDR, STATUS_REG, 0x00);   // Clear ZYXDR flag
+
+    // Every batch is read by one auto-increment burst starting at STATUS.
+    // In FIFO mode the address wraps from OUT_Z_LSB back to OUT_X_MSB,
+    // so consecutive samples are streamed without a new transaction.
+    for (int i = 0; i < 2; i++) {
+        batch[i].state = BATCH_FREE;
+        batch_xfer[i].address = MMA8451Q_ADDR;
+        batch_xfer[i].reg = STATUS_REG;
+        batch_xfer[i].flags = I2C_XFER_REG | I2C_XFER_READ;
+        batch_xfer[i].size = sizeof(batch[i].raw);
+        batch_xfer[i].data = batch[i].raw;
+        batch_xfer[i].callback = batch_done;
+    }
+    fill_idx = 0;
+    read_idx = 0;
+    drain_pending = 0;
+}
+
+/*-------------------------------------------------------------------------
+ * Function: Accel_Drain
+ * Purpose: Start background read of one batch of samples, called on INT2
+ *          (also from interrupt context)
+ * Parameters: None
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+void Accel_Drain(void) {
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+    if (batch[fill_idx].state == BATCH_FREE) {
+        drain_pending = 0;
+        batch[fill_idx].state = BATCH_BUSY;
+        I2C_Submit(&batch_xfer[fill_idx]);
+    } else {
+        drain_pending = 1;          // Retried when a buffer is released
+    }
+    __set_PRIMASK(primask);
+}
+
+/*-------------------------------------------------------------------------
+ * Function: batch_done
+ * Purpose: I2C completion callback, validates the batch and keeps draining
+ *          while INT2 is still asserted
+ * Parameters: xfer - completed transfer
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+static void batch_done(I2C_Xfer* xfer) {
+    AccelBatch* b = &batch[xfer - batch_xfer];
+    uint8_t status = b->raw[0];
+
+    if (xfer->error) {
+        b->count = 0;
+    } else {
+#if ACCEL_FIFO_MODE
+        b->count = status & F_CNT_MASK;
+        if (b->count > ACCEL_FIFO_WATERMARK) {
+            b->count = ACCEL_FIFO_WATERMARK;
+        }
+        if (status & F_OVF_MASK) {
+            lost++;
+        }
+#else
+        b->count = (status & ZYXDR_MASK) ? 1 : 0;
+#endif
+    }
+    b->state = BATCH_READY;
+    fill_idx ^= 1;
+    if (batch_notify) {
+        batch_notify(b);
+    }
+
+    // INT2 is active low and level-held - more data than one batch means
+    // no new edge will come, so continue with the next burst right away
+    if (!(PTA->PDIR & (1 << INT2_PIN))) {
+        Accel_Drain();
+    }
+}
+
+/*-------------------------------------------------------------------------
+ * Function: Accel_GetBatch
+ * Purpose: Get oldest completed batch
+ * Parameters: None
+ * Returns: AccelBatch* - batch to process or 0 if none is ready
+ *-------------------------------------------------------------------------*/
+AccelBatch* Accel_GetBatch(void) {
+    if (batch[read_idx].state != BATCH_READY) {
+        return 0;
+    }
+    return &batch[read_idx];
+}
+
+/*-------------------------------------------------------------------------
+ * Function: Accel_ReleaseBatch
+ * Purpose: Return processed batch buffer to the driver
+ * Parameters: batch - buffer obtained from Accel_GetBatch
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+void Accel_ReleaseBatch(AccelBatch* b) {
+    b->state = BATCH_FREE;
+    read_idx ^= 1;
+    if (drain_pending) {
+        Accel_Drain();
+    }
+}
+
+/*-------------------------------------------------------------------------
+ * Function: Accel_LostSamples
+ * Purpose: Get number of FIFO overflows seen since initialization
+ * Parameters: None
+ * Returns: uint32_t - overflow count
+ *-------------------------------------------------------------------------*/
+uint32_t Accel_LostSamples(void) {
+    return lost;
+}
+
+/*-------------------------------------------------------------------------
+ * Function: Accel_SetNotify
+ * Purpose: Register function called (from interrupt) when a batch is ready
+ * Parameters: notify - callback or 0
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+void Accel_SetNotify(void (*notify)(const AccelBatch* batch)) {
+    batch_notify = notify;
+}
+
+/*-------------------------------------------------------------------------
+ * Function: Accel_Decode
+ * Purpose: Convert 6 output bytes (X/Y/Z MSB, LSB) to 14-bit counts
+ * Parameters: raw - pointer to OUT_X_MSB of the sample
+ *             sample - decoded sample
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+void Accel_Decode(const uint8_t* raw, AccelSample* sample) {
+    sample->x = (int16_t)((raw[0] << 8) | raw[1]) >> 2;
+    sample->y = (int16_t)((raw[2] << 8) | raw[3]) >> 2;
+    sample->z = (int16_t)((raw[4] << 8) | raw[5]) >> 2;
 }
\ No newline at end of file
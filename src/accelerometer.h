@@ -1,4 +1,37 @@
-#include "MKL05Z4.h"
+#include "hal.h"
+
+#ifndef ACCEL_FIFO_MODE
+#define ACCEL_FIFO_MODE         1       // 1 = FIFO watermark mode, 0 = per-sample ZYXDR mode
+#endif
+#define ACCEL_FIFO_WATERMARK    24      // Samples per FIFO interrupt (1..32)
+
+#if ACCEL_FIFO_MODE
+#define ACCEL_BATCH_MAX         ACCEL_FIFO_WATERMARK
+#else
+#define ACCEL_BATCH_MAX         1
+#endif
+
+#define ACCEL_COUNTS_PER_G      4096    // 14-bit data, +/-2 g range
+
+// Convert milli-g to raw counts at compile time, rounded down so that
+// |counts| > ACCEL_MG_TO_COUNTS(mg) matches |counts| / 4096.0 > mg / 1000.0
+#define ACCEL_MG_TO_COUNTS(mg)  ((int16_t)(((int32_t)(mg) * ACCEL_COUNTS_PER_G) / 1000))
+
+typedef struct {
+    int16_t x, y, z;                        // Raw 14-bit counts
+} AccelSample;
+
+typedef struct {
+    volatile uint8_t state;                 // Buffer ownership (driver private)
+    uint8_t count;                          // Number of valid samples in raw
+    uint8_t raw[1 + 6 * ACCEL_BATCH_MAX];   // STATUS/F_STATUS + X/Y/Z MSB/LSB per sample
+} AccelBatch;
 
 void InitInterrupt(void);
-void InitAccelerometer(void);
\ No newline at end of file
+void InitAccelerometer(void);
+void Accel_Drain(void);
+AccelBatch* Accel_GetBatch(void);
+void Accel_ReleaseBatch(AccelBatch* batch);
+uint32_t Accel_LostSamples(void);
+void Accel_SetNotify(void (*notify)(const AccelBatch* batch));
+void Accel_Decode(const uint8_t* raw, AccelSample* sample);
\ No newline at end of file
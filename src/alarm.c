@@ -5,65 +5,203 @@
  * File: alarm.c
  * 
  * This file implements the alarm siren functionality:
- * - Sine wave generation for audio output
- * - Frequency modulation for siren effect
+ * - Sine wave generation for audio output (DMA-fed DAC, no per-sample IRQ)
+ * - Quarter-wave sine table in flash, folded to a full period
+ * - 32-bit phase accumulator DDS with table-driven sweep profiles
+ *   (wail, yelp, hi-lo) and amplitude ramp, run inside the DMA refill
  * - Alarm control functions
  *-------------------------------------------------------------------------*/
 
 #include "alarm.h"
-#include <math.h>
 #include "DAC.h"
-#include "TPM.h"
 
 /*-------------------------------------------------------------------------
  * Constants
  *-------------------------------------------------------------------------*/
-#define DIV_CORE            8192        // Interrupt frequency 8192 Hz
-#define MASK_10BIT         0x03FF       // 10-bit mask for phase control
-#define MIN_MOD            16           // Minimum modulator value (~128 Hz)
-#define MAX_MOD            128          // Maximum modulator value (~1024 Hz)
-#define STEP_MOD           1            // Modulator increment step
-#define SINE_TABLE_SIZE    1024         // Size of sine wave lookup table
+#define SAMPLE_RATE_BITS   13
+#define SAMPLE_RATE        (1UL << SAMPLE_RATE_BITS)  // DAC sample rate 8192 Hz
+#define PHASE_INDEX_SHIFT  22           // Top 10 bits of the phase index the table
+#define HZ_TO_STEP(f)      ((uint32_t)(f) << (32 - SAMPLE_RATE_BITS))  // Phase step per sample
+#define MS_TO_SAMPLES(ms)  ((uint32_t)(ms) * SAMPLE_RATE / 1000)
+#define AMP_FULL           0x10000UL    // Amplitude 1.0 in Q16
+#define QUARTER_BITS       8            // 256 phase steps per quarter period
+#define QUARTER_SIZE       (1 << QUARTER_BITS)
+#define QUARTER_MASK       (QUARTER_SIZE - 1)
 #define DAC_OFFSET         0x0800       // DAC middle level offset
-#define SIN_ANGLE_RAD    0.0061359231515  // 2*PI/1024 for angle calculation
-#define SIN_AMPLITUDE     2047.0        // Amplitude of sine wave
 #define ALARM_LED_RED      8            // Red LED pin
 #define ALARM_LED_BLUE     10           // Blue LED pin
-#define US           1000         // How many us
 
 /*-------------------------------------------------------------------------
- * Global Variables
+ * Types
  *-------------------------------------------------------------------------*/
-volatile uint16_t Sinus[SINE_TABLE_SIZE];  // Sine wave lookup table
-volatile uint16_t faza = 0;                // Phase accumulator
-volatile uint16_t mod = MIN_MOD;           // Phase modulator
-volatile int8_t direction = 1;             // Modulation direction
-volatile int16_t time = 0;                 // Time counter
-volatile int8_t time_ok = 0;               // Time flag
+typedef struct {
+    uint16_t f_start;                   // Frequency at segment start [Hz]
+    uint16_t f_end;                     // Frequency at segment end [Hz]
+    uint16_t ms;                        // Segment length [ms]
+} sweep_seg_t;
+
+typedef struct {
+    const sweep_seg_t* seg;             // Segments, repeated in order
+    uint8_t count;
+    uint16_t ramp_ms;                   // Amplitude ramp at start, 0 = none
+} siren_profile_t;
 
 /*-------------------------------------------------------------------------
- * Function: SysTick_Handler
- * Author dr in. Mariusz Sokoowski
- * Purpose: Handle SysTick interrupt for DAC output
- * Parameters: None
+ * Sweep Profiles
+ *-------------------------------------------------------------------------*/
+static const sweep_seg_t wail_seg[] = {
+    { 400, 1200, 1500 }, { 1200, 400, 1500 }       // Slow linear up/down
+};
+static const sweep_seg_t yelp_seg[] = {
+    { 128, 1024, 112 }, { 1024, 128, 112 }         // Fast up/down (original sweep)
+};
+static const sweep_seg_t hilo_seg[] = {
+    { 960, 960, 400 }, { 770, 770, 400 }           // Two tones
+};
+
+static const siren_profile_t profiles[] = {
+    [SIREN_WAIL] = { wail_seg, 2, 20 },
+    [SIREN_YELP] = { yelp_seg, 2, 20 },
+    [SIREN_HILO] = { hilo_seg, 2, 20 },
+};
+
+/*-------------------------------------------------------------------------
+ * Synthesizer State (owned by the DMA interrupt while the siren runs)
+ *-------------------------------------------------------------------------*/
+static const siren_profile_t* profile = &profiles[SIREN_YELP];
+static volatile uint8_t profile_req = SIREN_YELP;  // Requested by alarm_set_profile
+static uint32_t phase;                  // Phase accumulator, 2^32 = one period
+static uint32_t step;                   // Phase step per sample (frequency)
+static int32_t step_delta;              // Step change per sample (sweep slope)
+static uint32_t seg_left;               // Samples left in current segment
+static uint8_t seg_idx;
+static uint32_t amp;                    // Amplitude, Q16
+static uint32_t amp_inc;                // Amplitude ramp per sample, Q16
+
+/*-------------------------------------------------------------------------
+ * Quarter-Wave Sine Table (flash)
+ * Entry j = (int)(sin(j * 2*PI/1024) * 2047), j = 0..256. The extra entry
+ * holds the peak so that the second quarter folds without a special case.
+ *-------------------------------------------------------------------------*/
+static const int16_t Sinus_Q[QUARTER_SIZE + 1] = {
+        0,    12,    25,    37,    50,    62,    75,    87,
+      100,   112,   125,   138,   150,   163,   175,   188,
+      200,   213,   225,   238,   250,   263,   275,   287,
+      300,   312,   325,   337,   349,   362,   374,   387,
+      399,   411,   423,   436,   448,   460,   472,   485,
+      497,   509,   521,   533,   545,   558,   570,   582,
+      594,   606,   618,   630,   642,   654,   665,   677,
+      689,   701,   713,   724,   736,   748,   760,   771,
+      783,   794,   806,   818,   829,   840,   852,   863,
+      875,   886,   897,   909,   920,   931,   942,   953,
+      964,   976,   987,   998,  1008,  1019,  1030,  1041,
+     1052,  1063,  1073,  1084,  1095,  1105,  1116,  1126,
+     1137,  1147,  1158,  1168,  1178,  1188,  1199,  1209,
+     1219,  1229,  1239,  1249,  1259,  1269,  1279,  1288,
+     1298,  1308,  1317,  1327,  1337,  1346,  1355,  1365,
+     1374,  1383,  1393,  1402,  1411,  1420,  1429,  1438,
+     1447,  1456,  1465,  1473,  1482,  1491,  1499,  1508,
+     1516,  1525,  1533,  1541,  1550,  1558,  1566,  1574,
+     1582,  1590,  1598,  1605,  1613,  1621,  1629,  1636,
+     1644,  1651,  1659,  1666,  1673,  1680,  1687,  1695,
+     1702,  1708,  1715,  1722,  1729,  1736,  1742,  1749,
+     1755,  1762,  1768,  1774,  1781,  1787,  1793,  1799,
+     1805,  1811,  1816,  1822,  1828,  1834,  1839,  1845,
+     1850,  1855,  1861,  1866,  1871,  1876,  1881,  1886,
+     1891,  1895,  1900,  1905,  1909,  1914,  1918,  1923,
+     1927,  1931,  1935,  1939,  1943,  1947,  1951,  1955,
+     1958,  1962,  1966,  1969,  1972,  1976,  1979,  1982,
+     1985,  1988,  1991,  1994,  1997,  1999,  2002,  2005,
+     2007,  2010,  2012,  2014,  2016,  2018,  2021,  2022,
+     2024,  2026,  2028,  2030,  2031,  2033,  2034,  2035,
+     2037,  2038,  2039,  2040,  2041,  2042,  2043,  2043,
+     2044,  2045,  2045,  2046,  2046,  2046,  2046,  2046,
+     2047
+};
+
+/*-------------------------------------------------------------------------
+ * Function: sine_lookup
+ * Purpose: Full-period sine from the quarter table by symmetry
+ * Parameters: phase - 10-bit phase (1024 steps per period)
+ * Returns: int16_t - sample, -2047..2047
+ *-------------------------------------------------------------------------*/
+static inline int16_t sine_lookup(uint16_t phase)
+{
+    uint16_t j = phase & QUARTER_MASK;
+    int16_t v;
+
+    if (phase & QUARTER_SIZE) {
+        j = QUARTER_SIZE - j;               // 2nd/4th quarter: mirror in time
+    }
+    v = Sinus_Q[j];
+    return (phase & (2 * QUARTER_SIZE)) ? -v : v;  // 2nd half: negate
+}
+
+/*-------------------------------------------------------------------------
+ * Function: alarm_sine
+ * Purpose: Sine sample as the synthesizer reads it (host checks)
+ * Parameters: phase - 10-bit phase (1024 steps per period)
+ * Returns: int16_t - sample, -2047..2047
+ *-------------------------------------------------------------------------*/
+int16_t alarm_sine(uint16_t phase)
+{
+    return sine_lookup(phase & (4 * QUARTER_SIZE - 1));
+}
+
+/*-------------------------------------------------------------------------
+ * Function: seg_begin
+ * Purpose: Start a sweep segment, the slope is computed once per segment
+ * Parameters: idx - segment index in the current profile
  * Returns: None
  *-------------------------------------------------------------------------*/
-void SysTick_Handler(void)
+static void seg_begin(uint8_t idx)
 {
-    // Calculate DAC value with offset
-    uint16_t dac_value = Sinus[faza] + DAC_OFFSET;
-    
-    // Load value to DAC
-    DAC_Load_Trig(dac_value);
-    
-    // Update and wrap phase
-    faza += mod;
-    faza &= MASK_10BIT;
+    const sweep_seg_t* s = &profile->seg[idx];
+
+    seg_idx = idx;
+    seg_left = MS_TO_SAMPLES(s->ms);
+    step = HZ_TO_STEP(s->f_start);
+    step_delta = (int32_t)(HZ_TO_STEP(s->f_end) - step) / (int32_t)seg_left;
+}
+
+/*-------------------------------------------------------------------------
+ * Function: alarm_refill
+ * Purpose: Synthesize one block of DAC samples, called from the DMA
+ *          interrupt once per DAC_STREAM_BLOCK samples
+ * Parameters:
+ * block - samples to fill
+ * len - number of samples
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+static void alarm_refill(uint16_t* block, uint16_t len)
+{
+    if (profile != &profiles[profile_req]) {
+        profile = &profiles[profile_req];   // Profile change takes effect on a block
+        seg_begin(0);
+    }
+
+    for (uint16_t i = 0; i < len; i++) {
+        int32_t v = sine_lookup(phase >> PHASE_INDEX_SHIFT);
+
+        block[i] = DAC_OFFSET + ((v * (int32_t)(amp >> 8)) >> 8);
+        phase += step;
+        step += step_delta;
+
+        if (amp < AMP_FULL) {
+            amp += amp_inc;
+            if (amp > AMP_FULL) {
+                amp = AMP_FULL;
+            }
+        }
+        if (--seg_left == 0) {
+            seg_begin(seg_idx + 1 < profile->count ? seg_idx + 1 : 0);
+        }
+    }
 }
 
 /*-------------------------------------------------------------------------
  * Function: alarm_enable
- * Purpose: Enable alarm siren with frequency modulation
+ * Purpose: Enable alarm siren
  * Parameters: None
  * Returns: None
  *-------------------------------------------------------------------------*/
@@ -73,39 +211,43 @@ void alarm_enable(void)
 		PTB->PDOR |= (1 << ALARM_LED_BLUE);    // Turn off blue LED
     PTB->PDOR &= ~(1 << ALARM_LED_RED);    // Turn on red LED
     
-    // Start SysTick for DAC updates
-    SysTick_Config(SystemCoreClock / DIV_CORE);
-    
-    // Update frequency modulation
-    mod += direction * STEP_MOD;
-    if (mod >= MAX_MOD || mod <= MIN_MOD) {
-        direction = -direction;             // Reverse modulation direction
+    // Restart the profile from its first segment, ramping the amplitude up
+    profile = &profiles[profile_req];
+    phase = 0;
+    seg_begin(0);
+    if (profile->ramp_ms != 0) {
+        amp = 0;
+        amp_inc = AMP_FULL / MS_TO_SAMPLES(profile->ramp_ms);
+    } else {
+        amp = AMP_FULL;
     }
-    
-    TPM0_us(US);
+
+    // Start DMA stream to the DAC, the sweep runs in the refill interrupt
+    DAC_Stream_Start(SAMPLE_RATE, alarm_refill);
 }
 
 /*-------------------------------------------------------------------------
- * Function: alarm_disable
- * Purpose: Disable alarm siren
- * Parameters: None
+ * Function: alarm_set_profile
+ * Purpose: Select siren sweep profile, applied from the next sample block
+ * Parameters: p - SIREN_WAIL, SIREN_YELP or SIREN_HILO
  * Returns: None
  *-------------------------------------------------------------------------*/
-void alarm_disable(void)
+void alarm_set_profile(uint8_t p)
 {
-    PTB->PDOR |= (1 << ALARM_LED_RED);     // Turn off red LED
-    SysTick_Config(1);                      // Stop SysTick
+    if (p < sizeof(profiles) / sizeof(profiles[0])) {
+        profile_req = p;
+    }
 }
 
 /*-------------------------------------------------------------------------
- * Function: sin_init
- * Purpose: Initialize sine wave lookup table
+ * Function: alarm_disable
+ * Purpose: Disable alarm siren
  * Parameters: None
  * Returns: None
  *-------------------------------------------------------------------------*/
-void sin_init(void)
+void alarm_disable(void)
 {
-    for (uint16_t i = 0; i < SINE_TABLE_SIZE; i++) {
-        Sinus[i] = (sin((double)i * SIN_ANGLE_RAD) * SIN_AMPLITUDE);
-    }
-}
\ No newline at end of file
+    PTB->PDOR |= (1 << ALARM_LED_RED);     // Turn off red LED
+    DAC_Stream_Stop();                      // Stop DMA stream
+    DAC_Load_Trig(DAC_OFFSET);              // Park output at mid level
+}
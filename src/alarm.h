@@ -1,6 +1,10 @@
-#include "MKL05Z4.h"
+#include "hal.h"
+
+#define SIREN_WAIL  0                   // Slow linear sweep
+#define SIREN_YELP  1                   // Fast sweep (default)
+#define SIREN_HILO  2                   // Two alternating tones
 
 void alarm_enable(void);
 void alarm_disable(void);
-void sin_init(void);
-void SysTick_Delay(void);
\ No newline at end of file
+void alarm_set_profile(uint8_t p);
+int16_t alarm_sine(uint16_t phase);
\ No newline at end of file
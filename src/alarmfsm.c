@@ -0,0 +1,200 @@
+/*-------------------------------------------------------------------------
+ * Technika Mikroprocesorowa 2 - Project
+ * Project: Security Alarm System
+ * File: alarmfsm.c
+ *
+ * This file implements the alarm state machine:
+ * - States: disarmed, exit delay, armed, entry delay, alarm, admin
+ * - Events from the keypad codes, the sensors and the delay timer; one
+ *   table lookup per event gives the next state, the delay timer
+ *   operation and the event log record to write
+ * - Outputs (ranging, siren, LEDs) depend on the state only and are
+ *   applied by the caller when notified of a state change
+ * - Exit, entry and admin delays run on one software timer, nothing
+ *   waits or polls
+ *-------------------------------------------------------------------------*/
+
+#include "alarmfsm.h"
+#include "timer.h"
+#include "sched.h"
+#include "eventlog.h"
+
+/*-------------------------------------------------------------------------
+ * Constants
+ *-------------------------------------------------------------------------*/
+// Delay timer operations
+#define TM_KEEP             0
+#define TM_STOP             1
+#define TM_EXIT             2
+#define TM_ENTRY            3
+#define TM_ADMIN            4
+
+// Table entry: next state, timer operation, LOG_SRC_xxx or 0
+#define T(next, timer, log) { (next), (timer), (log) }
+#define IGNORE(state)       T(state, TM_KEEP, 0)
+
+/*-------------------------------------------------------------------------
+ * Types
+ *-------------------------------------------------------------------------*/
+typedef struct {
+    uint8_t next;
+    uint8_t timer;
+    uint8_t log;
+} Fsm_Transition;
+
+/*-------------------------------------------------------------------------
+ * Transition Table
+ *-------------------------------------------------------------------------*/
+static const Fsm_Transition fsm_table[FSM_STATES][FSM_EVENTS] = {
+    // CODE, DURESS, ARM, ADMIN, NEW_CODE, TRIGGER, TIMEOUT
+    [FSM_DISARMED] = {
+        T(FSM_EXIT_DELAY, TM_EXIT, LOG_SRC_ARM),
+        T(FSM_EXIT_DELAY, TM_EXIT, LOG_SRC_ARM),
+        T(FSM_EXIT_DELAY, TM_EXIT, LOG_SRC_ARM),
+        T(FSM_ADMIN, TM_ADMIN, 0),
+        IGNORE(FSM_DISARMED),
+        IGNORE(FSM_DISARMED),
+        IGNORE(FSM_DISARMED),
+    },
+    [FSM_EXIT_DELAY] = {
+        T(FSM_DISARMED, TM_STOP, LOG_SRC_DISARM),
+        T(FSM_DISARMED, TM_STOP, LOG_SRC_DURESS),
+        IGNORE(FSM_EXIT_DELAY),
+        T(FSM_ADMIN, TM_ADMIN, LOG_SRC_DISARM),  // Admin code disarms too
+        IGNORE(FSM_EXIT_DELAY),
+        IGNORE(FSM_EXIT_DELAY),             // Owner still leaving
+        T(FSM_ARMED, TM_KEEP, 0),
+    },
+    [FSM_ARMED] = {
+        T(FSM_DISARMED, TM_KEEP, LOG_SRC_DISARM),
+        T(FSM_DISARMED, TM_KEEP, LOG_SRC_DURESS),
+        IGNORE(FSM_ARMED),
+        T(FSM_ADMIN, TM_ADMIN, LOG_SRC_DISARM),
+        IGNORE(FSM_ARMED),
+        T(FSM_ENTRY_DELAY, TM_ENTRY, 0),    // Detection logged by the caller
+        IGNORE(FSM_ARMED),
+    },
+    [FSM_ENTRY_DELAY] = {
+        T(FSM_DISARMED, TM_STOP, LOG_SRC_DISARM),
+        T(FSM_DISARMED, TM_STOP, LOG_SRC_DURESS),
+        IGNORE(FSM_ENTRY_DELAY),
+        T(FSM_ADMIN, TM_ADMIN, LOG_SRC_DISARM),
+        IGNORE(FSM_ENTRY_DELAY),
+        IGNORE(FSM_ENTRY_DELAY),
+        T(FSM_ALARM, TM_KEEP, 0),
+    },
+    [FSM_ALARM] = {
+        T(FSM_DISARMED, TM_KEEP, LOG_SRC_DISARM),
+        T(FSM_DISARMED, TM_KEEP, LOG_SRC_DURESS),
+        IGNORE(FSM_ALARM),
+        T(FSM_ADMIN, TM_ADMIN, LOG_SRC_DISARM),
+        IGNORE(FSM_ALARM),
+        IGNORE(FSM_ALARM),
+        IGNORE(FSM_ALARM),
+    },
+    [FSM_ADMIN] = {
+        IGNORE(FSM_ADMIN),                  // Codes typed here are new codes
+        IGNORE(FSM_ADMIN),
+        IGNORE(FSM_ADMIN),
+        IGNORE(FSM_ADMIN),
+        T(FSM_DISARMED, TM_STOP, LOG_SRC_CODE),
+        IGNORE(FSM_ADMIN),
+        T(FSM_DISARMED, TM_KEEP, 0),
+    },
+};
+
+static const uint8_t fsm_outputs[FSM_STATES] = {
+    [FSM_DISARMED]    = 0,
+    [FSM_EXIT_DELAY]  = FSM_OUT_RANGING | FSM_OUT_ARMED_LED,
+    [FSM_ARMED]       = FSM_OUT_RANGING | FSM_OUT_ARMED_LED,
+    [FSM_ENTRY_DELAY] = FSM_OUT_RANGING | FSM_OUT_ARMED_LED,
+    [FSM_ALARM]       = FSM_OUT_RANGING | FSM_OUT_SIREN,
+    [FSM_ADMIN]       = FSM_OUT_ADMIN_LED,
+};
+
+static const uint16_t fsm_delay_ms[] = {
+    [TM_EXIT]  = EXIT_DELAY_MS,
+    [TM_ENTRY] = ENTRY_DELAY_MS,
+    [TM_ADMIN] = ADMIN_TIMEOUT_MS,
+};
+
+/*-------------------------------------------------------------------------
+ * Static Variables
+ *-------------------------------------------------------------------------*/
+static uint8_t fsm_state = FSM_DISARMED;
+static uint16_t delay_timer = TIMER_NONE;
+static void (*state_notify)(void) = 0;
+
+/*-------------------------------------------------------------------------
+ * Function: delay_expired
+ * Purpose: Delay timer callback
+ * Parameters: id - timer
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+static void delay_expired(uint16_t id) {
+    (void)id;
+    AlarmFsm_Event(FSM_EV_TIMEOUT);
+}
+
+/*-------------------------------------------------------------------------
+ * Function: AlarmFsm_Init
+ * Purpose: Set the start state, no delay running (Timer_Init first)
+ * Parameters:
+ * state - FSM_xxx, FSM_ARMED at power-up
+ * notify - called after every state change, 0 for none
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+void AlarmFsm_Init(uint8_t state, void (*notify)(void)) {
+    if (delay_timer == TIMER_NONE) {
+        delay_timer = Timer_Create(delay_expired);
+    }
+    Timer_Stop(delay_timer);
+    fsm_state = state;
+    state_notify = notify;
+}
+
+/*-------------------------------------------------------------------------
+ * Function: AlarmFsm_Event
+ * Purpose: Take one transition, log it and start or stop the delay
+ * Parameters: ev - FSM_EV_xxx
+ * Returns: uint8_t - new state
+ *-------------------------------------------------------------------------*/
+uint8_t AlarmFsm_Event(uint8_t ev) {
+    const Fsm_Transition* t = &fsm_table[fsm_state][ev];
+
+    if (t->timer == TM_STOP) {
+        Timer_Stop(delay_timer);
+    } else if (t->timer != TM_KEEP) {
+        Timer_Start(delay_timer, fsm_delay_ms[t->timer]);
+    }
+    if (t->log) {
+        Log_Put(t->log, t->log == LOG_SRC_ARM, 0, Sched_Millis());
+    }
+    if (t->next != fsm_state) {
+        fsm_state = t->next;
+        if (state_notify) {
+            state_notify();
+        }
+    }
+    return fsm_state;
+}
+
+/*-------------------------------------------------------------------------
+ * Function: AlarmFsm_State
+ * Purpose: Get the current state
+ * Parameters: None
+ * Returns: uint8_t - FSM_xxx
+ *-------------------------------------------------------------------------*/
+uint8_t AlarmFsm_State(void) {
+    return fsm_state;
+}
+
+/*-------------------------------------------------------------------------
+ * Function: AlarmFsm_Outputs
+ * Purpose: Get the outputs of the current state
+ * Parameters: None
+ * Returns: uint8_t - FSM_OUT_xxx bits
+ *-------------------------------------------------------------------------*/
+uint8_t AlarmFsm_Outputs(void) {
+    return fsm_outputs[fsm_state];
+}
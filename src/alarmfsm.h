@@ -0,0 +1,40 @@
+#ifndef ALARMFSM_H
+#define ALARMFSM_H
+
+#include "hal.h"
+
+#define EXIT_DELAY_MS       10000       // Arming to armed, leave the area
+#define ENTRY_DELAY_MS      5000        // Detection to siren, time to disarm
+#define ADMIN_TIMEOUT_MS    30000       // Admin mode left without a new code
+
+// States
+#define FSM_DISARMED        0
+#define FSM_EXIT_DELAY      1
+#define FSM_ARMED           2
+#define FSM_ENTRY_DELAY     3
+#define FSM_ALARM           4
+#define FSM_ADMIN           5
+#define FSM_STATES          6
+
+// Events
+#define FSM_EV_CODE         0           // User code: <code>#
+#define FSM_EV_DURESS       1           // Duress code: <code>#
+#define FSM_EV_ARM          2           // User or duress code: #<code>#
+#define FSM_EV_ADMIN        3           // Admin or installer code: <code>#
+#define FSM_EV_NEW_CODE     4           // User code replaced in admin mode
+#define FSM_EV_TRIGGER      5           // Sensor confirmed a detection
+#define FSM_EV_TIMEOUT      6           // Delay timer expired
+#define FSM_EVENTS          7
+
+// Outputs of each state (AlarmFsm_Outputs)
+#define FSM_OUT_RANGING     0x01        // Distance sensor pinging
+#define FSM_OUT_SIREN       0x02
+#define FSM_OUT_ARMED_LED   0x04        // Blue
+#define FSM_OUT_ADMIN_LED   0x08        // Green
+
+void AlarmFsm_Init(uint8_t state, void (*notify)(void));
+uint8_t AlarmFsm_Event(uint8_t ev);
+uint8_t AlarmFsm_State(void);
+uint8_t AlarmFsm_Outputs(void);
+
+#endif /* ALARMFSM_H */
@@ -0,0 +1,169 @@
+/*-------------------------------------------------------------------------
+ * Technika Mikroprocesorowa 2 - Project
+ * Project: Security Alarm System
+ * File: codes.c
+ *
+ * This file implements the access code table:
+ * - CODES_MAX slots of one longword: role in bits 24..31, up to
+ *   CODE_MAX_DIGITS BCD digits in bits 0..23, unused digits 0xF
+ * - Lookup compares the entered code with every slot without branches
+ *   on the data, so its time depends neither on the code nor on the
+ *   number or position of stored codes
+ * - A code is stored in one slot only, so it has exactly one role
+ * - Slots are persisted in the flash key/value store
+ *-------------------------------------------------------------------------*/
+
+#include "codes.h"
+#include "kvstore.h"
+
+/*-------------------------------------------------------------------------
+ * Constants
+ *-------------------------------------------------------------------------*/
+#define CODE_DIGITS_MASK    0x00FFFFFFu
+#define CODE_ROLE_SHIFT     24
+#define CODE_INVALID        0xFFFFFFFFu  // Packs no code, matches no slot
+
+/*-------------------------------------------------------------------------
+ * Static Variables
+ *-------------------------------------------------------------------------*/
+static uint32_t table[CODES_MAX];
+
+/*-------------------------------------------------------------------------
+ * Function: code_pack
+ * Purpose: Pack digits to BCD, right aligned, padded with 0xF nibbles.
+ *          Runs over all CODE_MAX_DIGITS positions for any length.
+ * Parameters:
+ * digits - '0'..'9' characters
+ * len - number of digits, 1..CODE_MAX_DIGITS
+ * Returns: uint32_t - packed digits, CODE_INVALID if not a code
+ *-------------------------------------------------------------------------*/
+static uint32_t code_pack(const char* digits, uint8_t len) {
+    uint32_t packed = 0;
+    uint32_t bad = 0;
+
+    if (len == 0 || len > CODE_MAX_DIGITS) {
+        return CODE_INVALID;
+    }
+    for (uint8_t i = 0; i < CODE_MAX_DIGITS; i++) {
+        uint8_t pad = (i < CODE_MAX_DIGITS - len);
+        uint32_t d = pad ? 0xF : (uint32_t)(digits[i - (CODE_MAX_DIGITS - len)] - '0');
+
+        bad |= pad ? 0 : (d > 9);
+        packed = (packed << 4) | (d & 0xF);
+    }
+    return bad ? CODE_INVALID : packed;
+}
+
+/*-------------------------------------------------------------------------
+ * Function: slot_hit
+ * Purpose: Compare a slot with a packed code without a branch
+ * Parameters:
+ * slot - 0..CODES_MAX-1
+ * key - packed code
+ * Returns: uint32_t - 1 if the digits are equal, 0 otherwise
+ *-------------------------------------------------------------------------*/
+static uint32_t slot_hit(uint8_t slot, uint32_t key) {
+    uint32_t diff = (table[slot] ^ key) & CODE_DIGITS_MASK;
+
+    return ((diff | (0u - diff)) >> 31) ^ 1;
+}
+
+/*-------------------------------------------------------------------------
+ * Function: Codes_Init
+ * Purpose: Load the table from flash. On the first boot the factory
+ *          codes (user 1234, admin 4321) are stored, so that changing
+ *          one of them later does not drop the other.
+ * Parameters: None
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+void Codes_Init(void) {
+    uint8_t stored = 0;
+
+    for (uint8_t i = 0; i < CODES_MAX; i++) {
+        table[i] = CODE_INVALID & CODE_DIGITS_MASK;     // Role none
+        stored |= Kv_Get(KV_KEY_CODE(i), &table[i], sizeof(table[i])) != 0;
+    }
+    if (!stored) {
+        Codes_Set(0, "1234", 4, CODE_ROLE_USER);
+        Codes_Set(1, "4321", 4, CODE_ROLE_ADMIN);
+    }
+}
+
+/*-------------------------------------------------------------------------
+ * Function: Codes_Lookup
+ * Purpose: Find the role of an entered code in constant time. All slots
+ *          are visited and the role of a matching slot replaces the
+ *          result, so a duplicate left by older firmware resolves to the
+ *          later slot (the admin code of the factory layout) instead of
+ *          a mix of roles.
+ * Parameters:
+ * digits - entered digits
+ * len - number of digits
+ * Returns: uint8_t - CODE_ROLE_xxx, CODE_ROLE_NONE if not found
+ *-------------------------------------------------------------------------*/
+uint8_t Codes_Lookup(const char* digits, uint8_t len) {
+    uint32_t key = code_pack(digits, len);
+    uint32_t role = 0;
+
+    for (uint8_t i = 0; i < CODES_MAX; i++) {
+        uint32_t mask = 0u - slot_hit(i, key);              // All ones on a match
+
+        role = (role & ~mask) | ((table[i] >> CODE_ROLE_SHIFT) & mask);
+    }
+    // An invalid entry packs to all ones and may equal a free slot only
+    return (key == CODE_INVALID) ? CODE_ROLE_NONE : (uint8_t)role;
+}
+
+/*-------------------------------------------------------------------------
+ * Function: Codes_Set
+ * Purpose: Store or clear a slot, in RAM and in flash
+ * Parameters:
+ * slot - 0..CODES_MAX-1
+ * digits, len - new code (ignored for CODE_ROLE_NONE)
+ * role - CODE_ROLE_xxx, CODE_ROLE_NONE frees the slot
+ * Returns: uint8_t - 0 on success, CODES_ERR_INVALID, CODES_ERR_IN_USE if
+ *          another slot holds the code, flash errors otherwise
+ *-------------------------------------------------------------------------*/
+uint8_t Codes_Set(uint8_t slot, const char* digits, uint8_t len, uint8_t role) {
+    uint32_t packed = (role == CODE_ROLE_NONE) ? (CODE_INVALID & CODE_DIGITS_MASK) : code_pack(digits, len);
+    uint32_t used = 0;
+
+    if (slot >= CODES_MAX || packed == CODE_INVALID) {
+        return CODES_ERR_INVALID;
+    }
+    if (role != CODE_ROLE_NONE) {
+        for (uint8_t i = 0; i < CODES_MAX; i++) {
+            used |= slot_hit(i, packed) & (i != slot) & ((table[i] >> CODE_ROLE_SHIFT) != CODE_ROLE_NONE);
+        }
+        if (used) {
+            return CODES_ERR_IN_USE;
+        }
+    }
+    table[slot] = packed | ((uint32_t)role << CODE_ROLE_SHIFT);
+    return Kv_Set(KV_KEY_CODE(slot), &table[slot], sizeof(table[slot]));
+}
+
+/*-------------------------------------------------------------------------
+ * Function: Codes_Get
+ * Purpose: Read a slot back (for administration, not for checking codes)
+ * Parameters:
+ * slot - 0..CODES_MAX-1
+ * digits - CODE_MAX_DIGITS + 1 bytes, receives the code as a string
+ * Returns: uint8_t - role, CODE_ROLE_NONE for a free slot
+ *-------------------------------------------------------------------------*/
+uint8_t Codes_Get(uint8_t slot, char* digits) {
+    uint8_t n = 0;
+
+    if (slot >= CODES_MAX) {
+        return CODE_ROLE_NONE;
+    }
+    for (int8_t i = CODE_MAX_DIGITS - 1; i >= 0; i--) {
+        uint8_t d = (table[slot] >> (4 * i)) & 0xF;
+
+        if (d <= 9) {
+            digits[n++] = (char)('0' + d);
+        }
+    }
+    digits[n] = 0;
+    return (uint8_t)(table[slot] >> CODE_ROLE_SHIFT);
+}
@@ -0,0 +1,25 @@
+#ifndef CODES_H
+#define CODES_H
+
+#include "hal.h"
+
+#define CODES_MAX           32          // Table slots, 4 bytes of RAM each
+#define CODE_MAX_DIGITS     6           // Packed BCD, 4 bits per digit
+
+// Roles, CODE_ROLE_NONE marks a free slot
+#define CODE_ROLE_NONE      0
+#define CODE_ROLE_USER      1           // Arm / disarm
+#define CODE_ROLE_ADMIN     2           // Change user codes
+#define CODE_ROLE_DURESS    3           // Disarm and log a duress event
+#define CODE_ROLE_INSTALLER 4           // Admin rights, service access
+
+// Codes_Set errors besides the FLASH_ERR_xxx bits
+#define CODES_ERR_INVALID   0x02        // Not 1..CODE_MAX_DIGITS digits
+#define CODES_ERR_IN_USE    0x04        // Code already stored in another slot
+
+void Codes_Init(void);
+uint8_t Codes_Lookup(const char* digits, uint8_t len);
+uint8_t Codes_Set(uint8_t slot, const char* digits, uint8_t len, uint8_t role);
+uint8_t Codes_Get(uint8_t slot, char* digits);
+
+#endif /* CODES_H */
@@ -0,0 +1,237 @@
+/*-------------------------------------------------------------------------
+ * Technika Mikroprocesorowa 2 - Project
+ * Project: Security Alarm System
+ * File: eventlog.c
+ *
+ * This file implements the persistent alarm event log:
+ * - 8-byte records appended to a ring of flash sectors, the oldest
+ *   sector is erased when the ring wraps
+ * - Records are queued in RAM and committed later from a low priority
+ *   task, one longword per flash command, so detection is not stalled
+ * - Boot recovery: the newest sector is found from the lap number of
+ *   each sector's first record, the head by binary search inside it
+ *-------------------------------------------------------------------------*/
+
+#include "eventlog.h"
+#include "flash.h"
+
+/*-------------------------------------------------------------------------
+ * Constants
+ *-------------------------------------------------------------------------*/
+#define LOG_RECORD_SIZE     sizeof(Log_Record)
+#define LOG_PER_SECTOR      (FLASH_SECTOR_SIZE / LOG_RECORD_SIZE)
+#define LOG_SLOTS           (LOG_PER_SECTOR * FLASH_LOG_SECTORS)
+#define LOG_NO_SECTOR       0xFF
+
+typedef char log_record_size_check[(sizeof(Log_Record) == 8) ? 1 : -1];
+
+/*-------------------------------------------------------------------------
+ * Static Variables
+ *-------------------------------------------------------------------------*/
+static Log_Record pending[LOG_RAM_SIZE];
+static volatile uint8_t pending_head, pending_tail;    // Free-running indices
+static uint16_t dropped;                                // Pending ring was full
+
+static uint16_t slot;                   // Next free slot in the region
+static uint8_t lap;                     // Lap of the sector being written
+static uint16_t used[FLASH_LOG_SECTORS];    // Records per sector
+
+/*-------------------------------------------------------------------------
+ * Function: slot_addr
+ * Purpose: Flash address of a record slot
+ * Parameters: n - slot index
+ * Returns: uint32_t - address
+ *-------------------------------------------------------------------------*/
+static uint32_t slot_addr(uint16_t n) {
+    return FLASH_LOG_START + (uint32_t)n * LOG_RECORD_SIZE;
+}
+
+/*-------------------------------------------------------------------------
+ * Function: slot_erased
+ * Purpose: Check if a slot was never written (a torn record is not)
+ * Parameters: n - slot index
+ * Returns: uint8_t - 1 if erased
+ *-------------------------------------------------------------------------*/
+static uint8_t slot_erased(uint16_t n) {
+    return Flash_IsErased(slot_addr(n), LOG_RECORD_SIZE);
+}
+
+/*-------------------------------------------------------------------------
+ * Function: sector_used
+ * Purpose: Count written slots of a sector. Slots are filled in order,
+ *          so the first erased one is found by binary search.
+ * Parameters: s - sector index in the region
+ * Returns: uint16_t - written slots
+ *-------------------------------------------------------------------------*/
+static uint16_t sector_used(uint8_t s) {
+    uint16_t lo = 0, hi = LOG_PER_SECTOR;
+    uint16_t base = s * LOG_PER_SECTOR;
+
+    while (lo < hi) {
+        uint16_t mid = (lo + hi) / 2;
+
+        if (slot_erased(base + mid)) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    return lo;
+}
+
+/*-------------------------------------------------------------------------
+ * Function: Log_Init
+ * Purpose: Locate the log head in flash and record the boot
+ * Parameters: time - current time [ms]
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+void Log_Init(uint32_t time) {
+    uint8_t newest = LOG_NO_SECTOR;
+    uint8_t newest_lap = 0;
+
+    pending_head = pending_tail = 0;
+    for (uint8_t s = 0; s < FLASH_LOG_SECTORS; s++) {
+        uint8_t first_lap;
+
+        used[s] = 0;
+        if (slot_erased(s * LOG_PER_SECTOR)) {
+            continue;
+        }
+        used[s] = sector_used(s);
+        first_lap = (uint8_t)(Flash_ReadWord(slot_addr(s * LOG_PER_SECTOR) + 4) >> 24) & LOG_LAP_MASK;
+        // Laps are compared modulo 16 - the newest sector is ahead
+        if (newest == LOG_NO_SECTOR ||
+            (first_lap != newest_lap && ((first_lap - newest_lap) & LOG_LAP_MASK) < 8)) {
+            newest = s;
+            newest_lap = first_lap;
+        }
+    }
+
+    if (newest == LOG_NO_SECTOR) {
+        slot = 0;
+        lap = LOG_LAP_MASK;             // First sector gets lap 0
+    } else {
+        slot = newest * LOG_PER_SECTOR + used[newest];
+        lap = newest_lap;
+        if (slot == LOG_SLOTS) {
+            slot = 0;
+        }
+    }
+    Log_Put(LOG_SRC_BOOT, 0, 0, time);
+}
+
+/*-------------------------------------------------------------------------
+ * Function: Log_Put
+ * Purpose: Queue a record for the next commit, called from one context
+ * Parameters:
+ * source - LOG_SRC_xxx
+ * armed - 1 if the system is armed
+ * value - source specific reading
+ * time - timestamp [ms]
+ * Returns: uint8_t - 1 if queued, 0 if the RAM ring was full
+ *-------------------------------------------------------------------------*/
+uint8_t Log_Put(uint8_t source, uint8_t armed, uint16_t value, uint32_t time) {
+    uint8_t head = pending_head;
+    Log_Record* r;
+
+    if ((uint8_t)(head - pending_tail) >= LOG_RAM_SIZE) {
+        dropped++;
+        return 0;
+    }
+    r = &pending[head & (LOG_RAM_SIZE - 1)];
+    r->time = time;
+    r->value = value;
+    r->source = source;
+    r->flags = armed ? LOG_ARMED : 0;   // Lap is added at commit
+
+    __DMB();
+    pending_head = head + 1;
+    return 1;
+}
+
+/*-------------------------------------------------------------------------
+ * Function: Log_Flush
+ * Purpose: Commit queued records to flash. Entering a new sector needs
+ *          an erase (interrupts blocked ~14 ms), which the caller may
+ *          postpone while a stall would be noticed (siren playing,
+ *          sensors ranging).
+ * Parameters: allow_erase - 0 to stop before an erase
+ * Returns: uint8_t - 0 on success or nothing to do, FLASH_ERR_xxx bits
+ *-------------------------------------------------------------------------*/
+uint8_t Log_Flush(uint8_t allow_erase) {
+    while (pending_tail != pending_head) {
+        const Log_Record* r = &pending[pending_tail & (LOG_RAM_SIZE - 1)];
+        uint8_t sector = slot / LOG_PER_SECTOR;
+        uint32_t addr = slot_addr(slot);
+        uint8_t err;
+
+        if (slot % LOG_PER_SECTOR == 0) {
+            // Start of a sector - wipe what the previous lap left there
+            if (!Flash_IsErased(addr, FLASH_SECTOR_SIZE)) {
+                if (!allow_erase) {
+                    return 0;
+                }
+                if ((err = Flash_EraseSector(addr)) != 0) {
+                    return err;
+                }
+            }
+            used[sector] = 0;
+            lap = (lap + 1) & LOG_LAP_MASK;
+        }
+
+        // Timestamp first, the word with source and lap marks the record valid
+        err = Flash_ProgramWord(addr, r->time);
+        if (err == 0) {
+            err = Flash_ProgramWord(addr + 4, r->value | ((uint32_t)r->source << 16) |
+                                              ((uint32_t)(r->flags | lap) << 24));
+        }
+        // The slot is consumed even on error, it is not erased any more
+        used[sector]++;
+        slot = (slot + 1 == LOG_SLOTS) ? 0 : slot + 1;
+        if (err != 0) {
+            return err;
+        }
+
+        __DMB();
+        pending_tail++;
+    }
+    return 0;
+}
+
+/*-------------------------------------------------------------------------
+ * Function: Log_Count
+ * Purpose: Number of records in flash (torn ones included)
+ * Parameters: None
+ * Returns: uint16_t - record count
+ *-------------------------------------------------------------------------*/
+uint16_t Log_Count(void) {
+    uint16_t n = 0;
+
+    for (uint8_t s = 0; s < FLASH_LOG_SECTORS; s++) {
+        n += used[s];
+    }
+    return n;
+}
+
+/*-------------------------------------------------------------------------
+ * Function: Log_Read
+ * Purpose: Read a committed record, newest first
+ * Parameters:
+ * n - 0 for the newest record
+ * rec - copy of the record
+ * Returns: uint8_t - 1 if valid, 0 if out of range or torn
+ *-------------------------------------------------------------------------*/
+uint8_t Log_Read(uint16_t n, Log_Record* rec) {
+    uint32_t addr, word;
+
+    if (n >= Log_Count()) {
+        return 0;
+    }
+    addr = slot_addr((uint16_t)((slot + LOG_SLOTS - 1 - n) % LOG_SLOTS));
+    word = Flash_ReadWord(addr + 4);
+    rec->time = Flash_ReadWord(addr);
+    rec->value = (uint16_t)word;
+    rec->source = (uint8_t)(word >> 16);
+    rec->flags = (uint8_t)(word >> 24) & ~LOG_LAP_MASK;
+    return rec->source != 0xFF;
+}
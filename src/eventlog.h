@@ -0,0 +1,39 @@
+#ifndef EVENTLOG_H
+#define EVENTLOG_H
+
+#include "hal.h"
+
+/*-------------------------------------------------------------------------
+ * Record Sources
+ *-------------------------------------------------------------------------*/
+#define LOG_SRC_BOOT        1           // value = 0
+#define LOG_SRC_MOTION      2           // value = (dynamic acceleration / 62.5 mg)^2
+#define LOG_SRC_DISTANCE    3           // value = distance [mm]
+#define LOG_SRC_ARM         4
+#define LOG_SRC_DISARM      5
+#define LOG_SRC_CODE        6           // User code changed in admin mode
+#define LOG_SRC_DURESS      7           // Disarmed with a duress code
+#define LOG_SRC_TAMPER      8           // value = high band energy [counts^2 / 256]
+
+#define LOG_RAM_SIZE        16          // Pending records, power of two
+#define LOG_FLUSH_MS        1000        // Period of the commit task
+
+// One flash record, two longwords. The second one is programmed last
+// and is never all ones, so a torn record is recognised.
+typedef struct {
+    uint32_t time;                      // Sched_Millis() at the event
+    uint16_t value;                     // Source specific reading
+    uint8_t source;                     // LOG_SRC_xxx
+    uint8_t flags;                      // LOG_ARMED, lap in bits 0..3
+} Log_Record;
+
+#define LOG_ARMED           0x80        // System was armed
+#define LOG_LAP_MASK        0x0F        // Sector generation, orders the sectors
+
+void Log_Init(uint32_t time);
+uint8_t Log_Put(uint8_t source, uint8_t armed, uint16_t value, uint32_t time);
+uint8_t Log_Flush(uint8_t allow_erase);
+uint16_t Log_Count(void);
+uint8_t Log_Read(uint16_t n, Log_Record* rec);
+
+#endif /* EVENTLOG_H */
@@ -0,0 +1,72 @@
+/*-------------------------------------------------------------------------
+ * Technika Mikroprocesorowa 2 - Project
+ * Project: Security Alarm System
+ * File: events.c
+ *
+ * This file implements the interrupt-to-main event queue:
+ * - Fixed capacity, power-of-two ring buffer of timestamped events
+ * - Lock-free for one producer and one consumer context
+ * - Overflow counting
+ *-------------------------------------------------------------------------*/
+
+#include "events.h"
+
+/*-------------------------------------------------------------------------
+ * Function: Event_Put
+ * Purpose: Append event, called only from the producer context
+ * Parameters:
+ * q - queue
+ * type, arg, value, time - event contents
+ * Returns: uint8_t - 1 if queued, 0 if the queue was full
+ *-------------------------------------------------------------------------*/
+uint8_t Event_Put(Event_Queue* q, uint8_t type, uint8_t arg, uint16_t value, uint32_t time) {
+    uint8_t head = q->head;
+    Event* ev;
+
+    if ((uint8_t)(head - q->tail) > q->mask) {
+        q->overflows++;
+        return 0;
+    }
+
+    ev = &q->buf[head & q->mask];
+    ev->type = type;
+    ev->arg = arg;
+    ev->value = value;
+    ev->time = time;
+
+    __DMB();                        // Event visible before it is published
+    q->head = head + 1;
+    return 1;
+}
+
+/*-------------------------------------------------------------------------
+ * Function: Event_Get
+ * Purpose: Remove oldest event, called only from the consumer context
+ * Parameters:
+ * q - queue
+ * ev - copy of the event
+ * Returns: uint8_t - 1 if an event was returned, 0 if the queue was empty
+ *-------------------------------------------------------------------------*/
+uint8_t Event_Get(Event_Queue* q, Event* ev) {
+    uint8_t tail = q->tail;
+
+    if (tail == q->head) {
+        return 0;
+    }
+
+    *ev = q->buf[tail & q->mask];
+
+    __DMB();                        // Slot read before it is released
+    q->tail = tail + 1;
+    return 1;
+}
+
+/*-------------------------------------------------------------------------
+ * Function: Event_Count
+ * Purpose: Get number of queued events
+ * Parameters: q - queue
+ * Returns: uint8_t - events waiting
+ *-------------------------------------------------------------------------*/
+uint8_t Event_Count(const Event_Queue* q) {
+    return (uint8_t)(q->head - q->tail);
+}
@@ -0,0 +1,45 @@
+#ifndef EVENTS_H
+#define EVENTS_H
+
+#include "hal.h"
+
+/*-------------------------------------------------------------------------
+ * Event Types
+ *-------------------------------------------------------------------------*/
+#define EV_KEY          1           // arg = key character
+#define EV_MOTION       2           // value = samples in batch
+#define EV_ECHO         3           // value = echo ticks, arg = prescaler | EV_ECHO_CLOSE
+#define EV_TIMER        4           // arg = timer id
+
+#define EV_ECHO_CLOSE   0x80        // Echo within alarm distance
+
+typedef struct {
+    uint8_t type;                   // EV_xxx
+    uint8_t arg;                    // Type specific
+    uint16_t value;                 // Type specific
+    uint32_t time;                  // Timestamp
+} Event;
+
+/*-------------------------------------------------------------------------
+ * Single-producer/single-consumer ring buffer. One context may only put,
+ * one context may only get - no interrupt masking is needed because each
+ * index is written by one side only (byte stores are atomic on M0+).
+ *-------------------------------------------------------------------------*/
+typedef struct {
+    Event* buf;
+    uint8_t mask;                   // Capacity - 1, capacity is a power of two <= 128
+    volatile uint8_t head;          // Written by producer only
+    volatile uint8_t tail;          // Written by consumer only
+    volatile uint16_t overflows;    // Events dropped because the queue was full
+} Event_Queue;
+
+#define EVENT_QUEUE(name, size)                                             \
+    typedef char name##_size_check[(((size) & ((size) - 1)) == 0 && (size) <= 128) ? 1 : -1]; \
+    static Event name##_buf[size];                                          \
+    static Event_Queue name = { name##_buf, (size) - 1, 0, 0, 0 }
+
+uint8_t Event_Put(Event_Queue* q, uint8_t type, uint8_t arg, uint16_t value, uint32_t time);
+uint8_t Event_Get(Event_Queue* q, Event* ev);
+uint8_t Event_Count(const Event_Queue* q);
+
+#endif /* EVENTS_H */
\ No newline at end of file
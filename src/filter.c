@@ -0,0 +1,189 @@
+/*-------------------------------------------------------------------------
+ * Technika Mikroprocesorowa 2 - Project
+ * Project: Security Alarm System
+ * File: filter.c
+ *
+ * This file implements sensor filter stages:
+ * - Running median over a sliding window, O(log N) per sample
+ * - k-of-n confirmation of threshold hits
+ * Integer only, no dynamic memory.
+ *-------------------------------------------------------------------------*/
+
+#include "filter.h"
+
+#ifdef HOST_BUILD
+uint32_t median_compares;
+uint32_t median_swaps;
+#endif
+
+/*-------------------------------------------------------------------------
+ * Function: less
+ * Purpose: Compare the samples at two heap positions
+ * Parameters: f - filter, i, j - heap positions
+ * Returns: uint8_t - 1 if sample at i < sample at j
+ *-------------------------------------------------------------------------*/
+static inline uint8_t less(const Median_Filter* f, int i, int j) {
+    MEDIAN_COUNT(median_compares);
+    return f->data[f->heap[i]] < f->data[f->heap[j]];
+}
+
+/*-------------------------------------------------------------------------
+ * Function: swap_if_less
+ * Purpose: Exchange two heap entries if sample at i < sample at j
+ * Parameters: f - filter, i, j - heap positions
+ * Returns: uint8_t - 1 if exchanged
+ *-------------------------------------------------------------------------*/
+static uint8_t swap_if_less(Median_Filter* f, int i, int j) {
+    int8_t t;
+
+    if (!less(f, i, j)) {
+        return 0;
+    }
+    MEDIAN_COUNT(median_swaps);
+    t = f->heap[i];
+    f->heap[i] = f->heap[j];
+    f->heap[j] = t;
+    f->pos[f->heap[i]] = i;
+    f->pos[f->heap[j]] = j;
+    return 1;
+}
+
+// Heap sizes: min-heap at positions 1..MIN_CT, max-heap at -1..-MAX_CT
+#define MIN_CT(f)   (((f)->n - 1) / 2)
+#define MAX_CT(f)   ((f)->n / 2)
+
+// Restore min-heap order, starting from the first child i of a moved
+// entry. The median is the root of both heaps (children 1 and -1).
+static void min_sort_down(Median_Filter* f, int i) {
+    for (; i <= MIN_CT(f); i *= 2) {
+        if (i > 1 && i < MIN_CT(f) && less(f, i + 1, i)) {
+            i++;
+        }
+        if (!swap_if_less(f, i, i / 2)) {
+            break;
+        }
+    }
+}
+
+// Restore max-heap order, starting from the first child i (negative)
+static void max_sort_down(Median_Filter* f, int i) {
+    for (; i >= -MAX_CT(f); i *= 2) {
+        if (i < -1 && i > -MAX_CT(f) && less(f, i, i - 1)) {
+            i--;
+        }
+        if (!swap_if_less(f, i / 2, i)) {
+            break;
+        }
+    }
+}
+
+// Move an entry up the min-heap, returns 1 if it reached the median
+static uint8_t min_sort_up(Median_Filter* f, int i) {
+    while (i > 0 && swap_if_less(f, i, i / 2)) {
+        i /= 2;
+    }
+    return i == 0;
+}
+
+// Move an entry up the max-heap, returns 1 if it reached the median
+static uint8_t max_sort_up(Median_Filter* f, int i) {
+    while (i < 0 && swap_if_less(f, i / 2, i)) {
+        i /= 2;
+    }
+    return i == 0;
+}
+
+/*-------------------------------------------------------------------------
+ * Function: Median_Init
+ * Purpose: Fill the window with one value, so the output is defined
+ *          from the first sample on
+ * Parameters:
+ * f - filter
+ * initial - value of all samples in the window
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+void Median_Init(Median_Filter* f, int32_t initial) {
+    // Positions alternate median, max-heap, min-heap, max-heap, ...
+    for (int i = 0; i < f->n; i++) {
+        int p = ((i + 1) / 2) * ((i & 1) ? -1 : 1);
+
+        f->data[i] = initial;
+        f->pos[i] = p;
+        f->heap[p] = i;
+    }
+    f->idx = 0;
+}
+
+/*-------------------------------------------------------------------------
+ * Function: Median_Push
+ * Purpose: Replace the oldest sample and return the window median
+ * Parameters:
+ * f - filter
+ * v - new sample
+ * Returns: int32_t - median of the last n samples
+ *-------------------------------------------------------------------------*/
+int32_t Median_Push(Median_Filter* f, int32_t v) {
+    int p = f->pos[f->idx];
+    int32_t old = f->data[f->idx];
+
+    f->data[f->idx] = v;
+    if (++f->idx == f->n) {
+        f->idx = 0;
+    }
+
+    if (p > 0) {
+        // Sample is in the min-heap (upper half)
+        MEDIAN_COUNT(median_compares);
+        if (old < v) {
+            min_sort_down(f, p * 2);
+        } else if (min_sort_up(f, p)) {
+            max_sort_down(f, -1);
+        }
+    } else if (p < 0) {
+        // Sample is in the max-heap (lower half)
+        MEDIAN_COUNT(median_compares);
+        if (v < old) {
+            max_sort_down(f, p * 2);
+        } else if (max_sort_up(f, p)) {
+            min_sort_down(f, 1);
+        }
+    } else {
+        // Sample was the median - let it sink into whichever heap it belongs
+        if (MAX_CT(f)) {
+            max_sort_down(f, -1);
+        }
+        if (MIN_CT(f)) {
+            min_sort_down(f, 1);
+        }
+    }
+    return f->data[f->heap[0]];
+}
+
+/*-------------------------------------------------------------------------
+ * Function: KofN_Reset
+ * Purpose: Clear the confirmation window
+ * Parameters: f - filter
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+void KofN_Reset(KofN_Filter* f) {
+    f->history = 0;
+    f->count = 0;
+}
+
+/*-------------------------------------------------------------------------
+ * Function: KofN_Push
+ * Purpose: Add one threshold result to the window
+ * Parameters:
+ * f - filter
+ * hit - 1 if the sample crossed the threshold
+ * Returns: uint8_t - 1 if at least k of the last n samples were hits
+ *-------------------------------------------------------------------------*/
+uint8_t KofN_Push(KofN_Filter* f, uint8_t hit) {
+    f->count -= (f->history >> (f->n - 1)) & 1;     // Oldest bit leaves
+    f->history = (f->history << 1) | (hit ? 1 : 0);
+    if (f->n < 32) {
+        f->history &= (1UL << f->n) - 1;
+    }
+    f->count += hit ? 1 : 0;
+    return f->count >= f->k;
+}
@@ -0,0 +1,61 @@
+#ifndef FILTER_H
+#define FILTER_H
+
+#include "hal.h"
+
+/*-------------------------------------------------------------------------
+ * Running median of the last N samples. Samples are kept in a circular
+ * buffer and indexed by a max-heap (lower half) and a min-heap (upper
+ * half) that meet at the median, so one update costs O(log N).
+ * N must be odd and at most 127. Storage is static, see MEDIAN_FILTER.
+ *-------------------------------------------------------------------------*/
+typedef struct {
+    int32_t* data;                  // Circular buffer of samples
+    int8_t* pos;                    // Heap position of each sample
+    int8_t* heap;                   // Sample indices, heap[0] is the median
+    uint8_t n;                      // Window length
+    uint8_t idx;                    // Oldest sample, replaced next
+} Median_Filter;
+
+#define MEDIAN_FILTER(name, size)                                           \
+    typedef char name##_size_check[(((size) & 1) && (size) <= 127) ? 1 : -1]; \
+    static int32_t name##_data[size];                                       \
+    static int8_t name##_pos[size];                                         \
+    static int8_t name##_heap[size];                                        \
+    static Median_Filter name = { name##_data, name##_pos, name##_heap + (size) / 2, (size), 0 }
+
+/*-------------------------------------------------------------------------
+ * k-of-n confirmation: true while at least k of the last n inputs were
+ * true (n <= 32). The window is a shift register, the count is updated
+ * with the bit entering and the bit leaving.
+ *-------------------------------------------------------------------------*/
+typedef struct {
+    uint32_t history;               // Last n inputs, bit 0 newest
+    uint8_t n;
+    uint8_t k;
+    uint8_t count;                  // Ones in history
+} KofN_Filter;
+
+#define KOFN_FILTER(name, k, n)                                             \
+    typedef char name##_size_check[((k) >= 1 && (k) <= (n) && (n) <= 32) ? 1 : -1]; \
+    static KofN_Filter name = { 0, (n), (k), 0 }
+
+/*-------------------------------------------------------------------------
+ * Operation counts for the host bench: sample compares and heap entry
+ * exchanges made by Median_Push. Not compiled into the firmware.
+ *-------------------------------------------------------------------------*/
+#ifdef HOST_BUILD
+#define MEDIAN_COUNT(c)     ((c)++)
+
+extern uint32_t median_compares;
+extern uint32_t median_swaps;
+#else
+#define MEDIAN_COUNT(c)     ((void)0)
+#endif
+
+void Median_Init(Median_Filter* f, int32_t initial);
+int32_t Median_Push(Median_Filter* f, int32_t v);
+void KofN_Reset(KofN_Filter* f);
+uint8_t KofN_Push(KofN_Filter* f, uint8_t hit);
+
+#endif /* FILTER_H */
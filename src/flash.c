@@ -0,0 +1,125 @@
+/*-------------------------------------------------------------------------
+ * Technika Mikroprocesorowa 2 - Project
+ * Project: Security Alarm System
+ * File: flash.c
+ *
+ * This file implements the FTFA flash driver:
+ * - Program longword and erase sector commands
+ * - Command launch and wait loop executed from RAM, with interrupts
+ *   masked (KL05 has one flash block, it cannot be read while a command
+ *   runs and the vector table lives in it)
+ * - Longword program ~65 us, sector erase ~14 ms (typical)
+ *-------------------------------------------------------------------------*/
+
+#include "flash.h"
+
+/*-------------------------------------------------------------------------
+ * Constants
+ *-------------------------------------------------------------------------*/
+#define FLASH_CMD_PGM4      0x06        // Program longword
+#define FLASH_CMD_ERSSCR    0x09        // Erase flash sector
+#define FLASH_ERRORS        (FTFA_FSTAT_ACCERR_MASK | FTFA_FSTAT_FPVIOL_MASK | FTFA_FSTAT_MGSTAT0_MASK)
+
+/*-------------------------------------------------------------------------
+ * Function: flash_run
+ * Purpose: Launch the loaded command and wait for it. Runs from RAM and
+ *          touches nothing in flash, not even a literal pool.
+ * Parameters: fstat - &FTFA->FSTAT
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+static HAL_RAMFUNC void flash_run(volatile uint8_t* fstat) {
+    *fstat = FTFA_FSTAT_CCIF_MASK;      // Launch
+    while (!(*fstat & FTFA_FSTAT_CCIF_MASK)) {
+    }
+}
+
+/*-------------------------------------------------------------------------
+ * Function: flash_command
+ * Purpose: Load FCCOB and run one command
+ * Parameters:
+ * cmd - command code
+ * addr - flash address
+ * data - longword for program commands
+ * Returns: uint8_t - 0 on success, FLASH_ERR_xxx bits otherwise
+ *-------------------------------------------------------------------------*/
+static uint8_t flash_command(uint8_t cmd, uint32_t addr, uint32_t data) {
+    uint32_t primask;
+
+    while (!(FTFA->FSTAT & FTFA_FSTAT_CCIF_MASK)) {
+        HAL_POLL();
+    }
+    HAL_W1C(FTFA->FSTAT, FTFA_FSTAT_ACCERR_MASK | FTFA_FSTAT_FPVIOL_MASK);
+
+    FTFA->FCCOB0 = cmd;
+    FTFA->FCCOB1 = (uint8_t)(addr >> 16);
+    FTFA->FCCOB2 = (uint8_t)(addr >> 8);
+    FTFA->FCCOB3 = (uint8_t)addr;
+    FTFA->FCCOB4 = (uint8_t)(data >> 24);
+    FTFA->FCCOB5 = (uint8_t)(data >> 16);
+    FTFA->FCCOB6 = (uint8_t)(data >> 8);
+    FTFA->FCCOB7 = (uint8_t)data;
+
+    // No flash access until CCIF is set again - no interrupts either
+    primask = __get_PRIMASK();
+    __disable_irq();
+    HAL_FLASH_LAUNCH(flash_run, FTFA);
+    __set_PRIMASK(primask);
+
+    return FTFA->FSTAT & FLASH_ERRORS;
+}
+
+/*-------------------------------------------------------------------------
+ * Function: Flash_EraseSector
+ * Purpose: Erase one sector to 0xFF. Interrupts are blocked for the
+ *          whole erase time.
+ * Parameters: addr - sector start address
+ * Returns: uint8_t - 0 on success, FLASH_ERR_xxx bits otherwise
+ *-------------------------------------------------------------------------*/
+uint8_t Flash_EraseSector(uint32_t addr) {
+    if (addr < FLASH_DATA_START) {
+        return FLASH_ERR_PROTECT;       // Never touch the application image
+    }
+    return flash_command(FLASH_CMD_ERSSCR, addr, 0);
+}
+
+/*-------------------------------------------------------------------------
+ * Function: Flash_ProgramWord
+ * Purpose: Program one erased longword
+ * Parameters:
+ * addr - longword aligned address
+ * data - value, byte 0 at the lowest address
+ * Returns: uint8_t - 0 on success, FLASH_ERR_xxx bits otherwise
+ *-------------------------------------------------------------------------*/
+uint8_t Flash_ProgramWord(uint32_t addr, uint32_t data) {
+    if (addr < FLASH_DATA_START) {
+        return FLASH_ERR_PROTECT;
+    }
+    return flash_command(FLASH_CMD_PGM4, addr, data);
+}
+
+/*-------------------------------------------------------------------------
+ * Function: Flash_ReadWord
+ * Purpose: Read one longword from the memory mapped array
+ * Parameters: addr - longword aligned address
+ * Returns: uint32_t - value
+ *-------------------------------------------------------------------------*/
+uint32_t Flash_ReadWord(uint32_t addr) {
+    return *(const uint32_t*)HAL_FLASH(addr);
+}
+
+/*-------------------------------------------------------------------------
+ * Function: Flash_IsErased
+ * Purpose: Check that a range reads as erased
+ * Parameters:
+ * addr - longword aligned address
+ * size - bytes, multiple of FLASH_WORD_SIZE
+ * Returns: uint8_t - 1 if all bytes are 0xFF
+ *-------------------------------------------------------------------------*/
+uint8_t Flash_IsErased(uint32_t addr, uint16_t size) {
+    for (uint16_t i = 0; i < size; i += FLASH_WORD_SIZE) {
+        if (Flash_ReadWord(addr + i) != FLASH_ERASED) {
+            return 0;
+        }
+    }
+    return 1;
+}
@@ -0,0 +1,27 @@
+#ifndef FLASH_H
+#define FLASH_H
+
+#include "hal.h"
+
+#define FLASH_SECTOR_SIZE   1024        // Erase unit
+#define FLASH_WORD_SIZE     4           // Program unit (longword)
+#define FLASH_ERASED        0xFFFFFFFF
+
+// Reserved for data, the application image must end below FLASH_DATA_START
+#define FLASH_DATA_START    0x7000
+#define FLASH_LOG_START     0x7000      // Event log (eventlog.c), 2 sectors
+#define FLASH_LOG_SECTORS   2
+#define FLASH_KV_START      0x7800      // Code store, 2 sectors
+#define FLASH_KV_SECTORS    2
+
+// Error bits returned by the commands (FTFA FSTAT)
+#define FLASH_ERR_ACCESS    FTFA_FSTAT_ACCERR_MASK
+#define FLASH_ERR_PROTECT   FTFA_FSTAT_FPVIOL_MASK
+#define FLASH_ERR_VERIFY    FTFA_FSTAT_MGSTAT0_MASK
+
+uint8_t Flash_EraseSector(uint32_t addr);
+uint8_t Flash_ProgramWord(uint32_t addr, uint32_t data);
+uint32_t Flash_ReadWord(uint32_t addr);
+uint8_t Flash_IsErased(uint32_t addr, uint16_t size);
+
+#endif /* FLASH_H */
@@ -36,7 +36,7 @@
 #define DELAY(x)   for(uint32_t i=0;i<(x*1048);i++)__NOP(); 					/* wait */
 
 #ifdef FRDM_KL05Z
-# include "MKL05Z4.h"                        /* header with CMSIS */
+# include "hal.h"                            /* CMSIS header or host shim */
 #endif /* FRDM_KL05Z */
 
 #endif /* FRDM_BSP_H */
@@ -0,0 +1,49 @@
+#ifndef HAL_H
+#define HAL_H
+
+/*-------------------------------------------------------------------------
+ * Hardware abstraction. Drivers keep using the CMSIS register names; on
+ * the target they come from the device header, in the host build
+ * (HOST_BUILD) from a register shim backed by virtual peripherals
+ * (src/host). Only accesses with side effects go through the macros
+ * below, everything else is a plain register access on both builds.
+ *-------------------------------------------------------------------------*/
+#ifdef HOST_BUILD
+#include "host.h"
+#else
+#include "MKL05Z4.h"
+
+// Write-1-to-clear flags: register holding flags only / mixed with control bits
+#define HAL_W1C(reg, mask)          ((reg) = (mask))
+#define HAL_W1C_OR(reg, mask)       ((reg) |= (mask))
+
+// GPIO set/clear registers
+#define HAL_GPIO_SET(gpio, mask)    ((gpio)->PSOR = (mask))
+#define HAL_GPIO_CLR(gpio, mask)    ((gpio)->PCOR = (mask))
+
+// I2C master bit (START/STOP) and data register, a write sends and a
+// read starts the next byte
+#define HAL_I2C_START(i2c)          ((i2c)->C1 |= I2C_C1_MST_MASK)
+#define HAL_I2C_STOP(i2c)           ((i2c)->C1 &= ~I2C_C1_MST_MASK)
+#define HAL_I2C_WRITE(i2c, v)       ((i2c)->D = (v))
+#define HAL_I2C_READ(i2c)           ((i2c)->D)
+
+// LPTMR counter, a write latches the count for the following read
+#define HAL_LPTMR_COUNT(tmr)        ((tmr)->CNR = 0, (uint16_t)(tmr)->CNR)
+
+// Address for DMA descriptors
+#define HAL_ADDR(p)                 ((uint32_t)(p))
+
+// Flash: the command launch routine runs from RAM, the array is memory
+// mapped from address 0. HAL_RAMFUNC code is placed in .ramfunc, which
+// the scatter file puts in the RW region (copied to RAM at startup)
+#define HAL_RAMFUNC                 __attribute__((section(".ramfunc"), noinline))
+#define HAL_FLASH_LAUNCH(fn, ftfa)  ((fn)(&(ftfa)->FSTAT))
+#define HAL_FLASH(addr)             ((const uint8_t*)(addr))
+
+// Called in every busy-wait loop and when the CPU has nothing to do
+#define HAL_POLL()                  ((void)0)
+#define HAL_IDLE()                  __WFI()
+#endif
+
+#endif /* HAL_H */
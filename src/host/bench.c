@@ -0,0 +1,1615 @@
+/*-------------------------------------------------------------------------
+ * Technika Mikroprocesorowa 2 - Project
+ * Project: Security Alarm System
+ * File: host/bench.c
+ *
+ * This file implements the host benchmarks (ALARM_BENCH=<name>), run
+ * on the host CPU instead of the firmware:
+ * - codes: Codes_Lookup time against the number of stored codes and
+ *   the position of the match, next to an early-exit linear search
+ * - keyseq: every key sequence up to KEYSEQ_CHECK_LEN keys fed to the
+ *   keypad matcher, each result checked against regular expressions
+ * - timers: 64..TIMER_MAX timers restarting with random delays on the
+ *   simulated TPM0; start, stop and expiry cost per timer against the
+ *   number running, each expiry checked against its due time
+ * - fsm: every event fed to the alarm state machine in every state,
+ *   each state reached by the shortest event path from power-up; next
+ *   state, outputs, delay timer and notification checked against an
+ *   independent model, delays timed on the simulated TPM0
+ * - vibration: Goertzel band energies of tones at every bin against the
+ *   tone amplitude, cost per sample, classification of the signal
+ *   vectors (rest, rumble, footsteps, slam, prying, drilling, sawing);
+ *   ALARM_VIB_FILE=<file> classifies a recording instead
+ * - motion: smallest push detected in 6 directions for several mounting
+ *   orientations, gravity-removed squared magnitude against the former
+ *   per-axis 1.3 g limit, and the calibration/high-pass cost
+ * - i2c: accelerometer reads on the simulated I2C0 through the blocking
+ *   wrapper and through the queue; main loop time spent waiting per read
+ * - accel: the former double/fabs motion test against the fixed-point
+ *   per-axis test and the gravity-removed squared magnitude on recorded
+ *   samples; host time and M0+ soft-float calls and integer operations
+ *   per sample, and the per-axis results checked equal for every 14-bit
+ *   value
+ * - echo: integer echo threshold and millimetre conversion and the
+ *   former float formula, both against the exact rational distance at
+ *   343 m/s, for every TPM1 prescaler and every 16-bit capture value
+ * - sine: the folded quarter-wave lookup against the full 1024-entry
+ *   table sin_init() used to build, sample for sample over the period;
+ *   cost per sample of both
+ * - filter: running median for windows of 3..127 samples and k-of-n
+ *   confirmation against a sort and a bit count over the window, on a
+ *   noise stream with spikes and repeated values; host time and
+ *   compares and swaps or moves per sample of each, and the time of the
+ *   motion and echo stages as main.c configures them
+ *-------------------------------------------------------------------------*/
+
+#include "models.h"
+#include "codes.h"
+#include "kvstore.h"
+#include "keyseq.h"
+#include "timer.h"
+#include "alarmfsm.h"
+#include "vibration.h"
+#include "motion.h"
+#include "accelerometer.h"
+#include "i2c.h"
+#include "RCW-0001.h"
+#include "TPM.h"
+#include "alarm.h"
+#include "filter.h"
+#include <math.h>
+#include <regex.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/*-------------------------------------------------------------------------
+ * Constants
+ *-------------------------------------------------------------------------*/
+#define BENCH_LOOKUPS       2000000
+#define KEYSEQ_CHECK_LEN    10          // 12M sequences over 5 keys
+#define TIMER_BENCH_MIN     64
+#define TIMER_BENCH_MS      60000       // Simulated time per pool size
+#define TIMER_BENCH_MAX_MS  40000       // Delays beyond the 32 s wheel range too
+#define TIMER_BENCH_OPS     1000000
+#define TIMER_BENCH_LATE_US 1050        // 1 ms tick, compare rounding and interrupt
+#define FSM_PATH_MAX        8
+#define VIB_ODR_HZ          800
+#define VIB_VECTOR_S        4           // Signal vector length
+#define VIB_TONE_TOLERANCE  3           // Tone energy error [%]
+#define VIB_COST_SAMPLES    4000000
+#define MOTION_OLD_MG       1300        // Former per-axis absolute threshold
+#define MOTION_PUSH_STEP_MG 25
+#define MOTION_PUSH_MAX_MG  2500
+#define MOTION_PUSH_SAMPLES 40          // 50 ms push
+#define MOTION_SPREAD_MG    50          // Allowed new-threshold spread
+#define MOTION_COST_SAMPLES 4000000
+#define I2C_BENCH_ADDR      0x1D        // MMA8451Q
+#define I2C_BENCH_REG       0x00        // STATUS, start of every sample read
+#define I2C_BENCH_MAX       (1 + 6 * ACCEL_FIFO_WATERMARK)
+#define ACCEL_OLD_G         1.3         // Former double threshold [g]
+#define ACCEL_REC_SAMPLES   (VIB_ODR_HZ * VIB_VECTOR_S * (VEC_COUNT + 1))
+#define ACCEL_BENCH_ROUNDS  100
+#define ECHO_THRESHOLD_MM   100         // DISTANCE_THRESHOLD_MM in main.c
+#define ECHO_OLD_CM         10.0f       // Former DISTANCE_THRESHOLD [cm]
+#define ECHO_MM_ERROR       0.51        // Rounded to the nearest mm
+#define ECHO_SOUND_MM_S     343000      // Speed of sound of the exact reference
+#define SINE_TABLE_SIZE     1024        // Former RAM table, one period
+#define SIN_ANGLE_RAD       0.0061359231515  // Former sin_init() constants
+#define SIN_AMPLITUDE       2047.0
+#define SINE_COST_ROUNDS    20000
+#define FILTER_CHECK_SAMPLES 200000
+#define FILTER_COST_SAMPLES 4000000
+#define FILTER_STREAM       4096        // Samples replayed by the cost loops
+#define FILTER_WIN_MAX      127
+#define FILTER_MOTION_N     5           // MOTION_MEDIAN, MOTION_CONFIRM_K/N in main.c
+#define FILTER_MOTION_K     4
+#define FILTER_MOTION_KN    8
+#define FILTER_ECHO_N       3           // ECHO_MEDIAN, ECHO_CONFIRM_K/N
+#define FILTER_ECHO_K       2
+#define FILTER_ECHO_KN      3
+#define FILTER_LIMIT        500         // Hit threshold of the stage runs
+
+/*-------------------------------------------------------------------------
+ * Static Variables
+ *-------------------------------------------------------------------------*/
+static char naive_codes[CODES_MAX][CODE_MAX_DIGITS + 1];
+static uint8_t naive_roles[CODES_MAX];
+static uint8_t naive_count;
+static volatile uint32_t sink;
+
+// keyseq: complete code, complete arm, viable prefix
+static const char keyseq_alphabet[] = "19#C*";
+static regex_t keyseq_re[3];
+static char keyseq_keys[KEYSEQ_CHECK_LEN + 1];
+static uint64_t keyseq_counts[5];
+
+// timers: due time of each running timer, expiry check results
+static uint32_t timer_due[TIMER_MAX];
+static uint32_t timer_rng = 1;
+static uint32_t timer_fired, timer_early;
+static int32_t timer_late_max;
+static volatile uint8_t timer_signalled;
+
+// fsm: shortest event path to each state, notifications seen
+static const char* const fsm_state_names[FSM_STATES] = {
+    "disarmed", "exit delay", "armed", "entry delay", "alarm", "admin"
+};
+static const char* const fsm_event_names[FSM_EVENTS] = {
+    "code", "duress", "arm", "admin", "new code", "trigger", "timeout"
+};
+static uint8_t fsm_path[FSM_STATES][FSM_PATH_MAX];
+static uint8_t fsm_path_len[FSM_STATES];
+static uint32_t fsm_notified;
+
+// vibration: signal vectors, noise generator state
+enum {
+    VEC_REST, VEC_TILT, VEC_RUMBLE, VEC_FOOTSTEPS, VEC_SLAM,
+    VEC_PRYING, VEC_DRILL, VEC_SAW, VEC_COUNT
+};
+static const struct {
+    const char* name;
+    uint8_t tamper;                     // 1 = must confirm, 0 = must never flag
+} vib_vectors[VEC_COUNT] = {
+    { "rest (1 g on Z, noise)", 0 },
+    { "tilted 45 deg", 0 },
+    { "truck rumble 12-30 Hz 300 mg", 0 },
+    { "footsteps 2/s", 0 },
+    { "door slam", 0 },
+    { "prying 150-350 Hz 40 mg", 1 },
+    { "drill 250 Hz 80 mg", 1 },
+    { "saw 100 Hz 30 mg, 3 Hz strokes", 1 },
+};
+static uint32_t vib_rng = 1;
+
+// accel: recorded samples as read from the sensor (X/Y/Z MSB, LSB)
+static uint8_t accel_rec[ACCEL_REC_SAMPLES][6];
+
+// echo: operands of the former float formula, volatile as they were
+static volatile float echo_result, echo_tick, echo_tick_head, echo_distance;
+
+// filter: windows under test, sample stream, sort reference window
+MEDIAN_FILTER(filter_med3, 3);
+MEDIAN_FILTER(filter_med5, 5);
+MEDIAN_FILTER(filter_med9, 9);
+MEDIAN_FILTER(filter_med31, 31);
+MEDIAN_FILTER(filter_med127, FILTER_WIN_MAX);
+static Median_Filter* const filter_medians[] = {
+    &filter_med3, &filter_med5, &filter_med9, &filter_med31, &filter_med127
+};
+KOFN_FILTER(filter_kofn_motion, FILTER_MOTION_K, FILTER_MOTION_KN);
+KOFN_FILTER(filter_kofn_echo, FILTER_ECHO_K, FILTER_ECHO_KN);
+KOFN_FILTER(filter_kofn_32, 16, 32);
+static KofN_Filter* const filter_kofns[] = {
+    &filter_kofn_motion, &filter_kofn_echo, &filter_kofn_32
+};
+static int32_t filter_stream[FILTER_STREAM];
+static int32_t filter_window[FILTER_WIN_MAX];
+static uint32_t filter_rng = 1;
+static uint32_t filter_sort_compares;
+static uint32_t filter_sort_moves;
+
+/*-------------------------------------------------------------------------
+ * Function: naive_lookup
+ * Purpose: Reference - string compare, stops at the first difference
+ *          and at the first matching slot
+ * Parameters: digits - entered code
+ * Returns: uint8_t - role
+ *-------------------------------------------------------------------------*/
+static uint8_t naive_lookup(const char* digits) {
+    for (uint8_t i = 0; i < naive_count; i++) {
+        if (strcmp(naive_codes[i], digits) == 0) {
+            return naive_roles[i];
+        }
+    }
+    return CODE_ROLE_NONE;
+}
+
+/*-------------------------------------------------------------------------
+ * Function: time_ns
+ * Purpose: Mean time of one lookup
+ * Parameters:
+ * naive - 1 for the reference search
+ * digits - entered code
+ * Returns: double - nanoseconds per lookup
+ *-------------------------------------------------------------------------*/
+static double time_ns(uint8_t naive, const char* digits) {
+    struct timespec t0, t1;
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (uint32_t i = 0; i < BENCH_LOOKUPS; i++) {
+        sink += naive ? naive_lookup(digits) : Codes_Lookup(digits, 4);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    return ((t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec)) / BENCH_LOOKUPS;
+}
+
+/*-------------------------------------------------------------------------
+ * Function: bench_codes
+ * Purpose: Fill the table step by step and time hits on the first and
+ *          the last stored code and a miss
+ * Parameters: None
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+static void bench_codes(void) {
+    uint8_t used = 0;
+
+    Kv_Init();
+    Codes_Init();
+    Codes_Set(0, "1000", 4, CODE_ROLE_NONE);    // Drop the factory codes
+    Codes_Set(1, "1000", 4, CODE_ROLE_NONE);
+
+    printf("codes:  lookup [ns]     constant-time            early-exit\n");
+    printf("stored            first   last   miss      first   last   miss\n");
+    for (uint8_t n = 1; n <= CODES_MAX; n *= 2) {
+        char first[8], last[8];
+
+        for (; used < n; used++) {
+            snprintf(naive_codes[used], sizeof(naive_codes[used]), "%04u", 1000u + used * 37u);
+            naive_roles[used] = CODE_ROLE_USER;
+            Codes_Set(used, naive_codes[used], 4, CODE_ROLE_USER);
+        }
+        naive_count = used;
+        strcpy(first, naive_codes[0]);
+        strcpy(last, naive_codes[used - 1]);
+        if (Codes_Lookup(last, 4) != CODE_ROLE_USER || Codes_Lookup("9999", 4) != CODE_ROLE_NONE) {
+            host_fault("bench: lookup result wrong");
+        }
+        printf("%6u         %6.1f %6.1f %6.1f     %6.1f %6.1f %6.1f\n", n,
+               time_ns(0, first), time_ns(0, last), time_ns(0, "9999"),
+               time_ns(1, first), time_ns(1, last), time_ns(1, "9999"));
+    }
+}
+
+/*-------------------------------------------------------------------------
+ * Function: keyseq_expect
+ * Purpose: Reference result for the last key of a sequence. The
+ *          sequence is the keys fed since the last non-NONE result.
+ * Parameters: seq - keys of the current sequence
+ * Returns: uint8_t - KEYSEQ_xxx
+ *-------------------------------------------------------------------------*/
+static uint8_t keyseq_expect(const char* seq) {
+    const regex_t* re = keyseq_re;
+
+    if (seq[strlen(seq) - 1] == 'C') {
+        return KEYSEQ_CLEAR;
+    }
+    if (regexec(&re[0], seq, 0, 0, 0) == 0) {
+        return KEYSEQ_CODE;
+    }
+    if (regexec(&re[1], seq, 0, 0, 0) == 0) {
+        return KEYSEQ_ARM;
+    }
+    return regexec(&re[2], seq, 0, 0, 0) == 0 ? KEYSEQ_NONE : KEYSEQ_REJECT;
+}
+
+/*-------------------------------------------------------------------------
+ * Function: keyseq_walk
+ * Purpose: Extend the sequence by every key of the alphabet, check the
+ *          result and the returned code, recurse
+ * Parameters:
+ * m - matcher after keyseq_keys[0..len-1]
+ * len - keys fed
+ * start - first key of the current sequence
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+static void keyseq_walk(const KeySeq* m, uint8_t len, uint8_t start) {
+    for (const char* key = keyseq_alphabet; *key; key++) {
+        KeySeq next = *m;
+        uint8_t got = KeySeq_Feed(&next, *key);
+        uint8_t arm = (got == KEYSEQ_ARM);
+        uint8_t want;
+
+        keyseq_keys[len] = *key;
+        keyseq_keys[len + 1] = 0;
+        want = keyseq_expect(keyseq_keys + start);
+        if (got != want ||
+            ((got == KEYSEQ_CODE || arm) &&
+             (next.len != len - start - arm ||
+              memcmp(next.digits, keyseq_keys + start + arm, next.len) != 0))) {
+            fprintf(stderr, "keyseq: \"%s\": got %u, expected %u\n", keyseq_keys, got, want);
+            exit(1);
+        }
+        keyseq_counts[got]++;
+        if (len + 1 < KEYSEQ_CHECK_LEN) {
+            keyseq_walk(&next, len + 1, got == KEYSEQ_NONE ? start : len + 1);
+        }
+    }
+}
+
+/*-------------------------------------------------------------------------
+ * Function: bench_keyseq
+ * Purpose: Check every key sequence over two digits, '#', 'C' and a
+ *          key outside the keypad against the reference
+ * Parameters: None
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+static void bench_keyseq(void) {
+    static const char* const patterns[3] = {
+        "^[0-9]{4,6}#$", "^#[0-9]{4,6}#$", "^#?[0-9]{0,6}$"
+    };
+    uint64_t total = 0;
+    KeySeq m;
+
+    for (uint8_t i = 0; i < 3; i++) {
+        if (regcomp(&keyseq_re[i], patterns[i], REG_EXTENDED | REG_NOSUB) != 0) {
+            host_fault("bench: regcomp");
+        }
+    }
+    KeySeq_Reset(&m);
+    keyseq_walk(&m, 0, 0);
+    for (uint8_t i = 0; i < 3; i++) {
+        regfree(&keyseq_re[i]);
+    }
+
+    for (uint8_t i = 0; i < 5; i++) {
+        total += keyseq_counts[i];
+    }
+    printf("keyseq: all %llu sequences of 1..%u keys over \"%s\" match the reference\n",
+           (unsigned long long)total, KEYSEQ_CHECK_LEN, keyseq_alphabet);
+    printf("results: none %llu, code %llu, arm %llu, reject %llu, clear %llu\n",
+           (unsigned long long)keyseq_counts[KEYSEQ_NONE],
+           (unsigned long long)keyseq_counts[KEYSEQ_CODE],
+           (unsigned long long)keyseq_counts[KEYSEQ_ARM],
+           (unsigned long long)keyseq_counts[KEYSEQ_REJECT],
+           (unsigned long long)keyseq_counts[KEYSEQ_CLEAR]);
+}
+
+/*-------------------------------------------------------------------------
+ * Function: timer_random
+ * Purpose: Pseudo-random number (xorshift32), same sequence every run
+ * Parameters: None
+ * Returns: uint32_t - random value
+ *-------------------------------------------------------------------------*/
+static uint32_t timer_random(void) {
+    timer_rng ^= timer_rng << 13;
+    timer_rng ^= timer_rng >> 17;
+    timer_rng ^= timer_rng << 5;
+    return timer_rng;
+}
+
+/*-------------------------------------------------------------------------
+ * Function: timer_restart
+ * Purpose: Start a timer with a random delay, remember when it is due
+ * Parameters: id - timer
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+static void timer_restart(uint16_t id) {
+    uint32_t ms = timer_random() % TIMER_BENCH_MAX_MS;
+
+    timer_due[id] = TPM0_Micros() + ms * 1000;
+    Timer_Start(id, ms);
+}
+
+/*-------------------------------------------------------------------------
+ * Function: timer_expired
+ * Purpose: Timer callback - check the expiry time, start again
+ * Parameters: id - timer
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+static void timer_expired(uint16_t id) {
+    int32_t late = (int32_t)(TPM0_Micros() - timer_due[id]);
+
+    if (late < 0) {
+        timer_early++;
+    } else if (late > timer_late_max) {
+        timer_late_max = late;
+    }
+    timer_fired++;
+    timer_restart(id);
+}
+
+static void timer_notify(void) {
+    timer_signalled = 1;
+}
+
+/*-------------------------------------------------------------------------
+ * Function: bench_timers
+ * Purpose: Run the wheel on the simulated TPM0 with a growing number of
+ *          timers. Costs are host CPU time including the simulated
+ *          register accesses; columns that stay flat as the number of
+ *          timers grows mean O(1).
+ * Parameters: None
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+static void bench_timers(void) {
+    uint8_t bad = 0;
+
+    Init_TPM0();
+    printf("timers: cost [ns], %u s simulated per row\n", TIMER_BENCH_MS / 1000);
+    printf("running   start   stop  process   calls  expired  max late [us]  early\n");
+    for (uint32_t n = TIMER_BENCH_MIN; n <= TIMER_MAX; n *= 4) {
+        struct timespec t0, t1;
+        double start_ns, stop_ns, process_ns = 0;
+        uint32_t end, calls = 0;
+
+        Timer_Init(timer_notify);
+        for (uint32_t i = 0; i < n; i++) {
+            timer_restart(Timer_Create(timer_expired));
+        }
+
+        // Restart and stop random running timers, the wheel stays full
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        for (uint32_t i = 0; i < TIMER_BENCH_OPS; i++) {
+            timer_restart(timer_random() % n);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        start_ns = ((t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec)) / TIMER_BENCH_OPS;
+        stop_ns = 0;
+        for (uint32_t done = 0; done < TIMER_BENCH_OPS; done += n / 2) {
+            uint32_t first = timer_random() % n;
+
+            clock_gettime(CLOCK_MONOTONIC, &t0);
+            for (uint32_t i = 0; i < n / 2; i++) {
+                Timer_Stop((first + i) % n);
+            }
+            clock_gettime(CLOCK_MONOTONIC, &t1);
+            stop_ns += (t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec);
+            for (uint32_t i = 0; i < n / 2; i++) {
+                timer_restart((first + i) % n);
+            }
+        }
+        stop_ns /= TIMER_BENCH_OPS;
+
+        // Let them expire: idle until the compare interrupt, then the
+        // deferred processing, as the timer task does on the target
+        timer_fired = timer_early = 0;
+        timer_late_max = 0;
+        end = TPM0_Micros() + TIMER_BENCH_MS * 1000u;
+        while ((int32_t)(TPM0_Micros() - end) < 0) {
+            HAL_IDLE();
+            if (timer_signalled) {
+                timer_signalled = 0;
+                clock_gettime(CLOCK_MONOTONIC, &t0);
+                Timer_Process();
+                clock_gettime(CLOCK_MONOTONIC, &t1);
+                process_ns += (t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec);
+                calls++;
+            }
+        }
+        process_ns = calls ? process_ns / calls : 0;
+
+        // Due after the delay, processed within the 1 ms tick
+        bad |= (timer_early != 0 || timer_late_max > TIMER_BENCH_LATE_US || timer_fired == 0);
+        printf("%7u  %6.1f %6.1f  %7.1f  %6u  %7u  %13d  %5u\n", n,
+               start_ns, stop_ns, process_ns, calls, timer_fired, timer_late_max, timer_early);
+    }
+    if (bad) {
+        printf("timers: FAILED - a timer expired early, late or never\n");
+        exit(1);
+    }
+}
+
+/*-------------------------------------------------------------------------
+ * Function: fsm_reference
+ * Purpose: Reference - the transition rules written out as conditions
+ * Parameters:
+ * s - state
+ * ev - event
+ * Returns: uint8_t - next state
+ *-------------------------------------------------------------------------*/
+static uint8_t fsm_reference(uint8_t s, uint8_t ev) {
+    if (s == FSM_ADMIN) {
+        return (ev == FSM_EV_NEW_CODE || ev == FSM_EV_TIMEOUT) ? FSM_DISARMED : FSM_ADMIN;
+    }
+    if (ev == FSM_EV_ADMIN) {
+        return FSM_ADMIN;
+    }
+    if (s == FSM_DISARMED) {
+        return (ev == FSM_EV_CODE || ev == FSM_EV_DURESS || ev == FSM_EV_ARM) ? FSM_EXIT_DELAY : s;
+    }
+    if (ev == FSM_EV_CODE || ev == FSM_EV_DURESS) {
+        return FSM_DISARMED;
+    }
+    if (s == FSM_ARMED && ev == FSM_EV_TRIGGER) {
+        return FSM_ENTRY_DELAY;
+    }
+    if (s == FSM_EXIT_DELAY && ev == FSM_EV_TIMEOUT) {
+        return FSM_ARMED;
+    }
+    if (s == FSM_ENTRY_DELAY && ev == FSM_EV_TIMEOUT) {
+        return FSM_ALARM;
+    }
+    return s;
+}
+
+// Reference outputs of a state
+static uint8_t fsm_reference_outputs(uint8_t s) {
+    uint8_t out = 0;
+
+    if (s == FSM_EXIT_DELAY || s == FSM_ARMED || s == FSM_ENTRY_DELAY || s == FSM_ALARM) {
+        out |= FSM_OUT_RANGING;
+    }
+    if (s == FSM_ALARM) {
+        out |= FSM_OUT_SIREN;
+    } else if (s == FSM_ADMIN) {
+        out |= FSM_OUT_ADMIN_LED;
+    } else if (s != FSM_DISARMED) {
+        out |= FSM_OUT_ARMED_LED;
+    }
+    return out;
+}
+
+// Reference delay of a state, 0 if it has none
+static uint32_t fsm_reference_delay(uint8_t s) {
+    return (s == FSM_EXIT_DELAY) ? EXIT_DELAY_MS :
+           (s == FSM_ENTRY_DELAY) ? ENTRY_DELAY_MS :
+           (s == FSM_ADMIN) ? ADMIN_TIMEOUT_MS : 0;
+}
+
+static void fsm_notify(void) {
+    fsm_notified++;
+}
+
+/*-------------------------------------------------------------------------
+ * Function: fsm_paths
+ * Purpose: Breadth-first search on the reference model for the
+ *          shortest event path from power-up (armed) to every state
+ * Parameters: None
+ * Returns: uint8_t - number of states reached
+ *-------------------------------------------------------------------------*/
+static uint8_t fsm_paths(void) {
+    uint8_t queue[FSM_STATES], seen = 0, head = 0, tail = 0;
+
+    memset(fsm_path_len, 0xFF, sizeof(fsm_path_len));
+    fsm_path_len[FSM_ARMED] = 0;
+    queue[tail++] = FSM_ARMED;
+    while (head < tail) {
+        uint8_t s = queue[head++];
+
+        seen++;
+        for (uint8_t ev = 0; ev < FSM_EVENTS; ev++) {
+            uint8_t next = fsm_reference(s, ev);
+
+            if (fsm_path_len[next] != 0xFF || fsm_path_len[s] + 1 > FSM_PATH_MAX) {
+                continue;
+            }
+            memcpy(fsm_path[next], fsm_path[s], fsm_path_len[s]);
+            fsm_path[next][fsm_path_len[s]] = ev;
+            fsm_path_len[next] = fsm_path_len[s] + 1;
+            queue[tail++] = next;
+        }
+    }
+    return seen;
+}
+
+/*-------------------------------------------------------------------------
+ * Function: fsm_feed
+ * Purpose: Feed one event. A timeout in a state with a delay is not
+ *          fed but waited for: idle until the delay timer expires, as
+ *          the timer task does on the target.
+ * Parameters: ev - event
+ * Returns: uint32_t - time waited [us], 0 if fed
+ *-------------------------------------------------------------------------*/
+static uint32_t fsm_feed(uint8_t ev) {
+    uint8_t s = AlarmFsm_State();
+    uint32_t start, limit;
+
+    if (ev != FSM_EV_TIMEOUT || fsm_reference_delay(s) == 0) {
+        AlarmFsm_Event(ev);
+        return 0;
+    }
+    start = TPM0_Micros();
+    limit = (fsm_reference_delay(s) + 1000) * 1000u;
+    while (AlarmFsm_State() == s && TPM0_Micros() - start < limit) {
+        HAL_IDLE();
+        if (timer_signalled) {
+            timer_signalled = 0;
+            Timer_Process();
+        }
+    }
+    return TPM0_Micros() - start;
+}
+
+/*-------------------------------------------------------------------------
+ * Function: bench_fsm
+ * Purpose: Exhaustive state/event check of the alarm state machine.
+ *          For each state and event the machine is restarted, driven
+ *          along the shortest path to the state, then given the event.
+ * Parameters: None
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+static void bench_fsm(void) {
+    uint16_t checked = 0, failed = 0;
+    uint8_t reached;
+
+    // The state machine creates the first timer of the pool
+    Init_TPM0();
+    Timer_Init(timer_notify);
+    reached = fsm_paths();
+    printf("fsm: %u of %u states reachable from power-up\n", reached, FSM_STATES);
+
+    for (uint8_t s = 0; s < FSM_STATES; s++) {
+        for (uint8_t ev = 0; ev < FSM_EVENTS; ev++) {
+            uint8_t expect = fsm_reference(s, ev);
+            uint8_t next, out, running, ok;
+            uint32_t waited, notified;
+
+            if (fsm_path_len[s] == 0xFF) {
+                continue;
+            }
+            AlarmFsm_Init(FSM_ARMED, fsm_notify);
+            for (uint8_t i = 0; i < fsm_path_len[s]; i++) {
+                fsm_feed(fsm_path[s][i]);
+            }
+            notified = fsm_notified;
+            waited = fsm_feed(ev);
+            next = AlarmFsm_State();
+            out = AlarmFsm_Outputs();
+            running = Timer_Active(0);
+
+            // Timeouts due after the delay, within the 1 ms tick
+            ok = (next == expect && out == fsm_reference_outputs(expect) &&
+                  running == (fsm_reference_delay(expect) != 0) &&
+                  fsm_notified - notified == (expect != s));
+            if (waited != 0) {
+                ok &= (waited >= fsm_reference_delay(s) * 1000u &&
+                       waited <= fsm_reference_delay(s) * 1000u + TIMER_BENCH_LATE_US);
+            }
+            checked++;
+            if (!ok) {
+                failed++;
+                printf("fsm: %-11s + %-8s -> %-11s outputs %02X timer %u, expected %s\n",
+                       fsm_state_names[s], fsm_event_names[ev], fsm_state_names[next],
+                       out, running, fsm_state_names[expect]);
+            } else if (waited != 0) {
+                printf("fsm: %-11s + %-8s -> %-11s after %.3f ms\n", fsm_state_names[s],
+                       fsm_event_names[ev], fsm_state_names[next], waited / 1000.0);
+            }
+        }
+    }
+    printf("fsm: %u of %u state/event pairs checked, %u failed\n",
+           checked, FSM_STATES * FSM_EVENTS, failed);
+    if (failed || checked != FSM_STATES * FSM_EVENTS) {
+        printf("fsm: FAILED\n");
+        exit(1);
+    }
+}
+
+/*-------------------------------------------------------------------------
+ * Function: vib_noise
+ * Purpose: Uniform noise, same sequence every run
+ * Parameters: mg - peak amplitude
+ * Returns: double - -mg .. mg
+ *-------------------------------------------------------------------------*/
+static double vib_noise(double mg) {
+    vib_rng = vib_rng * 1664525u + 1013904223u;
+    return mg * ((double)(vib_rng >> 8) / (1u << 23) - 1.0);
+}
+
+// Damped ring of an impact, t seconds after it
+static double vib_ring(double t, double mg, double hz, double tau) {
+    return (t < 0) ? 0 : mg * model_sin(2 * MODEL_PI * hz * t) * (1.0 - t / tau > 0 ? 1.0 - t / tau : 0);
+}
+
+/*-------------------------------------------------------------------------
+ * Function: vib_signal
+ * Purpose: One sample of a signal vector, every vector has sensor noise
+ *          (+/-2 mg) and gravity
+ * Parameters:
+ * vec - VEC_xxx
+ * n - sample number at 800 Hz
+ * mg - X/Y/Z acceleration
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+static void vib_signal(uint8_t vec, uint32_t n, double mg[3]) {
+    double t = (double)n / VIB_ODR_HZ;
+    double w = 2 * MODEL_PI * t;
+
+    mg[0] = vib_noise(2);
+    mg[1] = vib_noise(2);
+    mg[2] = 1000 + vib_noise(2);
+    switch (vec) {
+    case VEC_TILT:
+        mg[0] += 707;
+        mg[2] -= 293;
+        break;
+    case VEC_RUMBLE:
+        mg[2] += 150 * model_sin(w * 12) + 100 * model_sin(w * 19 + 1) + 50 * model_sin(w * 30 + 2);
+        mg[0] += 60 * model_sin(w * 15) + vib_noise(10);
+        break;
+    case VEC_FOOTSTEPS: {
+        double step = t - 0.5 * (uint32_t)(t / 0.5);
+
+        mg[2] += vib_ring(step, 200, 15, 0.2);
+        break;
+    }
+    case VEC_SLAM:
+        mg[0] += vib_ring(t - 1.0, 900, 8, 0.5) + vib_ring(t - 1.0, 150, 60, 0.1);
+        break;
+    case VEC_PRYING:
+        // Scraping: tones with drifting phases over the high band
+        for (uint8_t k = 0; k < 5; k++) {
+            mg[k % 2] += 18 * model_sin(w * (150 + 50 * k) + vib_noise(0.5) + k);
+        }
+        break;
+    case VEC_DRILL:
+        mg[1] += 80 * model_sin(w * 250) + 25 * model_sin(w * 500) + vib_noise(15);
+        break;
+    case VEC_SAW:
+        mg[0] += 30 * model_sin(w * 100) * (0.5 + 0.5 * model_sin(w * 3));
+        break;
+    }
+}
+
+/*-------------------------------------------------------------------------
+ * Function: vib_push_mg
+ * Purpose: Quantise one sample as the MMA8451Q does (+/-2 g, 14 bits)
+ *          and feed it to the analyser
+ * Parameters: mg - X/Y/Z acceleration
+ * Returns: uint8_t - Vib_Push result
+ *-------------------------------------------------------------------------*/
+static uint8_t vib_push_mg(const double mg[3]) {
+    int16_t c[3];
+
+    for (uint8_t i = 0; i < 3; i++) {
+        double v = mg[i] * ACCEL_COUNTS_PER_G / 1000;
+
+        c[i] = (int16_t)(v > 8191 ? 8191 : (v < -8192 ? -8192 : v));
+    }
+    return Vib_Push(c[0], c[1], c[2]);
+}
+
+/*-------------------------------------------------------------------------
+ * Function: vib_file
+ * Purpose: Classify a recording, one "x y z" sample in counts per line
+ *          at 800 Hz, and print every window
+ * Parameters: path - recording
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+static void vib_file(const char* path) {
+    FILE* f = fopen(path, "r");
+    int x, y, z;
+    uint32_t windows = 0, tamper = 0, ambient = 0;
+
+    if (f == 0) {
+        perror(path);
+        exit(2);
+    }
+    Vib_Init();
+    printf("window  time [s]   low [counts^2]  high [counts^2]  class\n");
+    while (fscanf(f, "%d %d %d", &x, &y, &z) == 3) {
+        uint8_t r = Vib_Push((int16_t)x, (int16_t)y, (int16_t)z);
+
+        if (r == VIB_NONE) {
+            continue;
+        }
+        tamper += (r & VIB_TAMPER) != 0;
+        ambient += (r & VIB_AMBIENT) != 0;
+        printf("%6u  %8.2f  %15u  %15u  %s\n", windows, (double)windows * VIB_WINDOW / VIB_ODR_HZ,
+               Vib_Last()->low, Vib_Last()->high,
+               (r & VIB_TAMPER) ? "tamper" : (r & VIB_AMBIENT) ? "ambient" : "-");
+        windows++;
+    }
+    fclose(f);
+    printf("vibration: %u windows, %u tamper, %u ambient\n", windows, tamper, ambient);
+}
+
+/*-------------------------------------------------------------------------
+ * Function: bench_vibration
+ * Purpose: Check the analyser on tones and signal vectors, time it
+ * Parameters: None
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+static void bench_vibration(void) {
+    static const double tone_hz[] = { 25, 37.5, 50, 100, 150, 200, 250, 300, 350 };
+    const char* file = getenv("ALARM_VIB_FILE");
+    uint8_t bad = 0;
+    struct timespec t0, t1;
+    double ns;
+
+    if (file) {
+        vib_file(file);
+        return;
+    }
+
+    // Tones at each bin on X with gravity on Z: band energy = amplitude^2
+    printf("vibration: %u-sample windows, 100 mg tone on X, 1 g on Z\n", VIB_WINDOW);
+    printf("tone [Hz]   low [counts^2]  high [counts^2]  error [%%]\n");
+    for (uint8_t i = 0; i < sizeof(tone_hz) / sizeof(tone_hz[0]); i++) {
+        double expect = (double)ACCEL_MG_TO_COUNTS(100) * ACCEL_MG_TO_COUNTS(100);
+        double hz = tone_hz[i];
+        double err;
+        uint32_t band;
+
+        Vib_Init();
+        for (uint32_t n = 0; n < VIB_WINDOW; n++) {
+            double mg[3] = { 100 * model_sin(2 * MODEL_PI * hz * n / VIB_ODR_HZ), 0, 1000 };
+
+            vib_push_mg(mg);
+        }
+        band = (hz <= 50) ? Vib_Last()->low : Vib_Last()->high;
+        err = 100.0 * (band - expect) / expect;
+        bad |= (err > VIB_TONE_TOLERANCE || err < -VIB_TONE_TOLERANCE);
+        printf("%9.1f  %15u  %15u  %9.2f\n", hz, Vib_Last()->low, Vib_Last()->high, err);
+    }
+
+    // Signal vectors, windows confirmed 2 of 3 as in the firmware
+    printf("vector                            windows  tamper  ambient  confirmed  expected\n");
+    for (uint8_t v = 0; v < VEC_COUNT; v++) {
+        uint32_t windows = 0, tamper = 0, ambient = 0, confirmed = 0;
+        uint8_t history = 0;
+        uint8_t ok;
+
+        Vib_Init();
+        vib_rng = 1;
+        for (uint32_t n = 0; n < VIB_VECTOR_S * VIB_ODR_HZ; n++) {
+            double mg[3];
+            uint8_t r;
+
+            vib_signal(v, n, mg);
+            if ((r = vib_push_mg(mg)) == VIB_NONE) {
+                continue;
+            }
+            windows++;
+            tamper += (r & VIB_TAMPER) != 0;
+            ambient += (r & VIB_AMBIENT) != 0;
+            history = (uint8_t)((history << 1) | ((r & VIB_TAMPER) != 0)) & 7;
+            confirmed += (history == 3 || history == 5 || history == 6 || history == 7);
+        }
+        ok = vib_vectors[v].tamper ? (confirmed > 0) : (tamper == 0);
+        bad |= !ok;
+        printf("%-32s  %7u  %6u  %7u  %9u  %-8s%s\n", vib_vectors[v].name, windows, tamper,
+               ambient, confirmed, vib_vectors[v].tamper ? "tamper" : "none",
+               ok ? "" : "  FAILED");
+    }
+
+    // Cost per sample on the host CPU
+    Vib_Init();
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (uint32_t n = 0; n < VIB_COST_SAMPLES; n++) {
+        sink += Vib_Push((int16_t)(n & 0x3FF), (int16_t)(n >> 3), 4096);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    ns = ((t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec)) / VIB_COST_SAMPLES;
+    printf("vibration: %.1f ns per sample on the host (%.4f%% of the 1250 us sample period)\n",
+           ns, ns / 12500.0);
+    if (bad) {
+        printf("vibration: FAILED\n");
+        exit(1);
+    }
+}
+
+/*-------------------------------------------------------------------------
+ * Function: motion_detects
+ * Purpose: Calibrate at rest, then push; report which test sees it
+ * Parameters:
+ * g - resting reading [mg]
+ * push - added acceleration [mg]
+ * old - 1 for the former per-axis absolute test
+ * Returns: uint8_t - 1 if any sample of the push exceeds the threshold
+ *-------------------------------------------------------------------------*/
+static uint8_t motion_detects(const double g[3], const double push[3], uint8_t old) {
+    uint8_t hit = 0;
+
+    Motion_Init();
+    for (uint32_t n = 0; n < MOTION_CAL_SAMPLES + MOTION_PUSH_SAMPLES * 2; n++) {
+        uint8_t pushing = (n >= MOTION_CAL_SAMPLES + MOTION_PUSH_SAMPLES);
+        int16_t c[3];
+
+        for (uint8_t i = 0; i < 3; i++) {
+            double v = (g[i] + (pushing ? push[i] : 0)) * ACCEL_COUNTS_PER_G / 1000;
+
+            c[i] = (int16_t)(v > 8191 ? 8191 : (v < -8192 ? -8192 : v));
+        }
+        if (old) {
+            // Former test: any axis beyond the limit in absolute value
+            int16_t limit = ACCEL_MG_TO_COUNTS(MOTION_OLD_MG);
+
+            for (uint8_t i = 0; i < 3; i++) {
+                hit |= pushing && (c[i] > limit || c[i] < -limit);
+            }
+        } else {
+            hit |= Motion_Push(c[0], c[1], c[2]) > MOTION_THRESHOLD_SQ;
+        }
+    }
+    return hit;
+}
+
+/*-------------------------------------------------------------------------
+ * Function: motion_min_push
+ * Purpose: Smallest push (in MOTION_PUSH_STEP_MG steps) that is detected
+ * Parameters:
+ * g - resting reading [mg]
+ * dir - push direction, unit vector
+ * old - 1 for the former test
+ * Returns: uint32_t - push [mg], 0 if none up to MOTION_PUSH_MAX_MG
+ *-------------------------------------------------------------------------*/
+static uint32_t motion_min_push(const double g[3], const double dir[3], uint8_t old) {
+    for (uint32_t mg = MOTION_PUSH_STEP_MG; mg <= MOTION_PUSH_MAX_MG; mg += MOTION_PUSH_STEP_MG) {
+        double push[3] = { dir[0] * mg, dir[1] * mg, dir[2] * mg };
+
+        if (motion_detects(g, push, old)) {
+            return mg;
+        }
+    }
+    return 0;
+}
+
+/*-------------------------------------------------------------------------
+ * Function: bench_motion
+ * Purpose: Show that the motion threshold no longer depends on the
+ *          mounting orientation, and time the gravity removal
+ * Parameters: None
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+static void bench_motion(void) {
+    static const struct {
+        const char* name;
+        double g[3];
+    } mounts[] = {
+        { "flat (Z up)", { 0, 0, 1000 } },
+        { "upside down", { 0, 0, -1000 } },
+        { "wall (X up)", { 1000, 0, 0 } },
+        { "wall (Y down)", { 0, -1000, 0 } },
+        { "tilted 45 deg", { 707, 0, 707 } },
+        { "tilted 5 deg", { 87, 0, 996 } },
+    };
+    static const double dirs[6][3] = {
+        { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 }
+    };
+    uint32_t lo = UINT32_MAX, hi = 0;
+    uint8_t missed = 0;
+    struct timespec t0, t1;
+    double ns;
+
+    printf("motion: smallest push detected [mg], +X -X +Y -Y +Z -Z (0 = none up to %u mg)\n",
+           MOTION_PUSH_MAX_MG);
+    printf("mounting         gravity removed, |a| > %u mg (squared)   per axis |a| > %u mg\n",
+           MOTION_THRESHOLD_MG, MOTION_OLD_MG);
+    for (uint8_t m = 0; m < sizeof(mounts) / sizeof(mounts[0]); m++) {
+        printf("%-15s ", mounts[m].name);
+        for (uint8_t old = 0; old < 2; old++) {
+            for (uint8_t d = 0; d < 6; d++) {
+                uint32_t mg = motion_min_push(mounts[m].g, dirs[d], old);
+
+                printf(" %5u", mg);
+                if (!old) {
+                    missed |= (mg == 0);
+                    lo = (mg < lo) ? mg : lo;
+                    hi = (mg > hi) ? mg : hi;
+                }
+            }
+            printf("   ");
+        }
+        printf("\n");
+    }
+
+    // Calibration, high-pass and squared magnitude per sample
+    Motion_Init();
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (uint32_t n = 0; n < MOTION_COST_SAMPLES; n++) {
+        sink += Motion_Push((int16_t)(n & 0x3FF), (int16_t)(n >> 3), 4096);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    ns = ((t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec)) / MOTION_COST_SAMPLES;
+    printf("motion: %u..%u mg in every direction and mounting, %.1f ns per sample on the host\n",
+           lo, hi, ns);
+    if (missed || hi - lo > MOTION_SPREAD_MG) {
+        printf("motion: FAILED - threshold depends on the direction or mounting\n");
+        exit(1);
+    }
+}
+
+/*-------------------------------------------------------------------------
+ * Function: bench_i2c
+ * Purpose: Read the same accelerometer registers through the blocking
+ *          wrapper and through the queue on the simulated I2C0. The
+ *          wrapper holds the main loop in its wait for the whole
+ *          transfer; with the queue the main loop sleeps or runs tasks
+ *          while the I2C0 handler moves one byte per interrupt.
+ * Parameters: None
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+static void bench_i2c(void) {
+    static const uint8_t sizes[] = { 1, 7, I2C_BENCH_MAX };    // Status, one sample, FIFO batch
+    static uint8_t data[2][I2C_BENCH_MAX];
+    double freed_us[3];
+    uint8_t bad = 0;
+
+    Init_TPM0();
+    I2C_Init();
+    printf("i2c:    accelerometer reads on the simulated I2C0, main loop time [us]\n");
+    printf("bytes  transfer    blocking: waiting  polls    queued: waiting  polls  interrupts\n");
+    for (uint8_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        I2C_Xfer xfer = { 0 };
+        uint64_t t0, polls;
+        uint32_t irqs;
+        double block_us, block_polls, xfer_us, queue_us, queue_polls;
+        uint8_t err;
+
+        // Blocking wrapper: the caller polls until the last byte
+        t0 = host_now;
+        polls = host_stats.polls;
+        err = I2C_ReadRegBlock(I2C_BENCH_ADDR, I2C_BENCH_REG, sizes[i], data[0]);
+        block_us = HOST_TO_US(host_now - t0);
+        block_polls = host_stats.polls - polls;
+
+        // Queue: submit, then the main loop is free until the callback;
+        // here it sleeps, so any time not spent in WFI was taken from it
+        xfer.address = I2C_BENCH_ADDR;
+        xfer.reg = I2C_BENCH_REG;
+        xfer.flags = I2C_XFER_REG | I2C_XFER_READ;
+        xfer.size = sizes[i];
+        xfer.data = data[1];
+        t0 = host_now;
+        polls = host_stats.polls;
+        irqs = host_stats.irq[I2C0_IRQn];
+        queue_us = HOST_TO_US(host_stats.idle);
+        err |= I2C_Submit(&xfer);
+        while (!xfer.done) {
+            HAL_IDLE();
+        }
+        err |= xfer.error;
+        xfer_us = HOST_TO_US(host_now - t0);
+        queue_us = xfer_us - (HOST_TO_US(host_stats.idle) - queue_us);
+        queue_polls = host_stats.polls - polls;
+        irqs = host_stats.irq[I2C0_IRQn] - irqs;
+
+        // Same bytes both ways, the queue never waits, the wrapper waits
+        // for the whole transfer
+        bad |= (err != 0 || memcmp(data[0], data[1], sizes[i]) != 0 ||
+                queue_polls != 0 || block_us < xfer_us * 0.9);
+        freed_us[i] = block_us - queue_us;
+        printf("%5u  %8.1f    %16.1f %6.0f    %14.1f %6.0f  %10u\n", sizes[i], xfer_us,
+               block_us, block_polls, queue_us, queue_polls, irqs);
+    }
+    printf("i2c:    main loop time freed per read: %.1f us per sample (%.1f ms/s at 800 Hz),"
+           " %.1f us per FIFO batch\n", freed_us[1], freed_us[1] * 800 / 1000, freed_us[2]);
+    if (bad) {
+        printf("i2c:    FAILED - reads differ, failed or the queue waited\n");
+        exit(1);
+    }
+}
+
+/*-------------------------------------------------------------------------
+ * Function: accel_old_path
+ * Purpose: Reference - the former detection in main(): each axis to
+ *          double in g, fabs() against the threshold
+ * Parameters: raw - OUT_X_MSB of the sample
+ * Returns: uint8_t - 1 if any axis exceeds the threshold
+ *-------------------------------------------------------------------------*/
+static uint8_t accel_old_path(const uint8_t* raw) {
+    double x = ((double)((int16_t)((raw[0] << 8) | raw[1]) >> 2) / (4096 >> 0));
+    double y = ((double)((int16_t)((raw[2] << 8) | raw[3]) >> 2) / (4096 >> 0));
+    double z = ((double)((int16_t)((raw[4] << 8) | raw[5]) >> 2) / (4096 >> 0));
+
+    return (fabs(x) > ACCEL_OLD_G || fabs(y) > ACCEL_OLD_G || fabs(z) > ACCEL_OLD_G);
+}
+
+/*-------------------------------------------------------------------------
+ * Function: accel_fixed_path
+ * Purpose: The same per-axis test on raw counts, threshold in counts at
+ *          compile time
+ * Parameters: raw - OUT_X_MSB of the sample
+ * Returns: uint8_t - 1 if any axis exceeds the threshold
+ *-------------------------------------------------------------------------*/
+static uint8_t accel_fixed_path(const uint8_t* raw) {
+    const int16_t limit = ACCEL_MG_TO_COUNTS(MOTION_OLD_MG);
+    AccelSample s;
+
+    Accel_Decode(raw, &s);
+    return (s.x > limit || s.x < -limit || s.y > limit || s.y < -limit ||
+            s.z > limit || s.z < -limit);
+}
+
+/*-------------------------------------------------------------------------
+ * Function: accel_motion_path
+ * Purpose: The current test: gravity removed, squared magnitude
+ * Parameters: raw - OUT_X_MSB of the sample
+ * Returns: uint8_t - 1 if the dynamic acceleration exceeds the threshold
+ *-------------------------------------------------------------------------*/
+static uint8_t accel_motion_path(const uint8_t* raw) {
+    AccelSample s;
+
+    Accel_Decode(raw, &s);
+    return Motion_Push(s.x, s.y, s.z) > MOTION_THRESHOLD_SQ;
+}
+
+/*-------------------------------------------------------------------------
+ * Function: accel_m0_cost
+ * Purpose: Count what one sample costs a path on the M0+, which has no
+ *          FPU: soft-float library calls, and integer ALU and compare
+ *          operations as written in C. Loads, stores, branches and call
+ *          overhead are not counted. The || chains stop at the first axis
+ *          over the limit, as the compiled code does.
+ * Parameters:
+ * path - 0 former double, 1 counts per axis, 2 gravity removed
+ * raw - OUT_X_MSB of the sample
+ * calls - incremented by the soft-float calls
+ * ops - incremented by the integer operations
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+static void accel_m0_cost(uint8_t path, const uint8_t* raw, uint32_t* calls, uint32_t* ops) {
+    const int16_t limit = ACCEL_MG_TO_COUNTS(MOTION_OLD_MG);
+    AccelSample s;
+    int16_t axis[3];
+
+    Accel_Decode(raw, &s);
+    axis[0] = s.x;
+    axis[1] = s.y;
+    axis[2] = s.z;
+    *ops += 3 * 3;                          // Decode per axis: shift, or, arithmetic shift
+    if (path == 2) {
+        // Per axis: subtract, shift, multiply, add, then the high-pass
+        // shift, subtract, shift, add; one compare on the sum
+        *ops += 3 * 8 + 1;
+        return;
+    }
+    if (path == 0) {
+        *calls += 3 * 2;                    // __aeabi_i2d, __aeabi_dmul (/ 4096 is * 2^-12)
+    }
+    for (uint8_t a = 0; a < 3; a++) {
+        if (path == 0) {
+            (*calls)++;                     // __aeabi_dcmpgt
+            (*ops)++;                       // fabs() clears the sign bit
+            if (fabs((double)axis[a] / 4096) > ACCEL_OLD_G) {
+                break;
+            }
+        } else {
+            (*ops)++;
+            if (axis[a] > limit) {
+                break;
+            }
+            (*ops)++;
+            if (axis[a] < -limit) {
+                break;
+            }
+        }
+    }
+}
+
+/*-------------------------------------------------------------------------
+ * Function: accel_time
+ * Purpose: Run one detection path over the recording
+ * Parameters:
+ * path - detection function
+ * hits - samples flagged in one pass
+ * Returns: double - nanoseconds per sample
+ *-------------------------------------------------------------------------*/
+static double accel_time(uint8_t (*path)(const uint8_t* raw), uint32_t* hits) {
+    struct timespec t0, t1;
+
+    Motion_Init();
+    *hits = 0;
+    for (uint32_t n = 0; n < ACCEL_REC_SAMPLES; n++) {
+        *hits += path(accel_rec[n]);
+    }
+    Motion_Init();
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (uint32_t r = 0; r < ACCEL_BENCH_ROUNDS; r++) {
+        for (uint32_t n = 0; n < ACCEL_REC_SAMPLES; n++) {
+            sink += path(accel_rec[n]);
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    return ((t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec)) /
+           ((double)ACCEL_BENCH_ROUNDS * ACCEL_REC_SAMPLES);
+}
+
+/*-------------------------------------------------------------------------
+ * Function: bench_accel
+ * Purpose: Compare the former floating-point motion test with the
+ *          fixed-point ones on a recording of the vibration signal
+ *          vectors followed by a 2 g shake
+ * Parameters: None
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+static void bench_accel(void) {
+    static const struct {
+        const char* name;
+        uint8_t (*path)(const uint8_t* raw);
+    } paths[] = {
+        { "double, fabs per axis (former)", accel_old_path },
+        { "counts per axis", accel_fixed_path },
+        { "gravity removed, squared", accel_motion_path },
+    };
+    const int16_t limit = ACCEL_MG_TO_COUNTS(MOTION_OLD_MG);
+    uint32_t hits[3], differ = 0, n = 0;
+    uint32_t calls[3] = { 0 }, ops[3] = { 0 };
+
+    // Recording: every signal vector, then shaking along X
+    for (uint8_t vec = 0; vec <= VEC_COUNT; vec++) {
+        for (uint32_t i = 0; i < VIB_ODR_HZ * VIB_VECTOR_S; i++, n++) {
+            double mg[3];
+
+            vib_signal(vec < VEC_COUNT ? vec : VEC_REST, i, mg);
+            if (vec == VEC_COUNT) {
+                mg[0] += 2000 * model_sin(2 * MODEL_PI * 4 * i / VIB_ODR_HZ);
+            }
+            for (uint8_t a = 0; a < 3; a++) {
+                double v = mg[a] * ACCEL_COUNTS_PER_G / 1000;
+                int16_t c = (int16_t)(v > 8191 ? 8191 : (v < -8192 ? -8192 : v));
+
+                accel_rec[n][2 * a] = (uint8_t)((uint16_t)(c << 2) >> 8);
+                accel_rec[n][2 * a + 1] = (uint8_t)(c << 2);
+            }
+        }
+    }
+
+    // The counts test must match the double test for every 14-bit value
+    for (int32_t c = -8192; c <= 8191; c++) {
+        differ += (fabs((double)c / 4096) > ACCEL_OLD_G) != (c > limit || c < -limit);
+    }
+
+    printf("accel:  motion test on %u recorded samples (%u signal vectors, 2 g shake)\n",
+           ACCEL_REC_SAMPLES, VEC_COUNT);
+    printf("                                  host       M0+ per sample\n");
+    printf("path                              ns/sample  soft-float calls  int ops  flagged\n");
+    for (uint8_t i = 0; i < 3; i++) {
+        double ns = accel_time(paths[i].path, &hits[i]);
+
+        for (uint32_t k = 0; k < ACCEL_REC_SAMPLES; k++) {
+            accel_m0_cost(i, accel_rec[k], &calls[i], &ops[i]);
+        }
+        printf("%-32s  %9.2f  %16.2f  %7.2f  %7u\n", paths[i].name, ns,
+               (double)calls[i] / ACCEL_REC_SAMPLES, (double)ops[i] / ACCEL_REC_SAMPLES, hits[i]);
+    }
+    printf("accel:  former per-axis limit %.1f g = %d counts, %u of 16384 values differ\n",
+           ACCEL_OLD_G, limit, differ);
+    printf("accel:  the host has an FPU, the M0+ has none: its cost is in the calls;\n"
+           "        int ops exclude loads, stores, branches and call overhead\n");
+    if (differ != 0 || hits[0] != hits[1] || hits[0] == 0) {
+        printf("accel:  FAILED - the counts test does not reproduce the double test\n");
+        exit(1);
+    }
+}
+
+/*-------------------------------------------------------------------------
+ * Function: echo_old_cm
+ * Purpose: Reference - the former distance formula in main(), floats
+ * Parameters:
+ * ticks - captured echo length
+ * ps - TPM1 prescaler setting
+ * Returns: float - distance [cm]
+ *-------------------------------------------------------------------------*/
+static float echo_old_cm(uint16_t ticks, uint8_t ps) {
+    static const uint32_t ps_value[] = { 1, 2, 4, 8, 16, 32, 64, 128 };
+
+    echo_tick_head = 1000.0 / HOST_CLOCK_HZ;
+    echo_result = ticks;
+    echo_tick = echo_tick_head * ps_value[ps];
+    echo_result *= echo_tick;
+    echo_distance = echo_result / 58 * 1000;
+    return echo_distance;
+}
+
+/*-------------------------------------------------------------------------
+ * Function: bench_echo
+ * Purpose: Check the integer echo threshold and mm conversion for every
+ *          prescaler and capture value against the exact distance
+ *          ticks * prescaler * 343000 / (2 * clock), kept as a fraction:
+ *          the threshold compare and the mm conversion of the integer
+ *          path and of the former float formula; time both paths
+ * Parameters: None
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+static void bench_echo(void) {
+    uint8_t bad = 0;
+
+    RCW_InitScale(HOST_CLOCK_HZ, ECHO_THRESHOLD_MM);
+    printf("echo:   %u mm threshold, TPM1 at %u Hz, every capture value 1..65535\n",
+           ECHO_THRESHOLD_MM, HOST_CLOCK_HZ);
+    printf("ps   range [mm]  limit   threshold errors       mm error    ns/echo\n");
+    printf("                [ticks]   integer   float   integer   float  integer  float\n");
+    for (uint8_t ps = 0; ps < RCW_PRESCALERS; ps++) {
+        uint32_t limit = 0, int_bad = 0, old_bad = 0;
+        double int_err = 0, old_err = 0, int_ns, old_ns;
+        struct timespec t0, t1;
+
+        for (uint32_t t = 1; t <= 0xFFFF; t++) {
+            // Exact distance num / den [mm], round trip halved, no rounding
+            uint64_t num = (uint64_t)t * ECHO_SOUND_MM_S << ps;
+            uint64_t den = (uint64_t)2 * HOST_CLOCK_HZ;
+            uint8_t close = num < (uint64_t)ECHO_THRESHOLD_MM * den;
+            float cm = echo_old_cm((uint16_t)t, ps);
+            double e;
+
+            limit += close;
+            int_bad += (RCW_InRange((uint16_t)t, ps) != close);
+            old_bad += ((cm > 0 && cm < ECHO_OLD_CM) != close);
+            if (num < (uint64_t)0xFFFF * den) {
+                uint64_t mm = (uint64_t)RCW_TicksToMm((uint16_t)t, ps) * den;
+
+                e = (double)(mm > num ? mm - num : num - mm) / den;
+                int_err = (e > int_err) ? e : int_err;
+            }
+            e = fabs(cm * 10 - (double)num / den);
+            old_err = (e > old_err) ? e : old_err;
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        for (uint32_t t = 1; t <= 0xFFFF; t++) {
+            sink += RCW_InRange((uint16_t)t, ps) + RCW_TicksToMm((uint16_t)t, ps);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        int_ns = ((t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec)) / 0xFFFF;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        for (uint32_t t = 1; t <= 0xFFFF; t++) {
+            float cm = echo_old_cm((uint16_t)t, ps);
+
+            sink += (cm > 0 && cm < ECHO_OLD_CM);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        old_ns = ((t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec)) / 0xFFFF;
+
+        bad |= (int_bad != 0 || int_err > ECHO_MM_ERROR);
+        printf("%3u  %10.0f  %6u   %7u  %6u   %7.2f  %6.2f   %6.1f  %5.1f\n", 1u << ps,
+               65535.0 * (1u << ps) * ECHO_SOUND_MM_S / 2 / HOST_CLOCK_HZ, limit, int_bad, old_bad,
+               int_err, old_err, int_ns, old_ns);
+    }
+    printf("echo:   errors against ticks * prescaler * %u / (2 * clock); the former\n"
+           "        formula assumes 58 us/cm round trip, %.0f mm/s: %.2f%% too far\n",
+           ECHO_SOUND_MM_S, 2e7 / 58, (2e7 / 58 / ECHO_SOUND_MM_S - 1) * 100);
+    printf("echo:   the host has an FPU; on the M0+ each float multiply and divide of\n"
+           "        the former formula is a soft-float library call\n");
+    if (bad) {
+        printf("echo:   FAILED - integer threshold or conversion off\n");
+        exit(1);
+    }
+}
+
+/*-------------------------------------------------------------------------
+ * Function: bench_sine
+ * Purpose: Check the folded quarter-wave lookup sample for sample against
+ *          the full table built as sin_init() did, and time both lookups
+ *          over the phase sequence of a 1 kHz tone
+ * Parameters: None
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+static void bench_sine(void) {
+    static int16_t full[SINE_TABLE_SIZE];
+    uint32_t differ = 0, ph = 0, n = 0;
+    double full_ns, fold_ns;
+    struct timespec t0, t1;
+
+    for (uint16_t i = 0; i < SINE_TABLE_SIZE; i++) {
+        full[i] = (int16_t)(model_sin((double)i * SIN_ANGLE_RAD) * SIN_AMPLITUDE);
+    }
+    for (uint32_t p = 0; p < 0x10000; p++) {
+        int16_t v = alarm_sine((uint16_t)p);      // Upper bits must wrap
+
+        if (v != full[p % SINE_TABLE_SIZE]) {
+            if (differ++ < 8) {
+                printf("sine:   phase %u: folded %d, table %d\n", p, v, full[p % SINE_TABLE_SIZE]);
+            }
+        }
+    }
+
+    // 32-bit phase stepping as the synthesizer does, 1 kHz at 8192 Hz
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (uint32_t r = 0; r < SINE_COST_ROUNDS; r++) {
+        for (uint16_t i = 0; i < SINE_TABLE_SIZE; i++, ph += 1000u << 19) {
+            sink += full[ph >> 22];
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    full_ns = ((t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec)) /
+              ((double)SINE_COST_ROUNDS * SINE_TABLE_SIZE);
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (uint32_t r = 0; r < SINE_COST_ROUNDS; r++) {
+        for (uint16_t i = 0; i < SINE_TABLE_SIZE; i++, ph += 1000u << 19, n++) {
+            sink += alarm_sine((uint16_t)(ph >> 22));
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    fold_ns = ((t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec)) / n;
+
+    printf("sine:   %u phases (every 10-bit phase, upper bits wrapping), %u differ\n",
+           0x10000u, differ);
+    printf("lookup                     ns/sample  table bytes\n");
+    printf("full table (former, RAM)   %9.2f  %11u\n", full_ns,
+           (unsigned)sizeof(full));
+    printf("quarter wave, folded       %9.2f  %11u\n", fold_ns, 257u * 2);
+    printf("sine:   the folded lookup is a call here; in the DMA refill it is inlined\n");
+    if (differ != 0) {
+        printf("sine:   FAILED - folded lookup differs from the full table\n");
+        exit(1);
+    }
+}
+
+/*-------------------------------------------------------------------------
+ * Function: filter_sample
+ * Purpose: Next test sample: +-100 noise on a random 0..600 offset,
+ *          1 in 16 new samples a spike, 1 in 4 a repeat of the previous
+ * Parameters: None
+ * Returns: int32_t - sample
+ *-------------------------------------------------------------------------*/
+static int32_t filter_sample(void) {
+    static int32_t last;
+    uint32_t r;
+
+    filter_rng = filter_rng * 1664525u + 1013904223u;
+    r = filter_rng >> 8;
+    if ((r & 3) != 0) {
+        last = (int32_t)((r >> 4) % 201) - 100 + (int32_t)((filter_rng >> 28) * 40);
+        if ((r & 0xF0) == 0) {
+            last = ((r >> 12) & 1) ? 8000 : -8000;
+        }
+    }
+    return last;
+}
+
+/*-------------------------------------------------------------------------
+ * Function: filter_sort_median
+ * Purpose: Reference - median by insertion sort of a copy of the window;
+ *          counts the sample compares and moves
+ * Parameters: n - window length
+ * Returns: int32_t - median
+ *-------------------------------------------------------------------------*/
+static int32_t filter_sort_median(uint8_t n) {
+    int32_t s[FILTER_WIN_MAX];
+
+    for (uint8_t i = 0; i < n; i++) {
+        int32_t v = filter_window[i];
+        int j = i;
+
+        for (; j > 0; j--) {
+            filter_sort_compares++;
+            if (s[j - 1] <= v) {
+                break;
+            }
+            s[j] = s[j - 1];
+            filter_sort_moves++;
+        }
+        s[j] = v;
+        filter_sort_moves++;
+    }
+    return s[n / 2];
+}
+
+/*-------------------------------------------------------------------------
+ * Function: filter_ns
+ * Purpose: Mean time of one stage update over the replayed stream; the
+ *          sort runs 1/n as many samples
+ * Parameters:
+ * med - median filter, 0 = none
+ * kofn - confirmation, 0 = none
+ * sort - window length to sort instead of the median filter, 0 = none
+ * Returns: double - nanoseconds per sample
+ *-------------------------------------------------------------------------*/
+static double filter_ns(Median_Filter* med, KofN_Filter* kofn, uint8_t sort) {
+    struct timespec t0, t1;
+    uint32_t n = sort ? FILTER_COST_SAMPLES / sort : FILTER_COST_SAMPLES;
+    uint8_t w = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (uint32_t i = 0; i < n; i++) {
+        int32_t v = filter_stream[i % FILTER_STREAM];
+
+        if (sort) {
+            filter_window[w] = v;
+            w = (w + 1 == sort) ? 0 : w + 1;
+            v = filter_sort_median(sort);
+        } else if (med) {
+            v = Median_Push(med, v);
+        }
+        sink += kofn ? KofN_Push(kofn, v > FILTER_LIMIT) : (uint32_t)v;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    return ((t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec)) / n;
+}
+
+/*-------------------------------------------------------------------------
+ * Function: bench_filter
+ * Purpose: Check the running median against a sort of the window and
+ *          k-of-n against a bit count, then time both alone and chained
+ *          as the motion and echo stages
+ * Parameters: None
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+static void bench_filter(void) {
+    uint32_t bad = 0;
+
+    for (uint32_t i = 0; i < FILTER_STREAM; i++) {
+        filter_stream[i] = filter_sample();
+    }
+
+    printf("filter: %u checked samples per filter (noise, spikes, repeats)\n",
+           FILTER_CHECK_SAMPLES);
+    printf("                                        M0+ per sample                    M0+ per sample\n");
+    printf("median window  mismatches  ns/sample  compares    swaps  sort ns/sample  compares    moves\n");
+    for (uint8_t m = 0; m < sizeof(filter_medians) / sizeof(filter_medians[0]); m++) {
+        Median_Filter* f = filter_medians[m];
+        uint32_t differ = 0;
+        double ns, sort_ns, ops[4];
+
+        Median_Init(f, 0);
+        memset(filter_window, 0, sizeof(filter_window));
+        median_compares = median_swaps = 0;
+        filter_sort_compares = filter_sort_moves = 0;
+        for (uint32_t i = 0; i < FILTER_CHECK_SAMPLES; i++) {
+            int32_t v = filter_sample();
+
+            filter_window[i % f->n] = v;
+            differ += (Median_Push(f, v) != filter_sort_median(f->n));
+        }
+        ops[0] = (double)median_compares / FILTER_CHECK_SAMPLES;
+        ops[1] = (double)median_swaps / FILTER_CHECK_SAMPLES;
+        ops[2] = (double)filter_sort_compares / FILTER_CHECK_SAMPLES;
+        ops[3] = (double)filter_sort_moves / FILTER_CHECK_SAMPLES;
+        ns = filter_ns(f, 0, 0);
+        sort_ns = filter_ns(0, 0, f->n);
+        bad += differ;
+        printf("%13u  %10u  %9.2f  %8.2f  %7.2f  %14.2f  %8.2f  %7.2f\n",
+               f->n, differ, ns, ops[0], ops[1], sort_ns, ops[2], ops[3]);
+    }
+
+    printf("k of n         mismatches  ns/sample\n");
+    for (uint8_t m = 0; m < sizeof(filter_kofns) / sizeof(filter_kofns[0]); m++) {
+        KofN_Filter* f = filter_kofns[m];
+        uint8_t hits[32] = { 0 };
+        uint32_t differ = 0;
+
+        KofN_Reset(f);
+        for (uint32_t i = 0; i < FILTER_CHECK_SAMPLES; i++) {
+            uint8_t hit = filter_sample() > FILTER_LIMIT || (filter_rng >> 30) == 0;
+            uint8_t count = 0;
+
+            hits[i % f->n] = hit;
+            for (uint8_t j = 0; j < f->n; j++) {
+                count += hits[j];
+            }
+            differ += (KofN_Push(f, hit) != (count >= f->k));
+        }
+        bad += differ;
+        printf("%6u of %-4u  %10u  %9.2f\n", f->k, f->n, differ, filter_ns(0, f, 0));
+    }
+
+    Median_Init(&filter_med5, 0);
+    KofN_Reset(&filter_kofn_motion);
+    Median_Init(&filter_med3, 0);
+    KofN_Reset(&filter_kofn_echo);
+    printf("filter: motion stage (median %u, %u of %u) %.2f ns/sample, "
+           "echo stage (median %u, %u of %u) %.2f ns/sample\n",
+           FILTER_MOTION_N, FILTER_MOTION_K, FILTER_MOTION_KN,
+           filter_ns(&filter_med5, &filter_kofn_motion, 0),
+           FILTER_ECHO_N, FILTER_ECHO_K, FILTER_ECHO_KN,
+           filter_ns(&filter_med3, &filter_kofn_echo, 0));
+    printf("filter: k-of-n is 14 integer operations per sample for any n, no loop\n");
+    printf("filter: ns are host times; compares and swaps are what the M0+ executes,\n"
+           "        a swap rewrites 2 heap and 2 position entries; at 800 Hz the M0+\n"
+           "        has %u core cycles per accelerometer sample\n", HOST_CLOCK_HZ / VIB_ODR_HZ);
+    if (bad != 0) {
+        printf("filter: FAILED - median or k-of-n differs from the reference\n");
+        exit(1);
+    }
+}
+
+/*-------------------------------------------------------------------------
+ * Function: bench_run
+ * Purpose: Run a benchmark by name and exit
+ * Parameters: name - benchmark
+ * Returns: Never
+ *-------------------------------------------------------------------------*/
+void bench_run(const char* name) {
+    if (strcmp(name, "codes") == 0) {
+        bench_codes();
+    } else if (strcmp(name, "keyseq") == 0) {
+        bench_keyseq();
+    } else if (strcmp(name, "timers") == 0) {
+        bench_timers();
+    } else if (strcmp(name, "fsm") == 0) {
+        bench_fsm();
+    } else if (strcmp(name, "vibration") == 0) {
+        bench_vibration();
+    } else if (strcmp(name, "motion") == 0) {
+        bench_motion();
+    } else if (strcmp(name, "i2c") == 0) {
+        bench_i2c();
+    } else if (strcmp(name, "accel") == 0) {
+        bench_accel();
+    } else if (strcmp(name, "echo") == 0) {
+        bench_echo();
+    } else if (strcmp(name, "sine") == 0) {
+        bench_sine();
+    } else if (strcmp(name, "filter") == 0) {
+        bench_filter();
+    } else {
+        fprintf(stderr, "bench: unknown '%s' (codes, keyseq, timers, fsm, vibration, motion, i2c,"
+                " accel, echo, sine, filter)\n", name);
+        exit(2);
+    }
+    exit(0);
+}
@@ -0,0 +1,1319 @@
+/*-------------------------------------------------------------------------
+ * Technika Mikroprocesorowa 2 - Project
+ * Project: Security Alarm System
+ * File: host/host.c
+ *
+ * This file implements the simulated MCU of the host build:
+ * - Virtual clock in core cycles, advanced only by busy-wait polls and
+ *   WFI, jumping straight to the next timer or model event
+ * - NVIC with priorities, PRIMASK and level-sensitive interrupt lines
+ *   computed from the peripheral flag registers
+ * - TPM0/TPM1 (counter, overflow, output compare with pin actions,
+ *   input capture), PIT, LPTMR0 (reset on compare or free running),
+ *   SysTick
+ * - WFI in WAIT or VLPS (SLEEPDEEP with SMC STOPM); VLPS faults if a
+ *   peripheral that loses its clock there is still busy, the TPM
+ *   counters stand still until the wake-up interrupt
+ * - PIT0-paced DMA channel 0 feeding the DAC sink
+ * - I2C0 master with byte timing from the F register; while the slave
+ *   hangs the bus, a byte never completes until STOP or module disable
+ * - PORTA/PORTB pin levels, pin interrupts and GPIO data registers
+ * - FTFA flash (program longword, erase sector) with typical command
+ *   times, image kept in ALARM_FLASH across runs, power loss in the
+ *   middle of command ALARM_POWER_CUT
+ *-------------------------------------------------------------------------*/
+
+#include "host.h"
+#include "models.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*-------------------------------------------------------------------------
+ * Constants
+ *-------------------------------------------------------------------------*/
+#define POLL_CYCLES         10          // One busy-wait iteration, ~250 ns
+#define THREAD_PRIORITY     4           // Below the lowest NVIC priority (3)
+#define SYSTICK_LINE        HOST_IRQ_LINES
+#define STORM_LIMIT         100000      // Handler runs without time passing
+#define TPM_CHANNELS        6
+#define DMA_ALWAYS_ON       60          // DMAMUX always-enabled source
+#define FLASH_SECTOR        1024
+#define FLASH_CMD_PGM4      0x06        // Program longword
+#define FLASH_CMD_ERSSCR    0x09        // Erase flash sector
+#define FLASH_PGM4_US       65          // Typical command times (KL05 datasheet)
+#define FLASH_ERSSCR_US     14000
+
+// Read-only registers are written by the simulation only
+#define HOST_WR(reg)        (*(volatile uint32_t*)&(reg))
+
+/*-------------------------------------------------------------------------
+ * Peripheral Instances
+ *-------------------------------------------------------------------------*/
+SIM_Type host_SIM;
+PORT_Type host_PORTA, host_PORTB;
+GPIO_Type host_PTA, host_PTB;
+I2C_Type host_I2C0;
+TPM_Type host_TPM0, host_TPM1;
+DAC_Type host_DAC0;
+DMA_Type host_DMA0;
+DMAMUX_Type host_DMAMUX0;
+PIT_Type host_PIT;
+LPTMR_Type host_LPTMR0;
+SMC_Type host_SMC;
+FTFA_Type host_FTFA;
+SCB_Type host_SCB;
+SysTick_Type host_SysTick;
+LLWU_Type host_LLWU;
+
+uint32_t SystemCoreClock = HOST_CLOCK_HZ;
+uint64_t host_now;
+HostStats host_stats;
+uint8_t host_tracing;
+uint8_t host_flash[HOST_FLASH_SIZE];
+
+/*-------------------------------------------------------------------------
+ * Types
+ *-------------------------------------------------------------------------*/
+typedef struct {
+    TPM_Type* regs;
+    uint32_t sc, mod, cnt;              // Last seen configuration and count
+    uint64_t base_t;                    // Time of the last rebase
+    uint64_t base_n;                    // Absolute tick count at base_t
+    uint8_t out[TPM_CHANNELS];          // Output compare pin states
+} tpm_state_t;
+
+typedef struct {
+    uint8_t on;
+    uint64_t next_t;                    // Next expiry
+} pit_state_t;
+
+typedef struct {
+    uint8_t port, pin, mux;
+    uint8_t tpm, ch;
+} tpm_pin_t;
+
+/*-------------------------------------------------------------------------
+ * Interrupt Handlers (firmware definitions override these)
+ *-------------------------------------------------------------------------*/
+static void unhandled(void) {
+    host_fault("interrupt without handler");
+}
+
+#define HOST_HANDLER(name) void name(void) __attribute__((weak, alias("unhandled")))
+HOST_HANDLER(DMA0_IRQHandler);
+HOST_HANDLER(FTFA_IRQHandler);
+HOST_HANDLER(LLWU_IRQHandler);
+HOST_HANDLER(I2C0_IRQHandler);
+HOST_HANDLER(TPM0_IRQHandler);
+HOST_HANDLER(TPM1_IRQHandler);
+HOST_HANDLER(PIT_IRQHandler);
+HOST_HANDLER(LPTMR0_IRQHandler);
+HOST_HANDLER(PORTA_IRQHandler);
+HOST_HANDLER(PORTB_IRQHandler);
+HOST_HANDLER(SysTick_Handler);
+
+static void (*const vectors[HOST_IRQ_LINES + 1])(void) = {
+    [DMA0_IRQn]   = DMA0_IRQHandler,
+    [FTFA_IRQn]   = FTFA_IRQHandler,
+    [LLWU_IRQn]   = LLWU_IRQHandler,
+    [I2C0_IRQn]   = I2C0_IRQHandler,
+    [TPM0_IRQn]   = TPM0_IRQHandler,
+    [TPM1_IRQn]   = TPM1_IRQHandler,
+    [PIT_IRQn]    = PIT_IRQHandler,
+    [LPTMR0_IRQn] = LPTMR0_IRQHandler,
+    [PORTA_IRQn]  = PORTA_IRQHandler,
+    [PORTB_IRQn]  = PORTB_IRQHandler,
+    [SYSTICK_LINE] = SysTick_Handler,
+};
+
+static const char* const irq_names[HOST_IRQ_LINES + 1] = {
+    [DMA0_IRQn]   = "DMA0",
+    [FTFA_IRQn]   = "FTFA",
+    [LLWU_IRQn]   = "LLWU",
+    [I2C0_IRQn]   = "I2C0",
+    [TPM0_IRQn]   = "TPM0",
+    [TPM1_IRQn]   = "TPM1",
+    [PIT_IRQn]    = "PIT",
+    [LPTMR0_IRQn] = "LPTMR0",
+    [PORTA_IRQn]  = "PORTA",
+    [PORTB_IRQn]  = "PORTB",
+    [SYSTICK_LINE] = "SysTick",
+};
+
+/*-------------------------------------------------------------------------
+ * Static Variables
+ *-------------------------------------------------------------------------*/
+static uint8_t primask;
+static uint8_t exec_prio = THREAD_PRIORITY;
+static uint8_t nvic_prio[HOST_IRQ_LINES + 1];
+static uint64_t nvic_enabled;
+static uint64_t nvic_latched;           // Software or edge pending bits
+static uint64_t irq_level;              // Asserted by peripheral flags
+static uint32_t storm;                  // Handler runs at the current time
+static uint8_t idle_depth;
+static uint8_t tpm_frozen;              // VLPS: TPM counters have no clock
+
+static tpm_state_t tpm[2] = { { .regs = &host_TPM0 }, { .regs = &host_TPM1 } };
+static pit_state_t pit[2];
+static uint8_t lptmr_on;
+static uint64_t lptmr_base;             // Time of the last counter reset
+static uint32_t lptmr_cmr;              // CMR and TCF seen at the last sync
+static uint8_t lptmr_tcf;
+static uint8_t systick_on;
+static uint64_t systick_base;           // Time of the last reload
+static uint32_t systick_val;
+static uint8_t stream_active;
+
+static uint32_t pin_ext[2];             // Levels driven by the models
+static uint32_t pin_ext_mask[2];        // Pins driven by the models
+static uint32_t pin_level[2];           // Resolved pin levels
+static uint8_t pins_busy;
+
+static const char* flash_file;          // Flash image, 0 if not kept
+static uint32_t flash_commands;
+static uint32_t flash_cut;              // Command interrupted by power loss, 0 = none
+
+static const tpm_pin_t tpm_pins[] = {
+    { HOST_PORT_B, 11, 2, 0, 0 },       // PTB11 - TPM0_CH0 (RCW-0001 trigger)
+    { HOST_PORT_B, 13, 2, 1, 1 },       // PTB13 - TPM1_CH1 (RCW-0001 echo)
+};
+
+static struct {
+    uint8_t started;                    // START sent, STOP not yet
+    uint8_t addressing;                 // Next write is the address byte
+    uint8_t reading;                    // Addressed for read
+    uint8_t ack;                        // Acknowledge of the byte in flight
+    uint8_t rx;                         // Byte in flight is a receive
+    uint64_t done_t;                    // Byte completion, HOST_NEVER if idle
+} i2c = { .done_t = HOST_NEVER };
+
+// SCL divider per ICR value (KL05 reference manual, I2C divider table)
+static const uint16_t i2c_scl_div[64] = {
+      20,   22,   24,   26,   28,   30,   34,   40,   28,   32,   36,   40,   44,   48,   56,   68,
+      48,   56,   64,   72,   80,   88,  104,  128,   80,   96,  112,  128,  144,  160,  192,  240,
+     160,  192,  224,  256,  288,  320,  384,  480,  320,  384,  448,  512,  576,  640,  768,  960,
+     640,  768,  896, 1024, 1152, 1280, 1536, 1920, 1280, 1536, 1792, 2048, 2304, 2560, 3072, 3840
+};
+
+static void run(uint64_t target, uint8_t wake);
+static void sync_all(void);
+static void pins_update(void);
+
+/*-------------------------------------------------------------------------
+ * Function: host_fault
+ * Purpose: Stop the simulation on a firmware or model error
+ * Parameters: msg - description
+ * Returns: Never
+ *-------------------------------------------------------------------------*/
+void host_fault(const char* msg) {
+    fprintf(stderr, "[%12.3f ms] fault: %s\n", HOST_TO_MS(host_now), msg);
+    exit(2);
+}
+
+/*-------------------------------------------------------------------------
+ * Function: host_trace
+ * Purpose: Print a timestamped trace line when ALARM_TRACE is set
+ * Parameters: fmt - printf format and arguments
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+void host_trace(const char* fmt, ...) {
+    va_list ap;
+
+    if (!host_tracing) {
+        return;
+    }
+    printf("[%12.3f ms] ", HOST_TO_MS(host_now));
+    va_start(ap, fmt);
+    vprintf(fmt, ap);
+    va_end(ap);
+    putchar('\n');
+}
+
+/*-------------------------------------------------------------------------
+ * Function: host_irq_name
+ * Purpose: Name of an interrupt line for reports
+ * Parameters: line - NVIC line, HOST_IRQ_LINES for SysTick
+ * Returns: const char* - name or 0 if the line is not modelled
+ *-------------------------------------------------------------------------*/
+const char* host_irq_name(uint8_t line) {
+    return (line <= HOST_IRQ_LINES) ? irq_names[line] : 0;
+}
+
+/*-------------------------------------------------------------------------
+ * Clocks
+ *-------------------------------------------------------------------------*/
+static uint32_t bus_div(void) {
+    return ((SIM->CLKDIV1 & SIM_CLKDIV1_OUTDIV4_MASK) >> SIM_CLKDIV1_OUTDIV4_SHIFT) + 1;
+}
+
+/*-------------------------------------------------------------------------
+ * TPM
+ *-------------------------------------------------------------------------*/
+static uint8_t tpm_running(const tpm_state_t* t) {
+    return !tpm_frozen && (t->sc & TPM_SC_CMOD_MASK) == TPM_SC_CMOD(1);
+}
+
+static uint64_t tpm_ticks(const tpm_state_t* t, uint64_t at) {
+    if (!tpm_running(t)) {
+        return t->base_n;
+    }
+    return t->base_n + ((at - t->base_t) >> (t->sc & TPM_SC_PS_MASK));
+}
+
+static uint64_t tpm_time(const tpm_state_t* t, uint64_t n) {
+    return t->base_t + ((n - t->base_n) << (t->sc & TPM_SC_PS_MASK));
+}
+
+static uint8_t tpm_compare_ch(const tpm_state_t* t, uint8_t ch) {
+    uint32_t cnsc = t->regs->CONTROLS[ch].CnSC;
+
+    // Output compare or software compare (MSA set, MSB clear)
+    return (cnsc & (TPM_CnSC_MSA_MASK | TPM_CnSC_MSB_MASK)) == TPM_CnSC_MSA_MASK;
+}
+
+// Pick up configuration written by the firmware since the last step
+static void tpm_sync(tpm_state_t* t) {
+    TPM_Type* r = t->regs;
+    uint32_t mask = TPM_SC_CMOD_MASK | TPM_SC_PS_MASK;
+
+    if ((r->SC & mask) != (t->sc & mask) || r->MOD != t->mod || r->CNT != t->cnt) {
+        uint64_t cnt = (r->CNT != t->cnt) ? 0 : t->cnt;   // Any CNT write clears it
+
+        t->sc = r->SC;
+        t->mod = r->MOD & 0xFFFF;
+        t->base_t = host_now;
+        t->base_n = cnt;
+        t->cnt = (uint32_t)cnt;
+        r->CNT = t->cnt;
+    }
+    t->sc = r->SC;
+
+    // STATUS is the master copy of the channel and overflow flags
+    for (uint8_t ch = 0; ch < TPM_CHANNELS; ch++) {
+        if (r->STATUS & (1u << ch)) {
+            r->CONTROLS[ch].CnSC |= TPM_CnSC_CHF_MASK;
+        } else {
+            r->CONTROLS[ch].CnSC &= ~TPM_CnSC_CHF_MASK;
+        }
+    }
+    if (r->STATUS & TPM_STATUS_TOF_MASK) {
+        r->SC |= TPM_SC_TOF_MASK;
+    } else {
+        r->SC &= ~TPM_SC_TOF_MASK;
+    }
+}
+
+static uint8_t tpm_irq(const tpm_state_t* t) {
+    TPM_Type* r = t->regs;
+
+    if ((r->STATUS & TPM_STATUS_TOF_MASK) && (r->SC & TPM_SC_TOIE_MASK)) {
+        return 1;
+    }
+    for (uint8_t ch = 0; ch < TPM_CHANNELS; ch++) {
+        if ((r->STATUS & (1u << ch)) && (r->CONTROLS[ch].CnSC & TPM_CnSC_CHIE_MASK)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static uint64_t tpm_next(const tpm_state_t* t) {
+    uint64_t m = (uint64_t)t->mod + 1;
+    uint64_t n = tpm_ticks(t, host_now);
+    uint64_t best = (n / m + 1) * m;    // Next overflow
+
+    if (!tpm_running(t)) {
+        return HOST_NEVER;
+    }
+    for (uint8_t ch = 0; ch < TPM_CHANNELS; ch++) {
+        uint64_t v = t->regs->CONTROLS[ch].CnV & 0xFFFF;
+        uint64_t k;
+
+        if (!tpm_compare_ch(t, ch) || v > t->mod) {
+            continue;
+        }
+        k = n - (n % m) + v;
+        if (k <= n) {
+            k += m;
+        }
+        if (k < best) {
+            best = k;
+        }
+    }
+    return tpm_time(t, best);
+}
+
+static void tpm_advance(tpm_state_t* t, uint64_t to) {
+    TPM_Type* r = t->regs;
+    uint64_t m = (uint64_t)t->mod + 1;
+    uint64_t n0 = tpm_ticks(t, host_now);
+    uint64_t n1 = tpm_ticks(t, to);
+
+    if (n1 == n0) {
+        return;
+    }
+    if (n1 / m != n0 / m) {
+        r->STATUS |= TPM_STATUS_TOF_MASK;
+    }
+    for (uint8_t ch = 0; ch < TPM_CHANNELS; ch++) {
+        uint64_t v = r->CONTROLS[ch].CnV & 0xFFFF;
+        uint64_t k;
+        uint32_t els;
+
+        if (!tpm_compare_ch(t, ch) || v > t->mod) {
+            continue;
+        }
+        k = n0 - (n0 % m) + v;
+        if (k <= n0) {
+            k += m;
+        }
+        if (k > n1) {
+            continue;
+        }
+        r->STATUS |= (1u << ch);
+        els = r->CONTROLS[ch].CnSC & (TPM_CnSC_ELSA_MASK | TPM_CnSC_ELSB_MASK);
+        if (els == (TPM_CnSC_ELSA_MASK | TPM_CnSC_ELSB_MASK)) {
+            t->out[ch] = 1;             // Set on match
+        } else if (els == TPM_CnSC_ELSB_MASK) {
+            t->out[ch] = 0;             // Clear on match
+        } else if (els == TPM_CnSC_ELSA_MASK) {
+            t->out[ch] ^= 1;            // Toggle on match
+        }
+    }
+}
+
+// VLPS entry and wake-up: the counters keep their value while stopped
+static void tpm_freeze(uint8_t on) {
+    for (uint8_t i = 0; i < 2; i++) {
+        tpm_state_t* t = &tpm[i];
+
+        if (on) {
+            t->base_n = tpm_ticks(t, host_now);
+        }
+        t->base_t = host_now;
+    }
+    tpm_frozen = on;
+}
+
+static void tpm_capture(tpm_state_t* t, uint8_t ch, uint8_t rising) {
+    TPM_Type* r = t->regs;
+    uint32_t cnsc = r->CONTROLS[ch].CnSC;
+
+    if (!tpm_running(t) || (cnsc & (TPM_CnSC_MSA_MASK | TPM_CnSC_MSB_MASK))) {
+        return;                         // Not an input capture channel
+    }
+    if ((rising && (cnsc & TPM_CnSC_ELSA_MASK)) || (!rising && (cnsc & TPM_CnSC_ELSB_MASK))) {
+        r->CONTROLS[ch].CnV = r->CNT;
+        r->STATUS |= (1u << ch);
+    }
+}
+
+/*-------------------------------------------------------------------------
+ * PIT and DMA
+ *-------------------------------------------------------------------------*/
+static uint64_t pit_period(uint8_t ch) {
+    return ((uint64_t)PIT->CHANNEL[ch].LDVAL + 1) * bus_div();
+}
+
+static uint8_t pit_enabled(uint8_t ch) {
+    return !(PIT->MCR & PIT_MCR_MDIS_MASK) && (PIT->CHANNEL[ch].TCTRL & PIT_TCTRL_TEN_MASK);
+}
+
+static void dma_request(uint8_t ch) {
+    uint32_t dcr = DMA0->DMA[ch].DCR;
+    uint32_t bcr = DMA0->DMA[ch].DSR_BCR & DMA_DSR_BCR_BCR_MASK;
+    static const uint8_t size_of[4] = { 4, 1, 2, 0 };
+    uint8_t size = size_of[(dcr & DMA_DCR_SSIZE_MASK) >> DMA_DCR_SSIZE_SHIFT];
+
+    if (!(dcr & DMA_DCR_ERQ_MASK) || bcr == 0 || size == 0) {
+        return;
+    }
+    memcpy((void*)DMA0->DMA[ch].DAR, (const void*)DMA0->DMA[ch].SAR, size);
+    if (DMA0->DMA[ch].DAR == (uintptr_t)&DAC0->DAT[0].DATL) {
+        model_dac_sample((uint16_t)(DAC0->DAT[0].DATL | (DAC0->DAT[0].DATH << 8)) & 0x0FFF);
+    }
+    if (dcr & DMA_DCR_SINC_MASK) {
+        DMA0->DMA[ch].SAR += size;
+    }
+    if (dcr & DMA_DCR_DINC_MASK) {
+        DMA0->DMA[ch].DAR += size;
+    }
+    bcr = (bcr > size) ? bcr - size : 0;
+    DMA0->DMA[ch].DSR_BCR = (DMA0->DMA[ch].DSR_BCR & ~DMA_DSR_BCR_BCR_MASK) | bcr;
+    if (bcr == 0) {
+        DMA0->DMA[ch].DSR_BCR |= DMA_DSR_BCR_DONE_MASK;
+    }
+}
+
+static void pit_expired(uint8_t ch) {
+    PIT->CHANNEL[ch].TFLG |= PIT_TFLG_TIF_MASK;
+
+    // DMAMUX channels 0-1 in trigger mode are paced by the PIT channel
+    // with the same number
+    if ((DMAMUX0->CHCFG[ch] & (DMAMUX_CHCFG_ENBL_MASK | DMAMUX_CHCFG_TRIG_MASK)) ==
+            (DMAMUX_CHCFG_ENBL_MASK | DMAMUX_CHCFG_TRIG_MASK) &&
+        (DMAMUX0->CHCFG[ch] & DMAMUX_CHCFG_SOURCE_MASK) == DMA_ALWAYS_ON) {
+        dma_request(ch);
+    }
+}
+
+/*-------------------------------------------------------------------------
+ * LPTMR0 and SysTick
+ *-------------------------------------------------------------------------*/
+static uint64_t lptmr_next(void) {
+    uint32_t psr = LPTMR0->PSR;
+    uint64_t ticks = (uint64_t)(LPTMR0->CMR & 0xFFFF) + 1;
+
+    if (LPTMR0->CSR & LPTMR_CSR_TFC_MASK) {
+        // Free running: the next time the counter leaves CMR, 16-bit wrap
+        uint64_t now = (host_now - lptmr_base) * 1000 / HOST_CLOCK_HZ;
+
+        ticks += now & ~0xFFFFull;
+        if (ticks <= now) {
+            ticks += 0x10000;
+        }
+    }
+    if (!(psr & LPTMR_PSR_PBYP_MASK)) {
+        ticks <<= ((psr & LPTMR_PSR_PRESCALE_MASK) >> LPTMR_PSR_PRESCALE_SHIFT) + 1;
+    }
+    // 1 kHz LPO, rounded up to the next core cycle
+    return lptmr_base + (ticks * HOST_CLOCK_HZ + 999) / 1000;
+}
+
+// HAL_LPTMR_COUNT: picks up a restart written just before the read
+uint16_t host_lptmr_count(void) {
+    sync_all();
+    if (lptmr_on) {
+        LPTMR0->CNR = (uint32_t)((host_now - lptmr_base) * 1000 / HOST_CLOCK_HZ) & 0xFFFF;
+    }
+    return (uint16_t)LPTMR0->CNR;
+}
+
+static uint64_t systick_next(void) {
+    uint64_t period = (uint64_t)(SysTick->LOAD & SysTick_LOAD_RELOAD_Msk) + 1;
+
+    return systick_base + ((host_now - systick_base) / period + 1) * period;
+}
+
+/*-------------------------------------------------------------------------
+ * Function: sync_all
+ * Purpose: Apply register writes made by the firmware since the last
+ *          step and recompute the interrupt lines
+ * Parameters: None
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+static void sync_all(void) {
+    uint8_t active;
+
+    tpm_sync(&tpm[0]);
+    tpm_sync(&tpm[1]);
+
+    for (uint8_t ch = 0; ch < 2; ch++) {
+        uint8_t on = pit_enabled(ch);
+
+        if (on && !pit[ch].on) {
+            pit[ch].next_t = host_now + pit_period(ch);
+        }
+        pit[ch].on = on;
+    }
+
+    if ((LPTMR0->CSR & LPTMR_CSR_TEN_MASK) && !lptmr_on) {
+        lptmr_base = host_now;
+    } else if ((LPTMR0->CSR & LPTMR_CSR_TEN_MASK) && LPTMR0->CMR != lptmr_cmr && !lptmr_tcf) {
+        // CMR is writable only with TCF set or the timer off, so a new
+        // value while the compare was armed means TEN was toggled
+        lptmr_base = host_now;
+    } else if (!(LPTMR0->CSR & LPTMR_CSR_TEN_MASK)) {
+        LPTMR0->CNR = 0;
+        LPTMR0->CSR &= ~LPTMR_CSR_TCF_MASK;
+    }
+    lptmr_on = (LPTMR0->CSR & LPTMR_CSR_TEN_MASK) != 0;
+    lptmr_cmr = LPTMR0->CMR;
+    lptmr_tcf = (LPTMR0->CSR & LPTMR_CSR_TCF_MASK) != 0;
+
+    if ((SysTick->CTRL & SysTick_CTRL_ENABLE_Msk) &&
+        (!systick_on || SysTick->VAL != systick_val)) {
+        systick_base = host_now;        // Enabled or VAL written
+    }
+    systick_on = (SysTick->CTRL & SysTick_CTRL_ENABLE_Msk) != 0;
+
+    // GPIO set/clear/toggle registers written directly
+    GPIO_Type* gpio[2] = { PTA, PTB };
+    for (uint8_t p = 0; p < 2; p++) {
+        if (gpio[p]->PSOR | gpio[p]->PCOR | gpio[p]->PTOR) {
+            gpio[p]->PDOR = ((gpio[p]->PDOR | gpio[p]->PSOR) & ~gpio[p]->PCOR) ^ gpio[p]->PTOR;
+            gpio[p]->PSOR = gpio[p]->PCOR = gpio[p]->PTOR = 0;
+        }
+    }
+    pins_update();
+
+    // I2C: module disable releases the bus
+    if (i2c.started && !(I2C0->C1 & I2C_C1_IICEN_MASK)) {
+        host_i2c_stop();
+    }
+
+    active = (DMAMUX0->CHCFG[0] & DMAMUX_CHCFG_ENBL_MASK) && pit[0].on &&
+             (DMA0->DMA[0].DCR & DMA_DCR_ERQ_MASK);
+    if (active != stream_active) {
+        stream_active = active;
+        model_dac_stream(active);
+    }
+
+    irq_level = 0;
+    if ((DMA0->DMA[0].DSR_BCR & DMA_DSR_BCR_DONE_MASK) && (DMA0->DMA[0].DCR & DMA_DCR_EINT_MASK)) {
+        irq_level |= 1ull << DMA0_IRQn;
+    }
+    if ((I2C0->S & I2C_S_IICIF_MASK) && (I2C0->C1 & I2C_C1_IICIE_MASK) && (I2C0->C1 & I2C_C1_IICEN_MASK)) {
+        irq_level |= 1ull << I2C0_IRQn;
+    }
+    if (tpm_irq(&tpm[0])) {
+        irq_level |= 1ull << TPM0_IRQn;
+    }
+    if (tpm_irq(&tpm[1])) {
+        irq_level |= 1ull << TPM1_IRQn;
+    }
+    for (uint8_t ch = 0; ch < 2; ch++) {
+        if ((PIT->CHANNEL[ch].TFLG & PIT_TFLG_TIF_MASK) && (PIT->CHANNEL[ch].TCTRL & PIT_TCTRL_TIE_MASK)) {
+            irq_level |= 1ull << PIT_IRQn;
+        }
+    }
+    if ((LPTMR0->CSR & LPTMR_CSR_TCF_MASK) && (LPTMR0->CSR & LPTMR_CSR_TIE_MASK)) {
+        irq_level |= 1ull << LPTMR0_IRQn;
+    }
+    if (PORTA->ISFR) {
+        irq_level |= 1ull << PORTA_IRQn;
+    }
+    if (PORTB->ISFR) {
+        irq_level |= 1ull << PORTB_IRQn;
+    }
+}
+
+/*-------------------------------------------------------------------------
+ * Function: update_counters
+ * Purpose: Publish counter values at the current time
+ * Parameters: None
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+static void update_counters(void) {
+    for (uint8_t i = 0; i < 2; i++) {
+        tpm_state_t* t = &tpm[i];
+
+        t->cnt = (uint32_t)(tpm_ticks(t, host_now) % ((uint64_t)t->mod + 1));
+        t->regs->CNT = t->cnt;
+    }
+    for (uint8_t ch = 0; ch < 2; ch++) {
+        if (pit[ch].on) {
+            uint64_t left = (pit[ch].next_t - host_now + bus_div() - 1) / bus_div();
+
+            HOST_WR(PIT->CHANNEL[ch].CVAL) = (uint32_t)(left ? left - 1 : 0);
+        }
+    }
+    if (lptmr_on) {
+        LPTMR0->CNR = (uint32_t)((host_now - lptmr_base) * 1000 / HOST_CLOCK_HZ) & 0xFFFF;
+    }
+    if (systick_on) {
+        uint64_t period = (uint64_t)(SysTick->LOAD & SysTick_LOAD_RELOAD_Msk) + 1;
+
+        systick_val = (uint32_t)(period - 1 - (host_now - systick_base) % period);
+        SysTick->VAL = systick_val;
+    }
+}
+
+/*-------------------------------------------------------------------------
+ * Function: next_event
+ * Purpose: Earliest time at which any timer or model changes state
+ * Parameters: None
+ * Returns: uint64_t - event time, HOST_NEVER if none
+ *-------------------------------------------------------------------------*/
+static uint64_t next_event(void) {
+    uint64_t t = models_next();
+    uint64_t e;
+
+    for (uint8_t i = 0; i < 2; i++) {
+        if ((e = tpm_next(&tpm[i])) < t) t = e;
+    }
+    for (uint8_t ch = 0; ch < 2; ch++) {
+        if (pit[ch].on && pit[ch].next_t < t) t = pit[ch].next_t;
+    }
+    if (lptmr_on && (e = lptmr_next()) < t) t = e;
+    if (systick_on && (e = systick_next()) < t) t = e;
+    if (i2c.done_t < t) t = i2c.done_t;
+    return t;
+}
+
+/*-------------------------------------------------------------------------
+ * Function: advance_to
+ * Purpose: Move the clock to the next event and apply its effects
+ * Parameters: to - new time, not later than next_event()
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+static void advance_to(uint64_t to) {
+    tpm_advance(&tpm[0], to);
+    tpm_advance(&tpm[1], to);
+
+    for (uint8_t ch = 0; ch < 2; ch++) {
+        if (pit[ch].on && pit[ch].next_t <= to) {
+            pit[ch].next_t += pit_period(ch);
+            pit_expired(ch);
+        }
+    }
+    if (lptmr_on && lptmr_next() <= to) {
+        if (!(LPTMR0->CSR & LPTMR_CSR_TFC_MASK)) {
+            lptmr_base = lptmr_next();
+        }
+        LPTMR0->CSR |= LPTMR_CSR_TCF_MASK;
+        lptmr_tcf = 1;
+    }
+    if (systick_on && systick_next() <= to) {
+        SysTick->CTRL |= SysTick_CTRL_COUNTFLAG_Msk;
+        if (SysTick->CTRL & SysTick_CTRL_TICKINT_Msk) {
+            nvic_latched |= 1ull << SYSTICK_LINE;
+        }
+    }
+    if (i2c.done_t <= to) {
+        i2c.done_t = HOST_NEVER;
+        if (i2c.rx) {
+            I2C0->D = model_i2c_read();
+        } else {
+            I2C0->S = (I2C0->S & ~I2C_S_RXAK_MASK) | (i2c.ack ? 0 : I2C_S_RXAK_MASK);
+        }
+        I2C0->S |= I2C_S_IICIF_MASK | I2C_S_TCF_MASK;
+    }
+
+    if (to != host_now) {
+        storm = 0;
+    }
+    host_now = to;
+    update_counters();
+    pins_update();                      // Output compare pin actions
+    models_run(to);
+}
+
+/*-------------------------------------------------------------------------
+ * Pins
+ *-------------------------------------------------------------------------*/
+static uint8_t pin_resolve(uint8_t port, uint8_t pin) {
+    PORT_Type* pcr = port ? PORTB : PORTA;
+    GPIO_Type* gpio = port ? PTB : PTA;
+    uint32_t mux = (pcr->PCR[pin] & PORT_PCR_MUX_MASK) >> PORT_PCR_MUX_SHIFT;
+    uint32_t bit = 1u << pin;
+
+    if (mux == 1 && (gpio->PDDR & bit)) {
+        return (gpio->PDOR & bit) != 0;
+    }
+    for (uint8_t i = 0; i < sizeof(tpm_pins) / sizeof(tpm_pins[0]); i++) {
+        const tpm_pin_t* tp = &tpm_pins[i];
+
+        if (tp->port == port && tp->pin == pin && tp->mux == mux &&
+            tpm_compare_ch(&tpm[tp->tpm], tp->ch)) {
+            return tpm[tp->tpm].out[tp->ch];
+        }
+    }
+    if (pin_ext_mask[port] & bit) {
+        return (pin_ext[port] & bit) != 0;
+    }
+    // Undriven input: pull resistor if enabled
+    return (pcr->PCR[pin] & PORT_PCR_PE_MASK) ? (pcr->PCR[pin] & PORT_PCR_PS_MASK) != 0 : 0;
+}
+
+static void pin_edge(uint8_t port, uint8_t pin, uint8_t level, uint8_t changed) {
+    PORT_Type* pcr = port ? PORTB : PORTA;
+    uint32_t irqc = (pcr->PCR[pin] & PORT_PCR_IRQC_MASK) >> PORT_PCR_IRQC_SHIFT;
+    uint8_t flag = 0;
+
+    switch (irqc) {
+    case 0x8:  flag = !level;                   break;  // Logic zero
+    case 0x9:  flag = changed && level;         break;  // Rising edge
+    case 0xA:  flag = changed && !level;        break;  // Falling edge
+    case 0xB:  flag = changed;                  break;  // Either edge
+    case 0xC:  flag = level;                    break;  // Logic one
+    default:                                    break;
+    }
+    if (flag) {
+        pcr->ISFR |= 1u << pin;
+    }
+    if (changed) {
+        for (uint8_t i = 0; i < sizeof(tpm_pins) / sizeof(tpm_pins[0]); i++) {
+            const tpm_pin_t* tp = &tpm_pins[i];
+
+            if (tp->port == port && tp->pin == pin &&
+                (pcr->PCR[pin] & PORT_PCR_MUX_MASK) == PORT_PCR_MUX(tp->mux)) {
+                tpm_capture(&tpm[tp->tpm], tp->ch, level);
+            }
+        }
+    }
+}
+
+/*-------------------------------------------------------------------------
+ * Function: pins_update
+ * Purpose: Resolve pin levels, let the models react to outputs, then
+ *          raise pin interrupts and input captures on changes
+ * Parameters: None
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+static void pins_update(void) {
+    uint32_t level[2], used[2];
+    PORT_Type* pcr[2] = { PORTA, PORTB };
+    GPIO_Type* gpio[2] = { PTA, PTB };
+
+    if (pins_busy) {
+        return;                         // Models drive inputs while resolving
+    }
+    pins_busy = 1;
+    for (uint8_t pass = 0; pass < 4; pass++) {
+        uint32_t ext[2] = { pin_ext[0], pin_ext[1] };
+
+        for (uint8_t p = 0; p < 2; p++) {
+            level[p] = 0;
+            used[p] = pin_ext_mask[p];
+            for (uint8_t n = 0; n < 32; n++) {
+                if (pcr[p]->PCR[n]) {
+                    used[p] |= 1u << n;
+                }
+                if (used[p] & (1u << n)) {
+                    level[p] |= (uint32_t)pin_resolve(p, n) << n;
+                }
+            }
+        }
+        memcpy(pin_level, level, sizeof(level));
+        models_pins_changed();
+        if (ext[0] == pin_ext[0] && ext[1] == pin_ext[1]) {
+            break;
+        }
+    }
+    pins_busy = 0;
+
+    for (uint8_t p = 0; p < 2; p++) {
+        static uint32_t last[2];
+        uint32_t changed = level[p] ^ last[p];
+
+        last[p] = level[p];
+        HOST_WR(gpio[p]->PDIR) = level[p];
+        for (uint8_t n = 0; n < 32; n++) {
+            if (!(used[p] & (1u << n))) {
+                continue;
+            }
+            if ((pcr[p]->PCR[n] & PORT_PCR_IRQC_MASK) || (changed & (1u << n))) {
+                pin_edge(p, n, (level[p] >> n) & 1, (changed >> n) & 1);
+            }
+            // ISFR is the master copy of the per-pin flags
+            if (pcr[p]->ISFR & (1u << n)) {
+                pcr[p]->PCR[n] |= PORT_PCR_ISF_MASK;
+            } else {
+                pcr[p]->PCR[n] &= ~PORT_PCR_ISF_MASK;
+            }
+        }
+    }
+}
+
+/*-------------------------------------------------------------------------
+ * Function: host_pin_input
+ * Purpose: Drive an input pin from a device model
+ * Parameters:
+ * port - HOST_PORT_A or HOST_PORT_B
+ * pin - pin number
+ * level - 0 or 1
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+void host_pin_input(uint8_t port, uint8_t pin, uint8_t level) {
+    uint32_t bit = 1u << pin;
+    uint32_t ext = level ? (pin_ext[port] | bit) : (pin_ext[port] & ~bit);
+
+    if ((pin_ext_mask[port] & bit) && ext == pin_ext[port]) {
+        return;
+    }
+    pin_ext_mask[port] |= bit;
+    pin_ext[port] = ext;
+    pins_update();
+}
+
+/*-------------------------------------------------------------------------
+ * Function: host_pin_level
+ * Purpose: Current level of a pin, as seen by the device models
+ * Parameters:
+ * port - HOST_PORT_A or HOST_PORT_B
+ * pin - pin number
+ * Returns: uint8_t - 0 or 1
+ *-------------------------------------------------------------------------*/
+uint8_t host_pin_level(uint8_t port, uint8_t pin) {
+    return (pin_level[port] >> pin) & 1;
+}
+
+/*-------------------------------------------------------------------------
+ * Function: host_siren_active
+ * Purpose: Check if the DAC is fed by the DMA stream
+ * Parameters: None
+ * Returns: uint8_t - 1 while the siren stream runs
+ *-------------------------------------------------------------------------*/
+uint8_t host_siren_active(void) {
+    return stream_active;
+}
+
+/*-------------------------------------------------------------------------
+ * Function: host_gpio_changed
+ * Purpose: GPIO output written through HAL_GPIO_SET/HAL_GPIO_CLR
+ * Parameters: None
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+void host_gpio_changed(void) {
+    pins_update();
+}
+
+/*-------------------------------------------------------------------------
+ * I2C0 Master
+ *-------------------------------------------------------------------------*/
+static uint64_t i2c_byte_time(void) {
+    uint8_t f = I2C0->F;
+    uint64_t bit = (uint64_t)(1u << (f >> 6)) * i2c_scl_div[f & 0x3F];
+
+    return 9 * bit * bus_div();         // 8 data bits and the acknowledge
+}
+
+/*-------------------------------------------------------------------------
+ * Function: host_i2c_start
+ * Purpose: Master bit set (HAL_I2C_START) - START condition
+ * Parameters: None
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+void host_i2c_start(void) {
+    if (I2C0->C1 & I2C_C1_IICEN_MASK) {
+        I2C0->S |= I2C_S_BUSY_MASK;
+        i2c.started = 1;
+        i2c.addressing = 1;
+    }
+}
+
+/*-------------------------------------------------------------------------
+ * Function: host_i2c_stop
+ * Purpose: Master bit cleared (HAL_I2C_STOP) - STOP condition
+ * Parameters: None
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+void host_i2c_stop(void) {
+    if (i2c.started) {
+        i2c.started = 0;
+        i2c.done_t = HOST_NEVER;
+        I2C0->S &= ~I2C_S_BUSY_MASK;
+        model_i2c_stop();
+    }
+}
+
+/*-------------------------------------------------------------------------
+ * Function: host_i2c_write
+ * Purpose: Data register write - address or data byte transmission.
+ *          A repeated START is taken from C1 (RSTA).
+ * Parameters: data - byte to send
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+void host_i2c_write(uint8_t data) {
+    I2C0->D = data;
+    if (!i2c.started) {
+        return;
+    }
+    if (I2C0->C1 & I2C_C1_RSTA_MASK) {
+        I2C0->C1 &= ~I2C_C1_RSTA_MASK;  // Self-clearing
+        i2c.addressing = 1;
+    }
+    if (i2c.addressing) {
+        i2c.addressing = 0;
+        i2c.reading = data & 1;
+        i2c.ack = model_i2c_address(data >> 1, data & 1);
+    } else {
+        i2c.ack = model_i2c_write(data);
+    }
+    i2c.rx = 0;
+    i2c.done_t = model_i2c_hung() ? HOST_NEVER : host_now + i2c_byte_time();
+}
+
+/*-------------------------------------------------------------------------
+ * Function: host_i2c_read
+ * Purpose: Data register read - returns the last received byte and, in
+ *          master receive mode, starts receiving the next one
+ * Parameters: None
+ * Returns: uint8_t - data register
+ *-------------------------------------------------------------------------*/
+uint8_t host_i2c_read(void) {
+    uint8_t data = I2C0->D;
+
+    if (i2c.started && i2c.reading && !(I2C0->C1 & I2C_C1_TX_MASK)) {
+        i2c.rx = 1;
+        i2c.done_t = model_i2c_hung() ? HOST_NEVER : host_now + i2c_byte_time();
+    }
+    return data;
+}
+
+/*-------------------------------------------------------------------------
+ * NVIC
+ *-------------------------------------------------------------------------*/
+static uint8_t irq_line(IRQn_Type irq) {
+    if (irq == SysTick_IRQn) {
+        return SYSTICK_LINE;
+    }
+    if (irq < 0 || irq >= HOST_IRQ_LINES) {
+        host_fault("NVIC access to a core exception");
+    }
+    return (uint8_t)irq;
+}
+
+void NVIC_EnableIRQ(IRQn_Type irq)        { nvic_enabled |= 1ull << irq_line(irq); }
+void NVIC_DisableIRQ(IRQn_Type irq)       { nvic_enabled &= ~(1ull << irq_line(irq)); }
+void NVIC_ClearPendingIRQ(IRQn_Type irq)  { nvic_latched &= ~(1ull << irq_line(irq)); }
+void NVIC_SetPendingIRQ(IRQn_Type irq)    { nvic_latched |= 1ull << irq_line(irq); }
+
+uint32_t NVIC_GetPendingIRQ(IRQn_Type irq) {
+    return (((nvic_latched | irq_level) >> irq_line(irq)) & 1) != 0;
+}
+
+void NVIC_SetPriority(IRQn_Type irq, uint32_t priority) {
+    nvic_prio[irq_line(irq)] = priority & 3;
+}
+
+uint32_t SysTick_Config(uint32_t ticks) {
+    if (ticks - 1 > SysTick_LOAD_RELOAD_Msk) {
+        return 1;
+    }
+    SysTick->LOAD = ticks - 1;
+    SysTick->VAL = 0;
+    nvic_prio[SYSTICK_LINE] = 3;
+    SysTick->CTRL = SysTick_CTRL_CLKSOURCE_Msk | SysTick_CTRL_TICKINT_Msk | SysTick_CTRL_ENABLE_Msk;
+    systick_on = 0;                     // Restart from the reload value
+    sync_all();
+    return 0;
+}
+
+static int8_t best_pending(void) {
+    uint64_t pend = (irq_level | nvic_latched) & (nvic_enabled | (1ull << SYSTICK_LINE));
+    int8_t best = -1;
+
+    // SysTick wins ties, it has the lower exception number
+    if (pend & (1ull << SYSTICK_LINE)) {
+        best = SYSTICK_LINE;
+    }
+    for (uint8_t i = 0; i < HOST_IRQ_LINES; i++) {
+        if ((pend & (1ull << i)) && (best < 0 || nvic_prio[i] < nvic_prio[best])) {
+            best = (int8_t)i;
+        }
+    }
+    return best;
+}
+
+/*-------------------------------------------------------------------------
+ * Function: dispatch
+ * Purpose: Run pending handlers that preempt the current priority
+ * Parameters: None
+ * Returns: uint8_t - 1 if any handler ran
+ *-------------------------------------------------------------------------*/
+static uint8_t dispatch(void) {
+    uint8_t ran = 0;
+
+    while (!primask) {
+        int8_t line = best_pending();
+        uint8_t saved = exec_prio;
+        uint64_t start;
+
+        if (line < 0 || nvic_prio[line] >= exec_prio) {
+            break;
+        }
+        if (++storm > STORM_LIMIT) {
+            host_fault(irq_names[line] ? irq_names[line] : "interrupt storm");
+        }
+        nvic_latched &= ~(1ull << line);
+        exec_prio = nvic_prio[line];
+        host_stats.irq[line]++;
+        start = host_now;
+        vectors[line]();
+        if (host_now - start > host_stats.irq_max[line]) {
+            host_stats.irq_max[line] = host_now - start;
+        }
+        exec_prio = saved;
+        ran = 1;
+        sync_all();
+    }
+    return ran;
+}
+
+void __disable_irq(void) {
+    primask = 1;
+}
+
+void __enable_irq(void) {
+    primask = 0;
+    sync_all();
+    dispatch();
+}
+
+uint32_t __get_PRIMASK(void) {
+    return primask;
+}
+
+void __set_PRIMASK(uint32_t value) {
+    if (value & 1) {
+        __disable_irq();
+    } else {
+        __enable_irq();
+    }
+}
+
+/*-------------------------------------------------------------------------
+ * Function: run
+ * Purpose: Simulation loop - take interrupts, then move to the next event
+ * Parameters:
+ * target - stop at this time
+ * wake - 1 to return as soon as an interrupt is pending (WFI)
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+static void run(uint64_t target, uint8_t wake) {
+    for (;;) {
+        uint64_t t;
+
+        sync_all();
+        if (tpm_frozen && best_pending() >= 0) {
+            tpm_freeze(0);              // Clocks restart before the handler
+        }
+        if (dispatch() && wake) {
+            return;
+        }
+        if (wake && best_pending() >= 0 && nvic_prio[best_pending()] < exec_prio) {
+            return;                     // Pending while masked by PRIMASK
+        }
+        if (host_now >= target) {
+            return;
+        }
+        t = next_event();
+        if (t > target) {
+            t = target;
+        }
+        if (t == HOST_NEVER) {
+            host_fault("waiting with no event scheduled");
+        }
+        if (wake && idle_depth == 1) {
+            host_stats.idle += t - host_now;
+            if (SCB->SCR & SCB_SCR_SLEEPDEEP_MASK) {
+                host_stats.stop += t - host_now;
+            }
+        }
+        advance_to(t);
+    }
+}
+
+/*-------------------------------------------------------------------------
+ * Function: flash_save
+ * Purpose: Write the flash image after every command, so that any run
+ *          can be stopped and the next one boots from what was written
+ * Parameters: None
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+static void flash_save(void) {
+    FILE* f;
+
+    if (flash_file == 0) {
+        return;
+    }
+    f = fopen(flash_file, "wb");
+    if (f == 0 || fwrite(host_flash, 1, sizeof(host_flash), f) != sizeof(host_flash)) {
+        perror(flash_file);
+        exit(2);
+    }
+    fclose(f);
+}
+
+/*-------------------------------------------------------------------------
+ * Function: flash_power_cut
+ * Purpose: Leave the command half done and stop the run - bits of the
+ *          target change at random towards their final value
+ * Parameters:
+ * addr - command address
+ * size - bytes affected
+ * erase - 1 for erase (bits go to 1), 0 for program (bits go to 0)
+ * data - program value
+ * Returns: Never
+ *-------------------------------------------------------------------------*/
+static void flash_power_cut(uint32_t addr, uint32_t size, uint8_t erase, uint32_t data) {
+    uint32_t seed = flash_cut * 2654435761u;
+
+    for (uint32_t i = 0; i < size; i++) {
+        uint8_t rnd;
+
+        seed = seed * 1103515245u + 12345u;
+        rnd = (uint8_t)(seed >> 16);
+        if (erase) {
+            host_flash[addr + i] |= rnd;
+        } else {
+            host_flash[addr + i] &= (uint8_t)(data >> (8 * (i & 3))) | rnd;
+        }
+    }
+    flash_save();
+    printf("power cut in flash command %u (%s 0x%04x) at %.3f ms\n", flash_cut,
+           erase ? "erase" : "program", (unsigned)addr, HOST_TO_MS(host_now));
+    exit(3);
+}
+
+/*-------------------------------------------------------------------------
+ * Function: host_flash_launch
+ * Purpose: Execute the FTFA command in FCCOB (HAL_FLASH_LAUNCH). The
+ *          CPU is stalled for the command time, peripherals keep running.
+ *          Flash must not be read meanwhile, so interrupts must be masked.
+ * Parameters: None
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+void host_flash_launch(void) {
+    uint32_t addr = ((uint32_t)FTFA->FCCOB1 << 16) | ((uint32_t)FTFA->FCCOB2 << 8) | FTFA->FCCOB3;
+    uint32_t data = ((uint32_t)FTFA->FCCOB4 << 24) | ((uint32_t)FTFA->FCCOB5 << 16) |
+                    ((uint32_t)FTFA->FCCOB6 << 8) | FTFA->FCCOB7;
+
+    if (!primask) {
+        host_fault("flash command with interrupts enabled");
+    }
+    if (!(FTFA->FSTAT & FTFA_FSTAT_CCIF_MASK) ||
+        (FTFA->FSTAT & (FTFA_FSTAT_ACCERR_MASK | FTFA_FSTAT_FPVIOL_MASK))) {
+        host_fault("flash command launched with CCIF clear or errors set");
+    }
+    FTFA->FSTAT &= ~FTFA_FSTAT_CCIF_MASK;
+
+    switch (FTFA->FCCOB0) {
+    case FLASH_CMD_PGM4:
+        if ((addr & 3) || addr >= HOST_FLASH_SIZE) {
+            FTFA->FSTAT |= FTFA_FSTAT_ACCERR_MASK;
+            break;
+        }
+        for (uint8_t i = 0; i < 4; i++) {
+            if (host_flash[addr + i] != 0xFF) {
+                host_fault("flash longword programmed twice without erase");
+            }
+        }
+        if (++flash_commands == flash_cut) {
+            flash_power_cut(addr, 4, 0, data);
+        }
+        run(host_now + HOST_US(FLASH_PGM4_US), 0);
+        for (uint8_t i = 0; i < 4; i++) {
+            host_flash[addr + i] = (uint8_t)(data >> (8 * i));  // Byte 0 at the lowest address
+        }
+        host_stats.flash_program++;
+        break;
+    case FLASH_CMD_ERSSCR:
+        if ((addr & (FLASH_SECTOR - 1)) || addr >= HOST_FLASH_SIZE) {
+            FTFA->FSTAT |= FTFA_FSTAT_ACCERR_MASK;
+            break;
+        }
+        if (++flash_commands == flash_cut) {
+            flash_power_cut(addr, FLASH_SECTOR, 1, 0);
+        }
+        run(host_now + HOST_US(FLASH_ERSSCR_US), 0);
+        memset(&host_flash[addr], 0xFF, FLASH_SECTOR);
+        host_stats.flash_erase[addr / FLASH_SECTOR]++;
+        host_trace("flash: erase sector 0x%04x", (unsigned)addr);
+        break;
+    default:
+        FTFA->FSTAT |= FTFA_FSTAT_ACCERR_MASK;
+        break;
+    }
+    FTFA->FSTAT |= FTFA_FSTAT_CCIF_MASK;
+    flash_save();
+}
+
+/*-------------------------------------------------------------------------
+ * Function: host_poll
+ * Purpose: One busy-wait iteration (HAL_POLL)
+ * Parameters: None
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+void host_poll(void) {
+    host_stats.polls++;
+    run(host_now + POLL_CYCLES, 0);
+}
+
+/*-------------------------------------------------------------------------
+ * Function: stop_check
+ * Purpose: Entering VLPS: bus and FLL clocks stop, only PORT pins and
+ *          LPTMR0 can wake the core. Fault if a peripheral on those
+ *          clocks still has work in progress.
+ * Parameters: None
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+static void stop_check(void) {
+    if ((SMC->PMCTRL & SMC_PMCTRL_STOPM_MASK) != 2 || !(SMC->PMPROT & SMC_PMPROT_AVLP_MASK)) {
+        host_fault("deep sleep without VLPS selected and allowed");
+    }
+    if (i2c.started || i2c.done_t != HOST_NEVER) {
+        host_fault("VLPS during an I2C transfer");
+    }
+    if (stream_active) {
+        host_fault("VLPS during a DMA stream");
+    }
+    for (uint8_t i = 0; i < 2; i++) {
+        TPM_Type* r = tpm[i].regs;
+
+        // TPM0 overflows only extend the microsecond clock
+        if (i == 1 && (r->SC & TPM_SC_TOIE_MASK)) {
+            host_fault("VLPS with TPM1 overflow interrupt on");
+        }
+        for (uint8_t ch = 0; ch < TPM_CHANNELS; ch++) {
+            if (tpm_compare_ch(&tpm[i], ch) && (r->CONTROLS[ch].CnSC & TPM_CnSC_CHIE_MASK)) {
+                host_fault(i ? "VLPS with a TPM1 compare pending" : "VLPS with a TPM0 compare pending");
+            }
+        }
+    }
+}
+
+/*-------------------------------------------------------------------------
+ * Function: host_idle
+ * Purpose: Wait for interrupt (HAL_IDLE), WAIT or VLPS
+ * Parameters: None
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+void host_idle(void) {
+    if (SCB->SCR & SCB_SCR_SLEEPDEEP_MASK) {
+        stop_check();
+        tpm_freeze(1);
+    }
+    idle_depth++;
+    host_stats.sleep_t = host_now;
+    run(HOST_NEVER, 1);
+    host_stats.sleep_t = HOST_NEVER;
+    if (tpm_frozen) {
+        tpm_freeze(0);
+    }
+    idle_depth--;
+}
+
+/*-------------------------------------------------------------------------
+ * Function: host_reset
+ * Purpose: Reset values and model setup, runs before the firmware main
+ * Parameters: None
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+__attribute__((constructor))
+static void host_reset(void) {
+    const char* trace = getenv("ALARM_TRACE");
+
+    host_tracing = (trace != 0 && trace[0] != '0');
+    host_stats.sleep_t = HOST_NEVER;
+    SIM->CLKDIV1 = 1u << SIM_CLKDIV1_OUTDIV4_SHIFT;   // Bus clock = core / 2
+    PIT->MCR = PIT_MCR_MDIS_MASK;
+    for (uint8_t i = 0; i < 2; i++) {
+        tpm[i].regs->MOD = 0xFFFF;
+        tpm[i].mod = 0xFFFF;
+    }
+    I2C0->S = 0;
+    FTFA->FSTAT = FTFA_FSTAT_CCIF_MASK;
+
+    // Erased flash, or the image left by the previous run
+    memset(host_flash, 0xFF, sizeof(host_flash));
+    flash_file = getenv("ALARM_FLASH");
+    flash_cut = getenv("ALARM_POWER_CUT") ? (uint32_t)atoi(getenv("ALARM_POWER_CUT")) : 0;
+    if (flash_file) {
+        FILE* f = fopen(flash_file, "rb");
+
+        if (f) {
+            if (fread(host_flash, 1, sizeof(host_flash), f) != sizeof(host_flash)) {
+                fprintf(stderr, "%s: not a %u byte flash image\n", flash_file, HOST_FLASH_SIZE);
+                exit(2);
+            }
+            fclose(f);
+        }
+    }
+    models_init();
+    scenario_init();
+}
@@ -0,0 +1,434 @@
+#ifndef HOST_H
+#define HOST_H
+
+/*-------------------------------------------------------------------------
+ * Technika Mikroprocesorowa 2 - Project
+ * Project: Security Alarm System
+ * File: host/host.h
+ *
+ * Register shim for the Linux host build (HOST_BUILD):
+ * - MKL05Z4 register layouts and bit masks used by the drivers,
+ *   backed by plain memory instead of the peripheral address space
+ * - NVIC, PRIMASK and SysTick functions served by the simulated core
+ * - Host versions of the HAL macros: side effects (write-1-to-clear,
+ *   GPIO set/clear, I2C data register, waiting) call into host.c
+ * - Firmware limits raised for the host benchmarks
+ *-------------------------------------------------------------------------*/
+
+#include <stdint.h>
+
+#define __I     volatile const
+#define __O     volatile
+#define __IO    volatile
+
+/*-------------------------------------------------------------------------
+ * Interrupt Numbers
+ *-------------------------------------------------------------------------*/
+typedef enum {
+    NonMaskableInt_IRQn = -14,
+    SVCall_IRQn         = -5,
+    PendSV_IRQn         = -2,
+    SysTick_IRQn        = -1,
+    DMA0_IRQn           = 0,
+    DMA1_IRQn           = 1,
+    DMA2_IRQn           = 2,
+    DMA3_IRQn           = 3,
+    FTFA_IRQn           = 5,
+    LVD_LVW_IRQn        = 6,
+    LLWU_IRQn           = 7,
+    I2C0_IRQn           = 8,
+    SPI0_IRQn           = 10,
+    UART0_IRQn          = 12,
+    ADC0_IRQn           = 15,
+    CMP0_IRQn           = 16,
+    TPM0_IRQn           = 17,
+    TPM1_IRQn           = 18,
+    RTC_IRQn            = 20,
+    RTC_Seconds_IRQn    = 21,
+    PIT_IRQn            = 22,
+    DAC0_IRQn           = 25,
+    TSI0_IRQn           = 26,
+    MCG_IRQn            = 27,
+    LPTMR0_IRQn         = 28,
+    PORTA_IRQn          = 30,
+    PORTB_IRQn          = 31
+} IRQn_Type;
+#define HOST_IRQ_LINES  32      // External lines, SysTick is kept after them
+
+/*-------------------------------------------------------------------------
+ * Register Layouts (reserved gaps dropped, DMA addresses hold pointers)
+ *-------------------------------------------------------------------------*/
+typedef struct {
+    __IO uint32_t SOPT1, SOPT1CFG, SOPT2, SOPT4, SOPT5, SOPT7;
+    __I  uint32_t SDID;
+    __IO uint32_t SCGC4, SCGC5, SCGC6, SCGC7, CLKDIV1, FCFG1;
+    __I  uint32_t FCFG2, UIDMH, UIDML, UIDL;
+    __IO uint32_t COPC;
+    __O  uint32_t SRVCOP;
+} SIM_Type;
+
+typedef struct {
+    __IO uint32_t PCR[32];
+    __O  uint32_t GPCLR, GPCHR;
+    __IO uint32_t ISFR;
+} PORT_Type;
+
+typedef struct {
+    __IO uint32_t PDOR;
+    __O  uint32_t PSOR, PCOR, PTOR;
+    __I  uint32_t PDIR;
+    __IO uint32_t PDDR;
+} GPIO_Type;
+
+typedef struct {
+    __IO uint8_t A1, F, C1, S, D, C2, FLT, RA, SMB, A2, SLTH, SLTL;
+} I2C_Type;
+
+typedef struct {
+    __IO uint32_t SC, CNT, MOD;
+    struct {
+        __IO uint32_t CnSC, CnV;
+    } CONTROLS[6];
+    __IO uint32_t STATUS, CONF;
+} TPM_Type;
+
+typedef struct {
+    struct {
+        __IO uint8_t DATL, DATH;
+    } DAT[2];
+    __IO uint8_t SR, C0, C1, C2;
+} DAC_Type;
+
+typedef struct {
+    struct {
+        __IO uintptr_t SAR, DAR;
+        __IO uint32_t DSR_BCR, DCR;
+    } DMA[4];
+} DMA_Type;
+
+typedef struct {
+    __IO uint8_t CHCFG[4];
+} DMAMUX_Type;
+
+typedef struct {
+    __IO uint32_t MCR;
+    __I  uint32_t LTMR64H, LTMR64L;
+    struct {
+        __IO uint32_t LDVAL;
+        __I  uint32_t CVAL;
+        __IO uint32_t TCTRL, TFLG;
+    } CHANNEL[2];
+} PIT_Type;
+
+typedef struct {
+    __IO uint32_t CSR, PSR, CMR, CNR;
+} LPTMR_Type;
+
+typedef struct {
+    __IO uint8_t PMPROT, PMCTRL, STOPCTRL;
+    __I  uint8_t PMSTAT;
+} SMC_Type;
+
+typedef struct {
+    __IO uint8_t FSTAT, FCNFG;
+    __I  uint8_t FSEC, FOPT;
+    __IO uint8_t FCCOB3, FCCOB2, FCCOB1, FCCOB0, FCCOB7, FCCOB6, FCCOB5, FCCOB4;
+    __IO uint8_t FCCOBB, FCCOBA, FCCOB9, FCCOB8;
+    __IO uint8_t FPROT3, FPROT2, FPROT1, FPROT0;
+} FTFA_Type;
+
+typedef struct {
+    __I  uint32_t CPUID;
+    __IO uint32_t ICSR, VTOR, AIRCR, SCR, CCR;
+} SCB_Type;
+
+typedef struct {
+    __IO uint32_t CTRL, LOAD, VAL;
+    __I  uint32_t CALIB;
+} SysTick_Type;
+
+typedef struct {
+    __IO uint8_t PE1, PE2, ME, F1, F2, FILT1, FILT2;
+} LLWU_Type;
+
+/*-------------------------------------------------------------------------
+ * Peripheral Instances
+ *-------------------------------------------------------------------------*/
+extern SIM_Type host_SIM;
+extern PORT_Type host_PORTA, host_PORTB;
+extern GPIO_Type host_PTA, host_PTB;
+extern I2C_Type host_I2C0;
+extern TPM_Type host_TPM0, host_TPM1;
+extern DAC_Type host_DAC0;
+extern DMA_Type host_DMA0;
+extern DMAMUX_Type host_DMAMUX0;
+extern PIT_Type host_PIT;
+extern LPTMR_Type host_LPTMR0;
+extern SMC_Type host_SMC;
+extern FTFA_Type host_FTFA;
+extern SCB_Type host_SCB;
+extern SysTick_Type host_SysTick;
+extern LLWU_Type host_LLWU;
+
+#define SIM         (&host_SIM)
+#define PORTA       (&host_PORTA)
+#define PORTB       (&host_PORTB)
+#define PTA         (&host_PTA)
+#define PTB         (&host_PTB)
+#define I2C0        (&host_I2C0)
+#define TPM0        (&host_TPM0)
+#define TPM1        (&host_TPM1)
+#define DAC0        (&host_DAC0)
+#define DMA0        (&host_DMA0)
+#define DMAMUX0     (&host_DMAMUX0)
+#define PIT         (&host_PIT)
+#define LPTMR0      (&host_LPTMR0)
+#define SMC         (&host_SMC)
+#define FTFA        (&host_FTFA)
+#define SCB         (&host_SCB)
+#define SysTick     (&host_SysTick)
+#define LLWU        (&host_LLWU)
+
+/*-------------------------------------------------------------------------
+ * Core (served by the simulated NVIC in host.c)
+ *-------------------------------------------------------------------------*/
+extern uint32_t SystemCoreClock;
+
+void NVIC_EnableIRQ(IRQn_Type irq);
+void NVIC_DisableIRQ(IRQn_Type irq);
+void NVIC_ClearPendingIRQ(IRQn_Type irq);
+void NVIC_SetPendingIRQ(IRQn_Type irq);
+uint32_t NVIC_GetPendingIRQ(IRQn_Type irq);
+void NVIC_SetPriority(IRQn_Type irq, uint32_t priority);
+uint32_t SysTick_Config(uint32_t ticks);
+
+void __disable_irq(void);
+void __enable_irq(void);
+uint32_t __get_PRIMASK(void);
+void __set_PRIMASK(uint32_t primask);
+void host_poll(void);
+void host_idle(void);
+void host_gpio_changed(void);
+void host_i2c_start(void);
+void host_i2c_stop(void);
+void host_i2c_write(uint8_t data);
+uint8_t host_i2c_read(void);
+uint16_t host_lptmr_count(void);
+void host_flash_launch(void);
+
+#define HOST_FLASH_SIZE     0x8000      // KL05Z32: 32 KB, 1 KB sectors
+extern uint8_t host_flash[HOST_FLASH_SIZE];
+
+#define __NOP()     host_poll()
+#define __WFI()     host_idle()
+#define __WFE()     host_idle()
+#define __DSB()     ((void)0)
+#define __ISB()     ((void)0)
+#define __DMB()     ((void)0)
+#define __SEV()     ((void)0)
+
+/*-------------------------------------------------------------------------
+ * HAL Macros (see hal.h). Flags are cleared directly, status registers
+ * are the master copy of mirrored flags (TPM STATUS, PORT ISFR).
+ *-------------------------------------------------------------------------*/
+#define HAL_W1C(reg, mask)          ((reg) &= ~(mask))
+#define HAL_W1C_OR(reg, mask)       ((reg) &= ~(mask))
+#define HAL_GPIO_SET(gpio, mask)    ((gpio)->PDOR |= (mask), host_gpio_changed())
+#define HAL_GPIO_CLR(gpio, mask)    ((gpio)->PDOR &= ~(mask), host_gpio_changed())
+#define HAL_I2C_START(i2c)          ((i2c)->C1 |= I2C_C1_MST_MASK, host_i2c_start())
+#define HAL_I2C_STOP(i2c)           ((i2c)->C1 &= ~I2C_C1_MST_MASK, host_i2c_stop())
+#define HAL_I2C_WRITE(i2c, v)       ((void)(i2c), host_i2c_write(v))
+#define HAL_I2C_READ(i2c)           ((void)(i2c), host_i2c_read())
+#define HAL_LPTMR_COUNT(tmr)        ((void)(tmr), host_lptmr_count())
+#define HAL_ADDR(p)                 ((uintptr_t)(p))
+#define HAL_RAMFUNC
+#define HAL_FLASH_LAUNCH(fn, ftfa)  ((void)(fn), (void)(ftfa), host_flash_launch())
+#define HAL_FLASH(addr)             ((const uint8_t*)host_flash + (addr))
+#define HAL_POLL()                  host_poll()
+#define HAL_IDLE()                  host_idle()
+
+/*-------------------------------------------------------------------------
+ * Bit Masks
+ *-------------------------------------------------------------------------*/
+#define SIM_SCGC4_I2C0_MASK             0x40u
+#define SIM_SCGC5_LPTMR_MASK            0x1u
+#define SIM_SCGC5_PORTA_MASK            0x200u
+#define SIM_SCGC5_PORTB_MASK            0x400u
+#define SIM_SCGC6_FTF_MASK              0x1u
+#define SIM_SCGC6_DMAMUX_MASK           0x2u
+#define SIM_SCGC6_PIT_MASK              0x800000u
+#define SIM_SCGC6_TPM0_MASK             0x1000000u
+#define SIM_SCGC6_TPM1_MASK             0x2000000u
+#define SIM_SCGC6_DAC0_MASK             0x80000000u
+#define SIM_SCGC7_DMA_MASK              0x100u
+#define SIM_SOPT2_TPMSRC_MASK           0x3000000u
+#define SIM_SOPT2_TPMSRC(x)             (((uint32_t)(x) << 24) & 0x3000000u)
+#define SIM_CLKDIV1_OUTDIV4_MASK        0x70000u
+#define SIM_CLKDIV1_OUTDIV4_SHIFT       16
+#define SIM_CLKDIV1_OUTDIV1_MASK        0xF0000000u
+#define SIM_CLKDIV1_OUTDIV1_SHIFT       28
+
+#define PORT_PCR_PS_MASK                0x1u
+#define PORT_PCR_PE_MASK                0x2u
+#define PORT_PCR_SRE_MASK               0x4u
+#define PORT_PCR_PFE_MASK               0x10u
+#define PORT_PCR_MUX_MASK               0x700u
+#define PORT_PCR_MUX_SHIFT              8
+#define PORT_PCR_MUX(x)                 (((uint32_t)(x) << 8) & 0x700u)
+#define PORT_PCR_IRQC_MASK              0xF0000u
+#define PORT_PCR_IRQC_SHIFT             16
+#define PORT_PCR_IRQC(x)                (((uint32_t)(x) << 16) & 0xF0000u)
+#define PORT_PCR_ISF_MASK               0x1000000u
+
+#define I2C_F_ICR(x)                    (((uint8_t)(x)) & 0x3Fu)
+#define I2C_F_MULT(x)                   (((uint8_t)(x) << 6) & 0xC0u)
+#define I2C_C1_DMAEN_MASK               0x1u
+#define I2C_C1_WUEN_MASK                0x2u
+#define I2C_C1_RSTA_MASK                0x4u
+#define I2C_C1_TXAK_MASK                0x8u
+#define I2C_C1_TX_MASK                  0x10u
+#define I2C_C1_MST_MASK                 0x20u
+#define I2C_C1_IICIE_MASK               0x40u
+#define I2C_C1_IICEN_MASK               0x80u
+#define I2C_S_RXAK_MASK                 0x1u
+#define I2C_S_IICIF_MASK                0x2u
+#define I2C_S_SRW_MASK                  0x4u
+#define I2C_S_RAM_MASK                  0x8u
+#define I2C_S_ARBL_MASK                 0x10u
+#define I2C_S_BUSY_MASK                 0x20u
+#define I2C_S_IAAS_MASK                 0x40u
+#define I2C_S_TCF_MASK                  0x80u
+
+#define TPM_SC_PS_MASK                  0x7u
+#define TPM_SC_PS(x)                    (((uint32_t)(x)) & 0x7u)
+#define TPM_SC_CMOD_MASK                0x18u
+#define TPM_SC_CMOD(x)                  (((uint32_t)(x) << 3) & 0x18u)
+#define TPM_SC_CPWMS_MASK               0x20u
+#define TPM_SC_TOIE_MASK                0x40u
+#define TPM_SC_TOF_MASK                 0x80u
+#define TPM_SC_DMA_MASK                 0x100u
+#define TPM_CnSC_DMA_MASK               0x1u
+#define TPM_CnSC_ELSA_MASK              0x4u
+#define TPM_CnSC_ELSB_MASK              0x8u
+#define TPM_CnSC_MSA_MASK               0x10u
+#define TPM_CnSC_MSB_MASK               0x20u
+#define TPM_CnSC_CHIE_MASK              0x40u
+#define TPM_CnSC_CHF_MASK               0x80u
+#define TPM_CnV_VAL(x)                  (((uint32_t)(x)) & 0xFFFFu)
+#define TPM_STATUS_CH0F_MASK            0x1u
+#define TPM_STATUS_CH1F_MASK            0x2u
+#define TPM_STATUS_CH2F_MASK            0x4u
+#define TPM_STATUS_CH3F_MASK            0x8u
+#define TPM_STATUS_CH4F_MASK            0x10u
+#define TPM_STATUS_CH5F_MASK            0x20u
+#define TPM_STATUS_TOF_MASK             0x100u
+#define TPM_CONF_DOZEEN_MASK            0x20u
+#define TPM_CONF_DBGMODE_MASK           0xC0u
+#define TPM_CONF_DBGMODE(x)             (((uint32_t)(x) << 6) & 0xC0u)
+#define TPM_CONF_CSOT_MASK              0x10000u
+#define TPM_CONF_CSOO_MASK              0x20000u
+#define TPM_CONF_CROT_MASK              0x40000u
+#define TPM_CONF_TRGSEL_MASK            0xF000000u
+#define TPM_CONF_TRGSEL(x)              (((uint32_t)(x) << 24) & 0xF000000u)
+
+#define DAC_SR_DACBFRPBF_MASK           0x1u
+#define DAC_SR_DACBFRPTF_MASK           0x2u
+#define DAC_C0_DACBBIEN_MASK            0x1u
+#define DAC_C0_DACBTIEN_MASK            0x2u
+#define DAC_C0_LPEN_MASK                0x8u
+#define DAC_C0_DACSWTRG_MASK            0x10u
+#define DAC_C0_DACTRGSEL_MASK           0x20u
+#define DAC_C0_DACRFS_MASK              0x40u
+#define DAC_C0_DACEN_MASK               0x80u
+#define DAC_C1_DACBFEN_MASK             0x1u
+#define DAC_C1_DACBFMD_MASK             0x4u
+#define DAC_C1_DMAEN_MASK               0x80u
+#define DAC_C2_DACBFUP_MASK             0x1u
+#define DAC_C2_DACBFRP_MASK             0x10u
+
+#define DMA_DSR_BCR_BCR_MASK            0xFFFFFFu
+#define DMA_DSR_BCR_BCR(x)              (((uint32_t)(x)) & 0xFFFFFFu)
+#define DMA_DSR_BCR_DONE_MASK           0x1000000u
+#define DMA_DSR_BCR_BSY_MASK            0x2000000u
+#define DMA_DSR_BCR_REQ_MASK            0x4000000u
+#define DMA_DSR_BCR_BED_MASK            0x10000000u
+#define DMA_DSR_BCR_BES_MASK            0x20000000u
+#define DMA_DSR_BCR_CE_MASK             0x40000000u
+#define DMA_DCR_LCH2(x)                 (((uint32_t)(x)) & 0x3u)
+#define DMA_DCR_LCH1(x)                 (((uint32_t)(x) << 2) & 0xCu)
+#define DMA_DCR_LINKCC(x)               (((uint32_t)(x) << 4) & 0x30u)
+#define DMA_DCR_D_REQ_MASK              0x80u
+#define DMA_DCR_DMOD(x)                 (((uint32_t)(x) << 8) & 0xF00u)
+#define DMA_DCR_SMOD(x)                 (((uint32_t)(x) << 12) & 0xF000u)
+#define DMA_DCR_START_MASK              0x10000u
+#define DMA_DCR_DSIZE_MASK              0x60000u
+#define DMA_DCR_DSIZE_SHIFT             17
+#define DMA_DCR_DSIZE(x)                (((uint32_t)(x) << 17) & 0x60000u)
+#define DMA_DCR_DINC_MASK               0x80000u
+#define DMA_DCR_SSIZE_MASK              0x300000u
+#define DMA_DCR_SSIZE_SHIFT             20
+#define DMA_DCR_SSIZE(x)                (((uint32_t)(x) << 20) & 0x300000u)
+#define DMA_DCR_SINC_MASK               0x400000u
+#define DMA_DCR_EADREQ_MASK             0x800000u
+#define DMA_DCR_AA_MASK                 0x10000000u
+#define DMA_DCR_CS_MASK                 0x20000000u
+#define DMA_DCR_ERQ_MASK                0x40000000u
+#define DMA_DCR_EINT_MASK               0x80000000u
+#define DMAMUX_CHCFG_SOURCE_MASK        0x3Fu
+#define DMAMUX_CHCFG_SOURCE(x)          (((uint8_t)(x)) & 0x3Fu)
+#define DMAMUX_CHCFG_TRIG_MASK          0x40u
+#define DMAMUX_CHCFG_ENBL_MASK          0x80u
+
+#define PIT_MCR_FRZ_MASK                0x1u
+#define PIT_MCR_MDIS_MASK               0x2u
+#define PIT_TCTRL_TEN_MASK              0x1u
+#define PIT_TCTRL_TIE_MASK              0x2u
+#define PIT_TCTRL_CHN_MASK              0x4u
+#define PIT_TFLG_TIF_MASK               0x1u
+
+#define LPTMR_CSR_TEN_MASK              0x1u
+#define LPTMR_CSR_TMS_MASK              0x2u
+#define LPTMR_CSR_TFC_MASK              0x4u
+#define LPTMR_CSR_TPP_MASK              0x8u
+#define LPTMR_CSR_TPS(x)                (((uint32_t)(x) << 4) & 0x30u)
+#define LPTMR_CSR_TIE_MASK              0x40u
+#define LPTMR_CSR_TCF_MASK              0x80u
+#define LPTMR_PSR_PCS(x)                (((uint32_t)(x)) & 0x3u)
+#define LPTMR_PSR_PBYP_MASK             0x4u
+#define LPTMR_PSR_PRESCALE_MASK         0x78u
+#define LPTMR_PSR_PRESCALE_SHIFT        3
+#define LPTMR_PSR_PRESCALE(x)           (((uint32_t)(x) << 3) & 0x78u)
+#define LPTMR_CMR_COMPARE(x)            (((uint32_t)(x)) & 0xFFFFu)
+#define LPTMR_CNR_COUNTER_MASK          0xFFFFu
+
+#define SMC_PMPROT_AVLLS_MASK           0x2u
+#define SMC_PMPROT_ALLS_MASK            0x8u
+#define SMC_PMPROT_AVLP_MASK            0x20u
+#define SMC_PMCTRL_STOPM_MASK           0x7u
+#define SMC_PMCTRL_STOPM(x)             (((uint8_t)(x)) & 0x7u)
+#define SMC_PMCTRL_STOPA_MASK           0x8u
+#define SMC_PMCTRL_RUNM(x)              (((uint8_t)(x) << 5) & 0x60u)
+#define SMC_PMSTAT_PMSTAT_MASK          0xFFu
+
+#define FTFA_FSTAT_MGSTAT0_MASK         0x1u
+#define FTFA_FSTAT_FPVIOL_MASK          0x10u
+#define FTFA_FSTAT_ACCERR_MASK          0x20u
+#define FTFA_FSTAT_RDCOLERR_MASK        0x40u
+#define FTFA_FSTAT_CCIF_MASK            0x80u
+
+#define SCB_SCR_SLEEPONEXIT_MASK        0x2u
+#define SCB_SCR_SLEEPDEEP_MASK          0x4u
+
+#define SysTick_CTRL_ENABLE_Msk         0x1u
+#define SysTick_CTRL_TICKINT_Msk        0x2u
+#define SysTick_CTRL_CLKSOURCE_Msk      0x4u
+#define SysTick_CTRL_COUNTFLAG_Msk      0x10000u
+#define SysTick_LOAD_RELOAD_Msk         0xFFFFFFu
+#define SysTick_VAL_CURRENT_Msk         0xFFFFFFu
+
+/*-------------------------------------------------------------------------
+ * Firmware Limits
+ *-------------------------------------------------------------------------*/
+#define TIMER_MAX                       4096    // Pool for the timer wheel bench
+
+#endif /* HOST_H */
@@ -0,0 +1,549 @@
+/*-------------------------------------------------------------------------
+ * Technika Mikroprocesorowa 2 - Project
+ * Project: Security Alarm System
+ * File: host/models.c
+ *
+ * This file implements the devices around the MCU in the host build:
+ * - MMA8451Q I2C slave: registers, 800 Hz sampling, 32-sample FIFO with
+ *   watermark/overflow, FIFO address wrap, INT2 (active low, PTA10),
+ *   sine vibration added on X, bus hang (bytes never complete)
+ * - RCW-0001 echo generator on PTB11/PTB13, object distance, glitches
+ *   and dropped echoes
+ * - Keypad matrix on PTA, rows pulled low through the pressed key;
+ *   optional contact bounce after every press and release
+ * - DAC sink counting siren samples, optional raw dump
+ *-------------------------------------------------------------------------*/
+
+#include "models.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*-------------------------------------------------------------------------
+ * Constants
+ *-------------------------------------------------------------------------*/
+#define ACC_ADDR            0x1D
+#define ACC_STATUS          0x00        // STATUS / F_STATUS
+#define ACC_OUT_X_MSB       0x01
+#define ACC_OUT_Z_LSB       0x06
+#define ACC_F_SETUP         0x09
+#define ACC_WHO_AM_I        0x0D
+#define ACC_XYZ_DATA_CFG    0x0E
+#define ACC_CTRL_REG1       0x2A
+#define ACC_CTRL_REG3       0x2C
+#define ACC_CTRL_REG4       0x2D
+#define ACC_CTRL_REG5       0x2E
+#define ACC_REGS            0x32
+#define ACC_FIFO_SIZE       32
+#define ACC_INT2_PIN        10          // PTA10
+#define ACC_ZYXDR           0x08
+#define ACC_ZYXOW           0x80
+#define ACC_F_OVF           0x80
+#define ACC_F_WMRK_FLAG     0x40
+#define ACC_INT_DRDY        0x01
+#define ACC_INT_FIFO        0x40
+
+#define TRIG_PIN            11          // PTB11
+#define ECHO_PIN            13          // PTB13
+#define TRIG_MIN_US         10          // Shortest trigger the sensor accepts
+#define ECHO_DELAY_US       450         // Trigger end to echo start (burst)
+#define ECHO_NONE_US        38000       // Echo length without an object
+#define ECHO_MAX_MM         4000        // Farther objects give no echo
+#define ECHO_SOUND_MM_S     343000      // Speed of sound in air at 20 C
+
+#define KEY_PRESS_MS        60          // Scripted key hold time
+#define KEY_GAP_MS          60          // Release time between keys
+#define KEY_QUEUE           32
+
+/*-------------------------------------------------------------------------
+ * MMA8451Q
+ *-------------------------------------------------------------------------*/
+static struct {
+    uint8_t reg[ACC_REGS];
+    uint8_t ptr;                        // Register address
+    uint8_t selected;                   // Addressed in the current transfer
+    uint8_t ptr_written;                // Write transfer set the address
+    int16_t fifo[ACC_FIFO_SIZE][3];
+    uint8_t head, count;
+    uint8_t ovf;
+    int16_t out[3];                     // Output registers (non-FIFO mode)
+    int16_t mg[3];                      // Applied acceleration
+    int16_t spike;                      // One-sample X spike, 0 = none
+    int16_t vib_mg;                     // X vibration amplitude, 0 = none
+    double vib_step, vib_phase;         // Radians per sample, current phase
+    uint64_t next_t;                    // Next sample
+    uint64_t hang_end;                  // Bytes started before this never complete
+    uint32_t samples;
+} acc;
+
+static const uint32_t acc_odr_hz_x100[8] = { 80000, 40000, 20000, 10000, 5000, 1250, 625, 156 };
+
+static uint64_t acc_period(void) {
+    return (uint64_t)HOST_CLOCK_HZ * 100 / acc_odr_hz_x100[(acc.reg[ACC_CTRL_REG1] >> 3) & 7];
+}
+
+static uint8_t acc_fifo_mode(void) {
+    return acc.reg[ACC_F_SETUP] >> 6;
+}
+
+static void acc_int_update(void) {
+    uint8_t src = 0;
+    uint8_t wmrk = acc.reg[ACC_F_SETUP] & 0x3F;
+    uint8_t int2;
+
+    if (acc.reg[ACC_STATUS] & ACC_ZYXDR) {
+        src |= ACC_INT_DRDY;
+    }
+    if (acc_fifo_mode() && ((wmrk && acc.count >= wmrk) || acc.ovf)) {
+        src |= ACC_INT_FIFO;
+    }
+    src &= acc.reg[ACC_CTRL_REG4];
+    int2 = (src & ~acc.reg[ACC_CTRL_REG5]) != 0;        // CTRL_REG5 bit clear = INT2
+
+    // Push-pull, IPOL = 0: active low
+    host_pin_input(HOST_PORT_A, ACC_INT2_PIN,
+                   (acc.reg[ACC_CTRL_REG3] & 0x02) ? int2 : !int2);
+}
+
+static int16_t acc_counts(int16_t mg) {
+    int32_t c = (int32_t)mg * (4096 >> (acc.reg[ACC_XYZ_DATA_CFG] & 3)) / 1000;
+
+    return (int16_t)(c > 8191 ? 8191 : (c < -8192 ? -8192 : c));
+}
+
+static void acc_sample(void) {
+    int16_t s[3];
+
+    for (uint8_t i = 0; i < 3; i++) {
+        s[i] = acc_counts(acc.mg[i]);
+    }
+    if (acc.vib_mg) {
+        s[0] = acc_counts((int16_t)(acc.mg[0] + acc.vib_mg * model_sin(acc.vib_phase)));
+        acc.vib_phase += acc.vib_step;
+    }
+    if (acc.spike) {
+        s[0] = acc_counts(acc.spike);
+        acc.spike = 0;
+    }
+    acc.samples++;
+
+    if (acc_fifo_mode()) {
+        if (acc.count == ACC_FIFO_SIZE) {
+            acc.ovf = 1;
+            if (acc_fifo_mode() != 1) {
+                return;                 // Fill mode stops when full
+            }
+            acc.head = (acc.head + 1) % ACC_FIFO_SIZE;      // Circular: drop oldest
+            acc.count--;
+        }
+        memcpy(acc.fifo[(acc.head + acc.count) % ACC_FIFO_SIZE], s, sizeof(s));
+        acc.count++;
+    } else {
+        if (acc.reg[ACC_STATUS] & ACC_ZYXDR) {
+            acc.reg[ACC_STATUS] |= ACC_ZYXOW;
+        }
+        acc.reg[ACC_STATUS] |= ACC_ZYXDR;
+        memcpy(acc.out, s, sizeof(s));
+    }
+    acc_int_update();
+}
+
+static uint8_t acc_read_reg(uint8_t r) {
+    uint8_t wmrk = acc.reg[ACC_F_SETUP] & 0x3F;
+    uint8_t v;
+
+    if (r == ACC_STATUS && acc_fifo_mode()) {
+        v = (acc.ovf ? ACC_F_OVF : 0) | ((wmrk && acc.count >= wmrk) ? ACC_F_WMRK_FLAG : 0) | acc.count;
+        acc.ovf = 0;
+    } else if (r >= ACC_OUT_X_MSB && r <= ACC_OUT_Z_LSB) {
+        const int16_t* s = acc_fifo_mode() ? acc.fifo[acc.head] : acc.out;
+        int16_t c = (int16_t)(s[(r - 1) / 2] << 2);     // 14-bit, left justified
+
+        v = ((r - 1) & 1) ? (uint8_t)c : (uint8_t)(c >> 8);
+        if (r == ACC_OUT_Z_LSB) {
+            if (acc_fifo_mode() && acc.count) {
+                acc.head = (acc.head + 1) % ACC_FIFO_SIZE;
+                acc.count--;
+            } else if (!acc_fifo_mode()) {
+                acc.reg[ACC_STATUS] &= ~(ACC_ZYXDR | ACC_ZYXOW);
+            }
+        }
+    } else if (r == ACC_WHO_AM_I) {
+        v = 0x1A;
+    } else {
+        v = (r < ACC_REGS) ? acc.reg[r] : 0;
+    }
+    return v;
+}
+
+static void acc_write_reg(uint8_t r, uint8_t v) {
+    uint8_t was_active;
+
+    if (r >= ACC_REGS || r == ACC_STATUS || (r >= ACC_OUT_X_MSB && r <= ACC_OUT_Z_LSB)) {
+        return;                         // Read-only
+    }
+    was_active = acc.reg[ACC_CTRL_REG1] & 1;
+    acc.reg[r] = v;
+    if (r == ACC_CTRL_REG1 && (v & 1) && !was_active) {
+        acc.next_t = host_now + acc_period();
+    } else if (r == ACC_CTRL_REG1 && !(v & 1)) {
+        acc.next_t = HOST_NEVER;
+    }
+    if (r == ACC_F_SETUP && (v >> 6) == 0) {
+        acc.count = 0;
+        acc.ovf = 0;
+    }
+    acc_int_update();
+}
+
+uint8_t model_i2c_address(uint8_t addr, uint8_t read) {
+    acc.selected = (addr == ACC_ADDR);
+    acc.ptr_written = read;             // A read continues at the last address
+    return acc.selected;
+}
+
+uint8_t model_i2c_write(uint8_t data) {
+    if (!acc.selected) {
+        return 0;
+    }
+    if (!acc.ptr_written) {
+        acc.ptr = data;
+        acc.ptr_written = 1;
+    } else {
+        acc_write_reg(acc.ptr++, data);
+    }
+    return 1;
+}
+
+uint8_t model_i2c_read(void) {
+    uint8_t r = acc.ptr;
+    uint8_t v;
+
+    if (!acc.selected) {
+        return 0xFF;
+    }
+    v = acc_read_reg(r);
+
+    // FIFO mode wraps the burst from OUT_Z_LSB back to OUT_X_MSB
+    acc.ptr = (acc_fifo_mode() && r == ACC_OUT_Z_LSB) ? ACC_OUT_X_MSB : (uint8_t)(r + 1);
+    acc_int_update();
+    return v;
+}
+
+void model_i2c_stop(void) {
+    acc.selected = 0;
+}
+
+uint8_t model_i2c_hung(void) {
+    return host_now < acc.hang_end;
+}
+
+void model_i2c_hang(uint16_t ms) {
+    acc.hang_end = host_now + HOST_MS(ms);
+}
+
+void model_accel_set(int16_t x_mg, int16_t y_mg, int16_t z_mg) {
+    acc.mg[0] = x_mg;
+    acc.mg[1] = y_mg;
+    acc.mg[2] = z_mg;
+}
+
+void model_accel_spike(int16_t x_mg) {
+    acc.spike = x_mg;
+}
+
+void model_accel_vibrate(uint16_t hz, int16_t mg) {
+    acc.vib_mg = mg;
+    acc.vib_step = 2 * MODEL_PI * hz * 100 / acc_odr_hz_x100[(acc.reg[ACC_CTRL_REG1] >> 3) & 7];
+    acc.vib_phase = 0;
+}
+
+// Sine without libm: reduced to -pi..pi, Taylor series to x^17
+double model_sin(double x) {
+    double term, sum;
+
+    x -= 2 * MODEL_PI * (double)(int64_t)(x / (2 * MODEL_PI));
+    if (x > MODEL_PI) {
+        x -= 2 * MODEL_PI;
+    } else if (x < -MODEL_PI) {
+        x += 2 * MODEL_PI;
+    }
+    term = sum = x;
+    for (int n = 3; n <= 17; n += 2) {
+        term *= -x * x / (n * (n - 1));
+        sum += term;
+    }
+    return sum;
+}
+
+/*-------------------------------------------------------------------------
+ * RCW-0001
+ *-------------------------------------------------------------------------*/
+static struct {
+    uint8_t trig;
+    uint64_t trig_t;                    // Trigger rising edge
+    uint16_t object_mm;                 // 0 = nothing in range
+    uint16_t glitch_mm;                 // Next echo only, 0 = none
+    uint16_t drop;                      // Pings to ignore
+    uint64_t rise_t, fall_t;            // Scheduled echo edges
+    uint32_t pings, echoes, ignored;
+} rcw = { .rise_t = HOST_NEVER, .fall_t = HOST_NEVER };
+
+static void rcw_trigger(uint8_t level) {
+    uint64_t width;
+    uint16_t mm;
+
+    if (level == rcw.trig) {
+        return;
+    }
+    rcw.trig = level;
+    if (level) {
+        rcw.trig_t = host_now;
+        return;
+    }
+    if (host_now - rcw.trig_t < HOST_US(TRIG_MIN_US) || rcw.fall_t != HOST_NEVER) {
+        rcw.ignored++;                  // Too short or echo still in progress
+        return;
+    }
+    rcw.pings++;
+    if (rcw.drop) {
+        rcw.drop--;
+        return;
+    }
+    mm = rcw.glitch_mm ? rcw.glitch_mm : rcw.object_mm;
+    rcw.glitch_mm = 0;
+    if (mm == 0 || mm > ECHO_MAX_MM) {
+        width = HOST_US(ECHO_NONE_US);
+    } else {
+        width = (uint64_t)mm * 2 * HOST_CLOCK_HZ / ECHO_SOUND_MM_S;    // Round trip
+    }
+    rcw.rise_t = host_now + HOST_US(ECHO_DELAY_US);
+    rcw.fall_t = rcw.rise_t + width;
+}
+
+void model_object(uint16_t mm) {
+    rcw.object_mm = mm;
+}
+
+void model_echo_glitch(uint16_t mm) {
+    rcw.glitch_mm = mm;
+}
+
+void model_echo_drop(uint16_t pings) {
+    rcw.drop = pings;
+}
+
+/*-------------------------------------------------------------------------
+ * Keypad
+ *-------------------------------------------------------------------------*/
+static const uint8_t key_rows[3] = { 12, 7, 11 };
+static const uint8_t key_cols[4] = { 9, 8, 5, 6 };
+
+// Same wiring as keyboard.c: keymap column c is connected to key_cols[3 - c]
+static const char keymap[3][4] = {
+    {'7', '8', '9', '0'},
+    {'4', '5', '6', '#'},
+    {'1', '2', '3', 'C'}
+};
+
+static struct {
+    char queue[KEY_QUEUE + 1];
+    uint8_t pos;
+    char down;                          // Key held, 0 = none
+    char contact;                       // Key closing its contact, 0 = none
+    char last;                          // Key of the last press
+    uint64_t next_t;
+    uint64_t bounce_t;                  // Next contact change, HOST_NEVER if settled
+    uint64_t bounce_end;                // Contact follows the key from then
+    uint16_t bounce_ms;                 // Bounce time per edge, 0 = clean contacts
+    uint32_t bounce_rng;
+    uint32_t presses, bounces;
+} keys = { .next_t = HOST_NEVER, .bounce_t = HOST_NEVER, .bounce_rng = 1 };
+
+static void keypad_rows(void) {
+    for (uint8_t r = 0; r < 3; r++) {
+        uint8_t level = 1;              // Pull-up
+
+        for (uint8_t c = 0; c < 4 && keys.contact; c++) {
+            if (keymap[r][c] == keys.contact && !host_pin_level(HOST_PORT_A, key_cols[3 - c])) {
+                level = 0;
+            }
+        }
+        host_pin_input(HOST_PORT_A, key_rows[r], level);
+    }
+}
+
+void model_keys(const char* k) {
+    size_t n = strlen(keys.queue);
+
+    strncat(keys.queue, k, KEY_QUEUE - n);
+    if (keys.next_t == HOST_NEVER) {
+        keys.next_t = host_now;
+    }
+}
+
+void model_key_bounce(uint16_t ms) {
+    keys.bounce_ms = ms;
+}
+
+// Random gap between contact changes while bouncing, 50..1050 us
+static uint64_t keypad_bounce_gap(void) {
+    keys.bounce_rng = keys.bounce_rng * 1664525u + 1013904223u;
+    return HOST_US(50 + (keys.bounce_rng >> 22));
+}
+
+// Contact change while bouncing, settles on the key state at the end
+static void keypad_bounce(void) {
+    if (host_now >= keys.bounce_end) {
+        keys.contact = keys.down;
+        keys.bounce_t = HOST_NEVER;
+    } else {
+        keys.contact = keys.contact ? 0 : keys.last;
+        keys.bounce_t = host_now + keypad_bounce_gap();
+        keys.bounces++;
+    }
+    keypad_rows();
+}
+
+static void keypad_step(void) {
+    if (keys.down) {
+        keys.down = 0;
+        keys.next_t = host_now + HOST_MS(KEY_GAP_MS);
+    } else if (keys.queue[keys.pos]) {
+        keys.down = keys.last = keys.queue[keys.pos++];
+        keys.next_t = host_now + HOST_MS(KEY_PRESS_MS);
+        keys.presses++;
+        host_trace("key %c", keys.down);
+    } else {
+        keys.queue[0] = 0;
+        keys.pos = 0;
+        keys.next_t = HOST_NEVER;
+        return;
+    }
+    keys.contact = keys.down;
+    if (keys.bounce_ms) {
+        keys.bounce_end = host_now + HOST_MS(keys.bounce_ms);
+        keys.bounce_t = host_now + keypad_bounce_gap();
+    }
+    keypad_rows();
+}
+
+/*-------------------------------------------------------------------------
+ * DAC Sink
+ *-------------------------------------------------------------------------*/
+static struct {
+    uint8_t on;
+    uint64_t samples;
+    FILE* dump;
+} dac;
+
+void model_dac_sample(uint16_t value) {
+    if (!dac.on) {
+        dac.on = 1;
+        scenario_siren(1);
+    }
+    dac.samples++;
+    if (dac.dump) {
+        fwrite(&value, sizeof(value), 1, dac.dump);
+    }
+}
+
+void model_dac_stream(uint8_t active) {
+    if (!active && dac.on) {
+        dac.on = 0;
+        scenario_siren(0);
+    }
+}
+
+/*-------------------------------------------------------------------------
+ * Function: models_init
+ * Purpose: Power-on state of the devices
+ * Parameters: None
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+void models_init(void) {
+    const char* dump = getenv("ALARM_DAC_DUMP");
+
+    memset(acc.reg, 0, sizeof(acc.reg));
+    acc.next_t = HOST_NEVER;
+    model_accel_set(0, 0, 1000);        // Resting, 1 g on Z
+    if (dump && (dac.dump = fopen(dump, "wb")) == 0) {
+        perror(dump);
+    }
+}
+
+/*-------------------------------------------------------------------------
+ * Function: models_next
+ * Purpose: Earliest model or scenario event
+ * Parameters: None
+ * Returns: uint64_t - event time, HOST_NEVER if none
+ *-------------------------------------------------------------------------*/
+uint64_t models_next(void) {
+    uint64_t t = scenario_next();
+
+    if (acc.next_t < t) t = acc.next_t;
+    if (rcw.rise_t < t) t = rcw.rise_t;
+    if (rcw.fall_t < t) t = rcw.fall_t;
+    if (keys.next_t < t) t = keys.next_t;
+    if (keys.bounce_t < t) t = keys.bounce_t;
+    return t;
+}
+
+/*-------------------------------------------------------------------------
+ * Function: models_run
+ * Purpose: Process model events due at the current time
+ * Parameters: now - current time
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+void models_run(uint64_t now) {
+    if (acc.next_t <= now) {
+        acc.next_t += acc_period();
+        acc_sample();
+    }
+    if (rcw.rise_t <= now) {
+        rcw.rise_t = HOST_NEVER;
+        host_pin_input(HOST_PORT_B, ECHO_PIN, 1);
+    }
+    if (rcw.fall_t <= now) {
+        rcw.fall_t = HOST_NEVER;
+        rcw.echoes++;
+        host_pin_input(HOST_PORT_B, ECHO_PIN, 0);
+    }
+    if (keys.next_t <= now) {
+        keypad_step();
+    }
+    if (keys.bounce_t <= now) {
+        keypad_bounce();
+    }
+    if (scenario_next() <= now) {
+        scenario_run(now);
+    }
+}
+
+/*-------------------------------------------------------------------------
+ * Function: models_pins_changed
+ * Purpose: React to MCU outputs - trigger pin and keypad columns
+ * Parameters: None
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+void models_pins_changed(void) {
+    rcw_trigger(host_pin_level(HOST_PORT_B, TRIG_PIN));
+    keypad_rows();
+}
+
+/*-------------------------------------------------------------------------
+ * Function: model_report
+ * Purpose: Print device statistics at the end of a scenario
+ * Parameters: None
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+void model_report(void) {
+    printf("accel:     %u samples\n", acc.samples);
+    printf("ranging:   %u pings, %u echoes, %u triggers ignored\n",
+           rcw.pings, rcw.echoes, rcw.ignored);
+    printf("keypad:    %u presses, %u contact bounces\n", keys.presses, keys.bounces);
+    printf("dac:       %llu samples\n", (unsigned long long)dac.samples);
+    if (dac.dump) {
+        fclose(dac.dump);
+    }
+}
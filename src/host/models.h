@@ -0,0 +1,93 @@
+#ifndef MODELS_H
+#define MODELS_H
+
+/*-------------------------------------------------------------------------
+ * Technika Mikroprocesorowa 2 - Project
+ * Project: Security Alarm System
+ * File: host/models.h
+ *
+ * Interface between the simulated MCU (host.c), the external device
+ * models (models.c) and the scenario runner (scenario.c).
+ * Time is counted in core clock cycles since reset.
+ *-------------------------------------------------------------------------*/
+
+#include <stdint.h>
+
+#define HOST_CLOCK_HZ       41943040u   // FEI default core clock
+#define HOST_NEVER          UINT64_MAX
+#define HOST_US(us)         ((uint64_t)(us) * HOST_CLOCK_HZ / 1000000u)
+#define HOST_MS(ms)         ((uint64_t)(ms) * HOST_CLOCK_HZ / 1000u)
+#define HOST_TO_US(t)       ((double)(t) * 1e6 / HOST_CLOCK_HZ)
+#define HOST_TO_MS(t)       ((double)(t) * 1e3 / HOST_CLOCK_HZ)
+#define MODEL_PI            3.14159265358979323846
+
+#define HOST_PORT_A         0
+#define HOST_PORT_B         1
+
+typedef struct {
+    uint32_t irq[33];                   // Handler runs per line, SysTick last
+    uint64_t irq_max[33];               // Longest handler run, nested ones included
+    uint64_t idle;                      // Cycles spent in WFI
+    uint64_t stop;                      // ... of them in VLPS
+    uint64_t sleep_t;                   // Start of the WFI in progress, HOST_NEVER if awake
+    uint64_t polls;                     // Busy-wait iterations
+    uint32_t flash_program;             // Longwords programmed
+    uint32_t flash_erase[32];           // Erases per 1 KB sector
+} HostStats;
+
+/*-------------------------------------------------------------------------
+ * Simulated MCU (host.c)
+ *-------------------------------------------------------------------------*/
+extern uint64_t host_now;
+extern HostStats host_stats;
+
+void host_pin_input(uint8_t port, uint8_t pin, uint8_t level);
+uint8_t host_pin_level(uint8_t port, uint8_t pin);
+uint8_t host_siren_active(void);
+const char* host_irq_name(uint8_t line);
+void host_fault(const char* msg);
+void host_trace(const char* fmt, ...);
+extern uint8_t host_tracing;
+
+/*-------------------------------------------------------------------------
+ * Device Models (models.c)
+ *-------------------------------------------------------------------------*/
+void models_init(void);
+uint64_t models_next(void);
+void models_run(uint64_t now);
+void models_pins_changed(void);
+
+uint8_t model_i2c_address(uint8_t addr, uint8_t read);
+uint8_t model_i2c_write(uint8_t data);
+uint8_t model_i2c_read(void);
+void model_i2c_stop(void);
+uint8_t model_i2c_hung(void);
+void model_dac_sample(uint16_t value);
+void model_dac_stream(uint8_t active);
+
+void model_accel_set(int16_t x_mg, int16_t y_mg, int16_t z_mg);
+void model_accel_spike(int16_t x_mg);
+void model_accel_vibrate(uint16_t hz, int16_t mg);
+void model_i2c_hang(uint16_t ms);
+double model_sin(double x);
+void model_object(uint16_t mm);
+void model_echo_glitch(uint16_t mm);
+void model_echo_drop(uint16_t pings);
+void model_keys(const char* keys);
+void model_key_bounce(uint16_t ms);
+void model_report(void);
+
+/*-------------------------------------------------------------------------
+ * Scenario Runner (scenario.c)
+ *-------------------------------------------------------------------------*/
+void scenario_init(void);
+uint64_t scenario_next(void);
+void scenario_run(uint64_t now);
+void scenario_siren(uint8_t on);
+
+/*-------------------------------------------------------------------------
+ * Benchmarks (bench.c)
+ *-------------------------------------------------------------------------*/
+void bench_run(const char* name);
+
+#endif /* MODELS_H */
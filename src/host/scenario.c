@@ -0,0 +1,671 @@
+/*-------------------------------------------------------------------------
+ * Technika Mikroprocesorowa 2 - Project
+ * Project: Security Alarm System
+ * File: host/scenario.c
+ *
+ * This file implements the scripted scenarios of the host build:
+ * - Script lines "<ms> <action> [args]", lines starting with '#' are
+ *   comments ('#' is also a key)
+ * - Actions: key, key_bounce, accel, spike, vibrate, i2c_hang, object,
+ *   echo_glitch, echo_drop,
+ *   expect siren on|off, expect armed on|off, expect admin on|off,
+ *   expect stop <min %>, end
+ * - Built-in scenarios (ALARM_SCENARIO=intrusion|shake|glitch|
+ *   code_change|code_persist|idle|entry_timeout|entry_delay|tamper|
+ *   rumble|tilt|code_clash|i2c_hang|bounce) or a script file
+ *   (ALARM_SCRIPT)
+ * - Report: simulated vs wall time, CPU idle share, interrupt counts,
+ *   detection latency without the entry delay; exit status 1 if an
+ *   expectation failed
+ * - With PROFILE_ISR: profiler statistics checked against the handler
+ *   times measured by the simulator
+ *-------------------------------------------------------------------------*/
+
+#include "models.h"
+#include "eventlog.h"
+#include "codes.h"
+#include "power.h"
+#include "TPM.h"
+#include "alarmfsm.h"
+#ifdef PROFILE_ISR
+#include "profile.h"
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/*-------------------------------------------------------------------------
+ * Constants
+ *-------------------------------------------------------------------------*/
+#define MAX_STEPS       1024
+#define MAX_LINE        128
+#define LOG_SHOWN       6               // Newest log records in the report
+
+/*-------------------------------------------------------------------------
+ * Built-in Scenarios
+ *-------------------------------------------------------------------------*/
+// Object in range while armed, siren after the entry delay, disarm
+// with the code, re-arm
+static const char* const intrusion[] = {
+    "1000 object 80",
+    "2000 expect siren off",
+    "7000 expect siren on",
+    "7100 key 1234#",
+    "8000 expect siren off",
+    "8100 object 0",
+    "8200 key #1234#",
+    "9000 expect armed on",
+    "19500 expect siren off",
+    "20000 end",
+    0
+};
+
+// Sustained acceleration above the motion threshold
+static const char* const shake[] = {
+    "1000 accel 1500 0 1000",
+    "1200 accel 0 0 1000",
+    "2000 expect siren off",
+    "7000 expect siren on",
+    "7100 key 1234#",
+    "8000 expect siren off",
+    "8500 end",
+    0
+};
+
+// Single outliers that the filters must reject
+static const char* const glitch[] = {
+    "1000 spike 3000",
+    "1500 echo_glitch 50",
+    "2000 echo_drop 3",
+    "3000 expect siren off",
+    "3500 end",
+    0
+};
+
+// Admin mode sets a new 6-digit user code, which must work at once.
+// "43#" is rejected at the '#' and must not disturb the next code.
+static const char* const code_change[] = {
+    "1000 key 43#4321#",
+    "2000 key 567890#",
+    "3000 expect armed off",
+    "3100 key 567890#",
+    "4000 expect armed on",
+    "4500 end",
+    0
+};
+
+// Run after code_change on the same ALARM_FLASH image
+static const char* const code_persist[] = {
+    "500 expect armed on",
+    "1000 key 1234#",
+    "1700 expect armed on",
+    "2000 key 567890#",
+    "2900 expect armed off",
+    "3000 end",
+    0
+};
+
+// Disarmed and quiet: only accelerometer batches and the event log
+// task wake the CPU, which spends the rest in VLPS
+static const char* const idle[] = {
+    "500 key 1234#",
+    "1500 expect armed off",
+    "11500 expect stop 90",
+    "12000 end",
+    0
+};
+
+// A code typed with a long pause is dropped by the entry timer: "12"
+// expires, "34#" is too short and the alarm stays armed
+static const char* const entry_timeout[] = {
+    "500 key 12",
+    "11000 key 34#",
+    "12000 expect armed on",
+    "12100 key 1234#",
+    "13000 expect armed off",
+    "13500 end",
+    0
+};
+
+// An object seen during the exit delay is ignored; once armed, the
+// code typed within the entry delay disarms before the siren starts
+static const char* const entry_delay[] = {
+    "500 key 1234#",
+    "1500 expect armed off",
+    "1600 key #1234#",
+    "2000 object 80",
+    "4000 object 0",
+    "10000 expect siren off",
+    "13000 object 80",
+    "15000 key 1234#",
+    "16000 expect armed off",
+    "16100 object 0",
+    "19000 expect siren off",
+    "19500 end",
+    0
+};
+
+// Tool contact: a 250 Hz vibration far below the motion threshold
+static const char* const tamper[] = {
+    "1000 vibrate 250 60",
+    "2000 expect siren off",
+    "7000 expect siren on",
+    "7100 vibrate 0 0",
+    "7200 key 1234#",
+    "8000 expect siren off",
+    "8500 end",
+    0
+};
+
+// Strong low-frequency rumble (passing truck) must not trigger
+static const char* const rumble[] = {
+    "1000 vibrate 20 400",
+    "5000 vibrate 0 0",
+    "11000 expect siren off",
+    "11500 end",
+    0
+};
+
+// Mounted at 45 degrees and armed there: a 600 mg push across gravity,
+// which no axis would show above the old 1.3 g limit, is detected
+static const char* const tilt[] = {
+    "500 key 1234#",
+    "1500 expect armed off",
+    "2000 accel 707 0 707",
+    "3000 key #1234#",
+    "15000 expect siren off",
+    "15000 accel 707 600 707",
+    "15300 accel 707 0 707",
+    "16000 expect siren off",
+    "21000 expect siren on",
+    "21100 key 1234#",
+    "22000 expect siren off",
+    "22500 end",
+    0
+};
+
+// The admin code offered as the new user code is refused: admin mode
+// stays until its timeout, the admin code still opens it and a free
+// code then arms and disarms
+static const char* const code_clash[] = {
+    "1000 key 4321#",
+    "2000 key 4321#",
+    "2800 expect admin on",
+    "35000 expect admin off",
+    "35000 expect armed off",
+    "35100 key 4321#",
+    "36000 expect admin on",
+    "36100 key 5555#",
+    "37000 expect admin off",
+    "37100 key 5555#",
+    "38000 expect armed on",
+    "38100 key 5555#",
+    "39000 expect armed off",
+    "39100 key 4321#",
+    "40000 expect admin on",
+    "40500 end",
+    0
+};
+
+// The accelerometer hangs the bus for 2 s: each stuck burst is aborted at
+// its deadline and retried, then batches flow and the CPU is back in VLPS
+static const char* const i2c_hang[] = {
+    "500 key 1234#",
+    "1500 expect armed off",
+    "2000 i2c_hang 2000",
+    "4500 expect armed off",
+    "14500 expect stop 90",
+    "15000 end",
+    0
+};
+
+// Every key contact chatters for 8 ms after press and release: each key
+// is confirmed once, a doubled or lost digit would not match the code
+static const char* const bounce[] = {
+    "100 key_bounce 8",
+    "500 key 1234#",
+    "1500 expect armed off",
+    "1600 key #1234#",
+    "2600 expect armed on",
+    "2700 key 1234#",
+    "3700 expect armed off",
+    "4000 end",
+    0
+};
+
+static const struct {
+    const char* name;
+    const char* const* lines;
+} builtins[] = {
+    { "intrusion", intrusion },
+    { "shake", shake },
+    { "glitch", glitch },
+    { "code_change", code_change },
+    { "code_persist", code_persist },
+    { "idle", idle },
+    { "entry_timeout", entry_timeout },
+    { "entry_delay", entry_delay },
+    { "tamper", tamper },
+    { "rumble", rumble },
+    { "tilt", tilt },
+    { "code_clash", code_clash },
+    { "i2c_hang", i2c_hang },
+    { "bounce", bounce },
+};
+
+/*-------------------------------------------------------------------------
+ * Static Variables
+ *-------------------------------------------------------------------------*/
+static struct {
+    uint64_t at;
+    char text[MAX_LINE];
+} steps[MAX_STEPS];
+
+static const char* name = "intrusion";
+static uint16_t step_count, step_idx;
+static uint8_t siren;
+static uint64_t stimulus_t = HOST_NEVER;       // First threat since the siren or a key
+static uint32_t siren_starts;
+static double latency_sum, latency_max;
+static uint32_t passed, failed;
+static uint64_t mark_t, mark_stop;      // Time and VLPS cycles at the last expect
+static struct timespec wall_start;
+
+/*-------------------------------------------------------------------------
+ * Function: add_line
+ * Purpose: Parse "<ms> <action...>" into the step list
+ * Parameters: line - script line
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+static void add_line(const char* line) {
+    char* end;
+    unsigned long ms;
+
+    while (*line == ' ' || *line == '\t') line++;
+    if (*line == '#' || *line == '\n' || *line == '\r' || *line == 0) {
+        return;
+    }
+    ms = strtoul(line, &end, 10);
+    if (end == line || step_count == MAX_STEPS) {
+        fprintf(stderr, "scenario: bad line: %s\n", line);
+        exit(2);
+    }
+    while (*end == ' ' || *end == '\t') end++;
+    steps[step_count].at = HOST_MS(ms);
+    strncpy(steps[step_count].text, end, MAX_LINE - 1);
+    steps[step_count].text[strcspn(steps[step_count].text, "\r\n")] = 0;
+    if (step_count && steps[step_count].at < steps[step_count - 1].at) {
+        fprintf(stderr, "scenario: steps out of order: %s\n", line);
+        exit(2);
+    }
+    step_count++;
+}
+
+/*-------------------------------------------------------------------------
+ * Function: scenario_init
+ * Purpose: Load the scenario selected by the environment
+ * Parameters: None
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+void scenario_init(void) {
+    const char* script = getenv("ALARM_SCRIPT");
+    const char* sel = getenv("ALARM_SCENARIO");
+    char line[MAX_LINE];
+
+    if (getenv("ALARM_BENCH")) {
+        bench_run(getenv("ALARM_BENCH"));
+    }
+    clock_gettime(CLOCK_MONOTONIC, &wall_start);
+    if (script) {
+        FILE* f = fopen(script, "r");
+
+        if (!f) {
+            perror(script);
+            exit(2);
+        }
+        while (fgets(line, sizeof(line), f)) {
+            add_line(line);
+        }
+        fclose(f);
+        name = script;
+    } else {
+        uint8_t i;
+
+        if (sel) {
+            name = sel;
+        }
+        for (i = 0; i < sizeof(builtins) / sizeof(builtins[0]); i++) {
+            if (strcmp(builtins[i].name, name) == 0) {
+                break;
+            }
+        }
+        if (i == sizeof(builtins) / sizeof(builtins[0])) {
+            fprintf(stderr, "scenario: unknown '%s' (intrusion, shake, glitch, "
+                    "code_change, code_persist, idle, entry_timeout, entry_delay, tamper, "
+                    "rumble, tilt, code_clash, i2c_hang, bounce)\n", name);
+            exit(2);
+        }
+        for (const char* const* l = builtins[i].lines; *l; l++) {
+            add_line(*l);
+        }
+    }
+    if (step_count == 0 || strcmp(steps[step_count - 1].text, "end") != 0) {
+        fprintf(stderr, "scenario: last step must be 'end'\n");
+        exit(2);
+    }
+}
+
+/*-------------------------------------------------------------------------
+ * Function: scenario_siren
+ * Purpose: Siren started or stopped (DAC sink), measures the latency
+ *          from the first threat not yet answered, entry delay excluded
+ * Parameters: on - 1 when samples start, 0 when the stream stops
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+void scenario_siren(uint8_t on) {
+    siren = on;
+    if (on && stimulus_t != HOST_NEVER) {
+        double ms = HOST_TO_MS(host_now - stimulus_t) - ENTRY_DELAY_MS;
+
+        siren_starts++;
+        latency_sum += ms;
+        if (ms > latency_max) {
+            latency_max = ms;
+        }
+        stimulus_t = HOST_NEVER;
+        host_trace("siren on, %.3f ms after stimulus", ms);
+    } else {
+        host_trace("siren %s", on ? "on" : "off");
+    }
+}
+
+/*-------------------------------------------------------------------------
+ * Function: report_flash
+ * Purpose: Print flash usage and the newest event log records
+ * Parameters: None
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+static void report_flash(void) {
+    static const char* const sources[] = {
+        "?", "boot", "motion", "distance", "arm", "disarm", "code", "duress", "tamper"
+    };
+    static const char* const roles[] = {
+        "none", "user", "admin", "duress", "installer"
+    };
+    uint16_t count = Log_Count();
+    char code[CODE_MAX_DIGITS + 1];
+    Log_Record r;
+
+    printf("flash:     %u longwords programmed, erases:", host_stats.flash_program);
+    for (uint8_t s = 0; s < 32; s++) {
+        if (host_stats.flash_erase[s]) {
+            printf(" 0x%04x x%u", s * 1024, host_stats.flash_erase[s]);
+        }
+    }
+    printf("\ncodes:    ");
+    for (uint8_t i = 0; i < CODES_MAX; i++) {
+        uint8_t role = Codes_Get(i, code);
+
+        if (role != CODE_ROLE_NONE) {
+            printf(" %u:%s/%s", i, code, (role < sizeof(roles) / sizeof(roles[0])) ? roles[role] : "?");
+        }
+    }
+    printf("\n");
+    printf("eventlog:  %u records\n", count);
+    for (uint16_t n = 0; n < count && n < LOG_SHOWN; n++) {
+        if (!Log_Read(n, &r)) {
+            printf("           (torn record)\n");
+            continue;
+        }
+        printf("           %10.3f s %-8s %5u%s\n", r.time / 1000.0,
+               (r.source < sizeof(sources) / sizeof(sources[0])) ? sources[r.source] : "?",
+               r.value, (r.flags & LOG_ARMED) ? " armed" : "");
+    }
+}
+
+#ifdef PROFILE_ISR
+/*-------------------------------------------------------------------------
+ * Function: report_profile
+ * Purpose: Print the profiler statistics and compare the longest time of
+ *          each handler with the one seen by the simulator. They must
+ *          agree within one PIT1 tick.
+ * Parameters: None
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+static void report_profile(void) {
+    static const int8_t lines[PROF_COUNT] = {
+        PORTA_IRQn, TPM0_IRQn, TPM1_IRQn, DMA0_IRQn, I2C0_IRQn, LPTMR0_IRQn, -1
+    };
+    double tick_us = 2e6 / HOST_CLOCK_HZ;               // PIT1 runs on the bus clock
+
+    for (uint8_t id = 0; id < PROF_COUNT; id++) {
+        const Prof_Stats* s = Prof_Get(id);
+        uint8_t last = 0;
+
+        if (s->count == 0) {
+            continue;
+        }
+        printf("profile:   %-6s n %u, min %.2f us, mean %.2f us, max %.2f us",
+               Prof_Name(id), s->count, s->time_min * tick_us,
+               Prof_Mean(id) * tick_us, s->time_max * tick_us);
+        if (lines[id] >= 0) {
+            double sim_us = HOST_TO_US(host_stats.irq_max[lines[id]]);
+            double diff = s->time_max * tick_us - sim_us;
+
+            printf(" (sim %.2f us)", sim_us);
+            if (diff > tick_us || diff < -tick_us) {
+                printf(" MISMATCH");
+                failed++;
+            }
+        }
+        printf("\n           log2:");
+        for (uint8_t b = 0; b < PROF_BUCKETS; b++) {
+            if (s->hist[b]) {
+                last = b;
+            }
+        }
+        for (uint8_t b = 0; b <= last; b++) {
+            printf(" %u", s->hist[b]);
+        }
+        printf("\n");
+    }
+}
+#endif
+
+/*-------------------------------------------------------------------------
+ * Function: report_power
+ * Purpose: Print the firmware's residency counters and microsecond
+ *          clock next to the simulator's. They must agree within
+ *          2 ms + 1 %, plus 1 ms per VLPS stop where the LPO clock is
+ *          used.
+ * Parameters: None
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+static void report_power(void) {
+    Power_Stats ps;
+    double sim[3], fw[3], clock_ms, clock_sim;
+    uint64_t idle = host_stats.idle, stop = host_stats.stop, stopped = 0;
+    uint8_t bad = 0;
+
+    // The firmware counts a sleep when it wakes, leave out the one in progress
+    if (host_stats.sleep_t != HOST_NEVER) {
+        idle -= host_now - host_stats.sleep_t;
+        if (SCB->SCR & SCB_SCR_SLEEPDEEP_MASK) {
+            stopped = host_now - host_stats.sleep_t;
+            stop -= stopped;
+        }
+    }
+    Power_GetStats(&ps);
+    fw[0] = ps.run_ms;
+    fw[1] = ps.wait_ms;
+    fw[2] = ps.stop_ms;
+    sim[0] = HOST_TO_MS(host_now - idle);
+    sim[1] = HOST_TO_MS(idle - stop);
+    sim[2] = HOST_TO_MS(stop);
+    // VLPS is timed on the 1 ms LPO clock, so each stop may be off by a tick
+    for (uint8_t i = 0; i < 3; i++) {
+        double diff = fw[i] - sim[i];
+        double slack = 2 + sim[i] / 100 + (i != 1 ? ps.stop_count : 0);
+
+        if (diff > slack || diff < -slack) {
+            bad = 1;
+        }
+    }
+    printf("power:     run %.0f ms, wait %.0f ms (%u), stop %.0f ms (%u)"
+           " (sim %.1f / %.1f / %.1f ms)%s\n",
+           fw[0], fw[1], ps.wait_count, fw[2], ps.stop_count,
+           sim[0], sim[1], sim[2], bad ? " MISMATCH" : "");
+    failed += bad;
+
+    // TPM0 stands still in VLPS, the clock is advanced on each wake-up
+    clock_ms = TPM0_Micros() / 1000.0;
+    clock_sim = HOST_TO_MS(host_now - stopped);
+    bad = (clock_ms - clock_sim > 2 + ps.stop_count || clock_sim - clock_ms > 2 + ps.stop_count);
+    printf("clock:     %.3f ms on the TPM0 microsecond clock (sim %.3f ms)%s\n",
+           clock_ms, clock_sim, bad ? " MISMATCH" : "");
+    failed += bad;
+}
+
+/*-------------------------------------------------------------------------
+ * Function: report
+ * Purpose: Print the run summary and exit
+ * Parameters: None
+ * Returns: Never
+ *-------------------------------------------------------------------------*/
+static void report(void) {
+    struct timespec wall_end;
+    double wall_ms, sim_ms = HOST_TO_MS(host_now);
+
+    clock_gettime(CLOCK_MONOTONIC, &wall_end);
+    wall_ms = (wall_end.tv_sec - wall_start.tv_sec) * 1e3 +
+              (wall_end.tv_nsec - wall_start.tv_nsec) / 1e6;
+
+    printf("scenario:  %s\n", name);
+    printf("time:      %.1f ms simulated, %.1f ms wall (%.0fx real time)\n",
+           sim_ms, wall_ms, wall_ms > 0 ? sim_ms / wall_ms : 0.0);
+    printf("cpu:       %.2f %% idle, %llu busy-wait polls\n",
+           host_now ? 100.0 * host_stats.idle / host_now : 0.0,
+           (unsigned long long)host_stats.polls);
+    printf("irq:      ");
+    for (uint8_t i = 0; i <= 32; i++) {
+        if (host_stats.irq[i]) {
+            printf(" %s %u", host_irq_name(i), host_stats.irq[i]);
+        }
+    }
+    printf("\n");
+    model_report();
+    report_power();
+    report_flash();
+#ifdef PROFILE_ISR
+    report_profile();
+#endif
+    if (siren_starts) {
+        printf("detection: %u alarm(s), latency mean %.3f ms, max %.3f ms\n",
+               siren_starts, latency_sum / siren_starts, latency_max);
+    }
+    printf("expect:    %u passed, %u failed\n", passed, failed);
+    fflush(stdout);
+    exit(failed ? 1 : 0);
+}
+
+/*-------------------------------------------------------------------------
+ * Function: scenario_next
+ * Purpose: Time of the next script step
+ * Parameters: None
+ * Returns: uint64_t - step time, HOST_NEVER after the end
+ *-------------------------------------------------------------------------*/
+uint64_t scenario_next(void) {
+    return (step_idx < step_count) ? steps[step_idx].at : HOST_NEVER;
+}
+
+/*-------------------------------------------------------------------------
+ * Function: scenario_run
+ * Purpose: Execute the script steps due at the current time
+ * Parameters: now - current time
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+void scenario_run(uint64_t now) {
+    while (step_idx < step_count && steps[step_idx].at <= now) {
+        const char* s = steps[step_idx++].text;
+        char arg[MAX_LINE];
+        int x, y, z;
+
+        host_trace("%s", s);
+        if (sscanf(s, "key_bounce %d", &x) == 1) {
+            model_key_bounce((uint16_t)x);
+        } else if (sscanf(s, "key %127s", arg) == 1) {
+            model_keys(arg);
+            stimulus_t = HOST_NEVER;
+        } else if (sscanf(s, "accel %d %d %d", &x, &y, &z) == 3) {
+            model_accel_set((int16_t)x, (int16_t)y, (int16_t)z);
+            stimulus_t = (stimulus_t == HOST_NEVER) ? now : stimulus_t;
+        } else if (sscanf(s, "vibrate %d %d", &x, &y) == 2) {
+            model_accel_vibrate((uint16_t)x, (int16_t)y);
+            if (y != 0) {
+                stimulus_t = (stimulus_t == HOST_NEVER) ? now : stimulus_t;
+            }
+        } else if (sscanf(s, "i2c_hang %d", &x) == 1) {
+            model_i2c_hang((uint16_t)x);
+        } else if (sscanf(s, "spike %d", &x) == 1) {
+            model_accel_spike((int16_t)x);
+            stimulus_t = (stimulus_t == HOST_NEVER) ? now : stimulus_t;
+        } else if (sscanf(s, "object %d", &x) == 1) {
+            model_object((uint16_t)x);
+            stimulus_t = (stimulus_t == HOST_NEVER) ? now : stimulus_t;
+        } else if (sscanf(s, "echo_glitch %d", &x) == 1) {
+            model_echo_glitch((uint16_t)x);
+            stimulus_t = (stimulus_t == HOST_NEVER) ? now : stimulus_t;
+        } else if (sscanf(s, "echo_drop %d", &x) == 1) {
+            model_echo_drop((uint16_t)x);
+        } else if (sscanf(s, "expect stop %d", &x) == 1) {
+            // VLPS share since the previous expect
+            double pct = (now > mark_t) ? 100.0 * (host_stats.stop - mark_stop) / (now - mark_t) : 0;
+
+            if (pct >= x) {
+                passed++;
+            } else {
+                failed++;
+                printf("[%12.3f ms] FAILED: expect stop %d (%.1f %%)\n", HOST_TO_MS(now), x, pct);
+            }
+        } else if (sscanf(s, "expect siren %127s", arg) == 1) {
+            uint8_t want = (strcmp(arg, "on") == 0);
+
+            if (want == siren) {
+                passed++;
+            } else {
+                failed++;
+                printf("[%12.3f ms] FAILED: expect siren %s\n", HOST_TO_MS(now), arg);
+            }
+        } else if (sscanf(s, "expect armed %127s", arg) == 1) {
+            // Blue LED (PTB10, active low) shows armed and quiet
+            uint8_t want = (strcmp(arg, "on") == 0);
+
+            if (want == !host_pin_level(HOST_PORT_B, 10)) {
+                passed++;
+            } else {
+                failed++;
+                printf("[%12.3f ms] FAILED: expect armed %s\n", HOST_TO_MS(now), arg);
+            }
+        } else if (sscanf(s, "expect admin %127s", arg) == 1) {
+            // Green LED (PTB9, active low) shows admin mode
+            uint8_t want = (strcmp(arg, "on") == 0);
+
+            if (want == !host_pin_level(HOST_PORT_B, 9)) {
+                passed++;
+            } else {
+                failed++;
+                printf("[%12.3f ms] FAILED: expect admin %s\n", HOST_TO_MS(now), arg);
+            }
+        } else if (strcmp(s, "end") == 0) {
+            report();
+        } else {
+            fprintf(stderr, "scenario: unknown action: %s\n", s);
+            exit(2);
+        }
+        if (strncmp(s, "expect ", 7) == 0) {
+            mark_t = now;
+            mark_stop = host_stats.stop;
+        }
+    }
+}
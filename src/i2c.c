@@ -7,16 +7,35 @@
  * @author Koryciak & Sokolowski
  * @date Apr 2021
  * @brief File containing definitions for I2C.
- * @ver 1.0
+ *        Transfers are queued and executed by a state machine in I2C0 IRQ,
+ *        the blocking API is a thin wrapper around the queue. Every transfer
+ *        gets a deadline when it starts, I2C_Expire() aborts it after that.
+ *        Bus recovery (9 SCL clocks to free a slave holding SDA low) is not
+ *        handled; such a bus fails every transfer at its deadline.
+ * @ver 1.1
  */
 
 #include "i2c.h"
+#include "profile.h"
+#include "TPM.h"
 
 /******************************************************************************\
 * Private definitions
 \******************************************************************************/
 #define SCL   3
 #define SDA   4
+
+#define I2C_TIMEOUT_US_PER_BYTE	1000		/* transfer timeout per transferred byte [us] */
+#define I2C_NVIC_PRIORITY			2
+
+typedef enum {
+	I2C_ST_IDLE = 0,
+	I2C_ST_ADDR_W,												/* write address sent */
+	I2C_ST_REG,														/* register number sent */
+	I2C_ST_TX,														/* data byte sent */
+	I2C_ST_ADDR_R,												/* read address sent */
+	I2C_ST_RX															/* data byte received */
+} i2c_state_t;
 /******************************************************************************\
 * Private prototypes
 \******************************************************************************/
@@ -29,15 +48,23 @@ void i2c_enable(void);
 void i2c_disable(void);
 void i2c_send(uint8_t);
 uint8_t i2c_recv(void);
-void i2c_wait(void);
 void i2c_nack(void);
 void i2c_ack(void);
 void i2c_clr_IICIF(void);
+static void i2c_step(void);
+static void i2c_start_xfer(I2C_Xfer* xfer);
+static void i2c_tx_phase(I2C_Xfer* xfer);
+static void i2c_finish(uint8_t err);
+static uint8_t i2c_run(I2C_Xfer* xfer);
 /******************************************************************************\
 * Private memory declarations
 \******************************************************************************/
-static uint8_t error;
-static uint16_t timeout;
+static I2C_Xfer* volatile head = 0;			/* transfer in progress */
+static I2C_Xfer* volatile tail = 0;			/* last queued transfer */
+static volatile i2c_state_t state = I2C_ST_IDLE;
+static volatile uint8_t cnt;						/* bytes transferred in data phase */
+static volatile uint32_t deadline;			/* transfer in progress aborted after [TPM0 us] */
+static void (*start_notify)(void) = 0;	/* called when the bus leaves idle */
 volatile uint8_t dummy;
 
 void I2C_Init(void) {	
@@ -50,160 +77,287 @@ PORTB->PCR[SDA] |= PORT_PCR_MUX(2); 	/* I2C0 SDA	(PTB4) */
 I2C0->C1 &= ~(I2C_C1_IICEN_MASK);			/* disable module during modyfications*/
 I2C0->F  |= I2C_F_MULT(0x01);					/* MULT = 0,1,2 */
 I2C0->F  |= I2C_F_ICR(0x01);					/* SCLdivider = Table 36-28. I2C divider and hold values. Reference Manual p.622 */
+
+NVIC_SetPriority(I2C0_IRQn, I2C_NVIC_PRIORITY);
+NVIC_ClearPendingIRQ(I2C0_IRQn);
+NVIC_EnableIRQ(I2C0_IRQn);
+}
+
+uint8_t I2C_Submit(I2C_Xfer* xfer) {
+
+	uint32_t primask;
+
+	if ((xfer->flags & I2C_XFER_READ) && (xfer->size == 0)) return I2C_ERR_PARAM;
+
+	primask = __get_PRIMASK();
+	__disable_irq();
+	if (xfer->queued) {											/* descriptor still owned by driver */
+		__set_PRIMASK(primask);
+		return I2C_ERR_BUSY;
+	}
+	xfer->queued = 1;
+	xfer->done = 0;
+	xfer->error = 0;
+	xfer->next = 0;
+	if (tail) {
+		tail->next = xfer;										/* bus busy - append */
+		tail = xfer;
+	} else {
+		head = tail = xfer;
+		i2c_start_xfer(xfer);									/* bus idle - start now */
+		if (start_notify) start_notify();
+	}
+	__set_PRIMASK(primask);
+
+	return 0;
+}
+
+uint8_t I2C_Busy(void) {
+	return (head != 0);
+}
+
+uint32_t I2C_Expire(void) {
+
+	uint32_t left = 0;
+	uint32_t primask = __get_PRIMASK();
+
+	__disable_irq();
+	if (head && TPM0_Expired(deadline)) {
+		i2c_m_stop();													/* release the bus, next transfer starts */
+		i2c_finish(I2C_ERR_TIMEOUT);
+	}
+	if (head) {
+		left = deadline - TPM0_Micros();
+		if ((int32_t)left <= 0) left = 1;
+	}
+	__set_PRIMASK(primask);
+
+	return left;
+}
+
+void I2C_SetNotify(void (*notify)(void)) {
+	start_notify = notify;
 }
 
 uint8_t I2C_Ping(uint8_t address) {
-	
-	error = 0x00;
-	
-	i2c_enable();
-	i2c_tran();															/* set to transmit mode */
-	i2c_m_start();													/* send start */
-	i2c_send((uint8_t)(address << 1));  		/* send write address */
-	i2c_wait();															/* wait for ack from slave */
-	i2c_m_stop();														/* clear start mask */
-	i2c_disable();
-	
-	return error;
+
+	I2C_Xfer xfer = {0};
+
+	xfer.address = address;									/* address only, no data */
+	return i2c_run(&xfer);
 }
 
 uint8_t I2C_Write(uint8_t address, uint8_t data) {
-	
-	error = 0x00;
-	
-	i2c_enable();
-	i2c_tran();															/* set to transmit mode */
-	i2c_m_start();													/* send start */
-	i2c_send((uint8_t)(address << 1));  		/* send write address */
-	i2c_wait();															/* wait for ack from slave */
-	i2c_send(data);													/* send data */
-	i2c_wait();
-	i2c_m_stop();														/* clear start mask */
-	i2c_disable();
-	
-	return error;
+
+	I2C_Xfer xfer = {0};
+
+	xfer.address = address;
+	xfer.size = 1;
+	xfer.data = &data;
+	return i2c_run(&xfer);
 }
 
 uint8_t I2C_Read(uint8_t address, uint8_t* data) {
-	
-	error = 0x00;
-	
-	i2c_enable();
-	i2c_tran();															/* set to transmit mode */
-	i2c_m_start();													/* send start */
-	i2c_send((uint8_t)(address << 1)|0x01); /* send read address */
-	i2c_wait();															/* wait for ack from slave */
-	i2c_rec();															/* set to receive mode */
-	i2c_nack();
-	dummy = i2c_recv();										  /* read data */
-	i2c_wait();
-	i2c_m_stop();														/* clear start mask */
-	(*data) = i2c_recv();
-	i2c_disable();
-	
-	return error;
+
+	I2C_Xfer xfer = {0};
+
+	xfer.address = address;
+	xfer.flags = I2C_XFER_READ;
+	xfer.size = 1;
+	xfer.data = data;
+	return i2c_run(&xfer);
 }
 
 uint8_t I2C_WriteReg(uint8_t address, uint8_t reg, uint8_t data) {
-	
-	error = 0x00;
-	
-	i2c_enable();
-	i2c_tran();															/* set to transmit mode */
-	i2c_m_start();													/* send start */
-	i2c_send((uint8_t)(address << 1));  		/* send write address */
-	i2c_wait();															/* wait for ack from slave */
-	i2c_send(reg);													/* select register */
-	i2c_wait();
-	i2c_send(data);													/* send data */
-	i2c_wait();
-	i2c_m_stop();														/* clear start mask */
-	i2c_disable();
-	
-	return error;
+
+	I2C_Xfer xfer = {0};
+
+	xfer.address = address;
+	xfer.reg = reg;
+	xfer.flags = I2C_XFER_REG;
+	xfer.size = 1;
+	xfer.data = &data;
+	return i2c_run(&xfer);
 }
 
 uint8_t I2C_ReadReg(uint8_t address, uint8_t reg, uint8_t* data) {
-	
-	error = 0x00;
-	
-	i2c_enable();
-	i2c_clr_IICIF();
-	i2c_tran();															/* set to transmit mode */
-	i2c_m_start();													/* send start */
-	i2c_send((uint8_t)(address << 1));      /* send write address */
-	i2c_wait();															/* wait for ack from slave */
-	i2c_send(reg);													/* select register */
-	i2c_wait();
-	
-	i2c_m_rstart();
 
-	i2c_send((uint8_t)(address << 1)|0x01); /* send read address */
-	i2c_wait();
-	
-	i2c_rec();															/* set to receive mode */
-	i2c_nack();															/* no acknowledge bit */
-	dummy = i2c_recv();										  /* read data */
-	i2c_wait();
-	i2c_m_stop();														/* clear start mask */
-	(*data) = i2c_recv();
-	
-	i2c_disable();
-	
-	return error;
+	I2C_Xfer xfer = {0};
+
+	xfer.address = address;
+	xfer.reg = reg;
+	xfer.flags = I2C_XFER_REG | I2C_XFER_READ;
+	xfer.size = 1;
+	xfer.data = data;
+	return i2c_run(&xfer);
 }
 
 uint8_t I2C_ReadRegBlock(uint8_t address, uint8_t reg, uint8_t size, uint8_t* data) {
-	
-	error = 0x00;
-	uint8_t cnt = 0;
-	
+
+	I2C_Xfer xfer = {0};
+
+	xfer.address = address;
+	xfer.reg = reg;
+	xfer.flags = I2C_XFER_REG | I2C_XFER_READ;
+	xfer.size = size;
+	xfer.data = data;
+	return i2c_run(&xfer);
+}
+/**
+ * @brief I2C0 interrupt. One step of the transfer state machine per byte.
+ */
+void I2C0_IRQHandler(void) {
+	PROF_ENTER(PROF_I2C0);
+	i2c_step();
+	PROF_EXIT(PROF_I2C0);
+}
+/**
+ * @brief Transfer state machine step, returns early on errors.
+ */
+static void i2c_step(void) {
+
+	I2C_Xfer* xfer = head;
+	uint8_t status = I2C0->S;
+
+	if (!(status & I2C_S_IICIF_MASK)) return;	/* no byte or flag event - spurious */
+	i2c_clr_IICIF();
+	if ((xfer == 0) || (state == I2C_ST_IDLE)) return;
+
+	if (status & I2C_S_ARBL_MASK) {					/* arbitration lost - bus released by hw */
+		HAL_W1C(I2C0->S, I2C_S_ARBL_MASK);
+		i2c_finish(I2C_ERR_ARBL);
+		return;
+	}
+	if ((state != I2C_ST_RX) && (status & I2C_S_RXAK_MASK)) {
+		i2c_m_stop();													/* slave did not acknowledge */
+		i2c_finish(I2C_ERR_NOACK);
+		return;
+	}
+
+	switch (state) {
+	case I2C_ST_ADDR_W:
+		if (xfer->flags & I2C_XFER_REG) {
+			i2c_send(xfer->reg);								/* select register */
+			state = I2C_ST_REG;
+		} else {
+			i2c_tx_phase(xfer);
+		}
+		break;
+	case I2C_ST_REG:
+		if (xfer->flags & I2C_XFER_READ) {
+			i2c_m_rstart();
+			i2c_send((uint8_t)(xfer->address << 1)|0x01); /* send read address */
+			state = I2C_ST_ADDR_R;
+		} else {
+			i2c_tx_phase(xfer);
+		}
+		break;
+	case I2C_ST_TX:
+		i2c_tx_phase(xfer);
+		break;
+	case I2C_ST_ADDR_R:
+		i2c_rec();														/* set to receive mode */
+		if (xfer->size == 1) i2c_nack();			/* single byte - no acknowledge bit */
+		else                 i2c_ack();
+		dummy = i2c_recv();										/* start first read */
+		state = I2C_ST_RX;
+		break;
+	case I2C_ST_RX:
+		if ((xfer->size - cnt) == 1) {
+			i2c_m_stop();												/* last byte - stop before reading D */
+			xfer->data[cnt++] = i2c_recv();
+			i2c_finish(0);
+		} else {
+			if ((xfer->size - cnt) == 2) i2c_nack();	/* no acknowledge for last byte */
+			xfer->data[cnt++] = i2c_recv();
+		}
+		break;
+	default:
+		break;
+	}
+}
+/**
+ * @brief Start transfer at the head of the queue.
+ */
+static void i2c_start_xfer(I2C_Xfer* xfer) {
+	cnt = 0;
+	deadline = TPM0_Deadline(I2C_TIMEOUT_US_PER_BYTE * ((uint32_t)xfer->size + 3));
 	i2c_enable();
+	I2C0->C1 |= I2C_C1_IICIE_MASK;
 	i2c_clr_IICIF();
+	i2c_ack();
 	i2c_tran();															/* set to transmit mode */
 	i2c_m_start();													/* send start */
-	i2c_send((uint8_t)(address << 1));      /* send write address */
-	i2c_wait();															/* wait for ack from slave */
-	i2c_send(reg);													/* select register */
-	i2c_wait();
-	
-	i2c_m_rstart();
-
-	i2c_send((uint8_t)(address << 1)|0x01); /* send read address */
-	i2c_wait();
-	
-	i2c_rec();															/* set to receive mode */
-	
-	i2c_ack();														/* transmit acknowledge bit */
-	dummy = i2c_recv();										/* read data */
-	
-	while(cnt < (size-2)) {
-		i2c_wait();	
-		data[cnt++] = i2c_recv();
+	if ((xfer->flags & (I2C_XFER_REG | I2C_XFER_READ)) == I2C_XFER_READ) {
+		i2c_send((uint8_t)(xfer->address << 1)|0x01); /* send read address */
+		state = I2C_ST_ADDR_R;
+	} else {
+		i2c_send((uint8_t)(xfer->address << 1));	/* send write address */
+		state = I2C_ST_ADDR_W;
 	}
-	i2c_nack();	/* no acknowledge bit */
-	i2c_wait();
-	data[cnt++] = i2c_recv();
-															
-	i2c_wait();
-	i2c_m_stop();														/* set start mask off */	
-	data[cnt] = i2c_recv();
+}
+/**
+ * @brief Send next data byte or stop when all bytes are sent.
+ */
+static void i2c_tx_phase(I2C_Xfer* xfer) {
+	if (cnt < xfer->size) {
+		i2c_send(xfer->data[cnt++]);					/* send data */
+		state = I2C_ST_TX;
+	} else {
+		i2c_m_stop();													/* clear start mask */
+		i2c_finish(0);
+	}
+}
+/**
+ * @brief Complete transfer at the head of the queue and start the next one.
+ *        Must be called with I2C0 IRQ unable to preempt.
+ */
+static void i2c_finish(uint8_t err) {
+	I2C_Xfer* xfer = head;
 
+	I2C0->C1 &= ~I2C_C1_IICIE_MASK;
 	i2c_disable();
-	
-	return error;
+	NVIC_ClearPendingIRQ(I2C0_IRQn);				/* request of the finished transfer */
+	state = I2C_ST_IDLE;
+
+	head = xfer->next;
+	if (head == 0) tail = 0;
+	xfer->next = 0;
+	xfer->error = err;
+	xfer->queued = 0;
+	xfer->done = 1;
+	if (xfer->callback) xfer->callback(xfer);	/* may submit again */
+
+	if (head && (state == I2C_ST_IDLE)) i2c_start_xfer(head);
+}
+/**
+ * @brief Submit transfer and wait for its completion (blocking API). Each
+ *        transfer ahead in the queue is bounded by its own deadline.
+ */
+static uint8_t i2c_run(I2C_Xfer* xfer) {
+	uint8_t err;
+
+	err = I2C_Submit(xfer);
+	if (err) return err;
+
+	while (!xfer->done) {
+		I2C_Expire();
+		HAL_POLL();
+	}
+
+	return xfer->error;
 }
 /**
  * @brief I2C master start.
  */
 void i2c_m_start(void) {
-  I2C0->C1 |= I2C_C1_MST_MASK;
+  HAL_I2C_START(I2C0);
 }
 /**
  * @brief I2C master stop.
  */
 void i2c_m_stop(void) {
-  I2C0->C1 &= ~I2C_C1_MST_MASK;
+  HAL_I2C_STOP(I2C0);
 }
 /**
  * @brief I2C master restart. (errata for Mask 2N96F)
@@ -244,24 +398,13 @@ void i2c_disable(void) {
  * @brief I2C send data.
  */
 void i2c_send(uint8_t data) {
-	I2C0->D = data;
+	HAL_I2C_WRITE(I2C0, data);
 }
 /**
  * @brief I2C receive data.
  */
 uint8_t i2c_recv(void) {
-	return I2C0->D;
-}
-/**
- * @brief I2C wait.
- */
-void i2c_wait(void) {
-  timeout = 0;
-	
-  while ((((I2C0->S & I2C_S_IICIF_MASK)==0)||((I2C0->S & I2C_S_TCF_MASK)==0)) && (timeout<10000)) timeout++;
-  if (timeout >= 10000) 						  error |= I2C_ERR_TIMEOUT; 
-	if ((I2C0->S & I2C_S_RXAK_MASK)==1) error |= I2C_ERR_NOACK;
-	i2c_clr_IICIF();
+	return HAL_I2C_READ(I2C0);
 }
 /**
  * @brief I2C transmit no acknowledge bit.
@@ -276,6 +419,6 @@ void i2c_ack(void) {
   I2C0->C1 &= ~I2C_C1_TXAK_MASK;
 }
 void i2c_clr_IICIF(void) {
-  I2C0->S |= I2C_S_IICIF_MASK;
+  HAL_W1C_OR(I2C0->S, I2C_S_IICIF_MASK);
 }
 
@@ -20,10 +20,63 @@
 \******************************************************************************/
 #define I2C_ERR_TIMEOUT		0x01 		/* error = timeout */
 #define I2C_ERR_NOACK			0x02 		/* error = no ACK from slave  */
+#define I2C_ERR_ARBL			0x04 		/* error = arbitration lost */
+#define I2C_ERR_BUSY			0x08 		/* error = descriptor already queued */
+#define I2C_ERR_PARAM			0x10 		/* error = invalid descriptor */
+
+#define I2C_XFER_READ			0x01 		/* read from slave (write otherwise) */
+#define I2C_XFER_REG			0x02 		/* send register number before data */
+
+typedef struct I2C_Xfer I2C_Xfer;
+typedef void (*I2C_Callback)(I2C_Xfer* xfer);
+/**
+ * @brief Transfer descriptor. Owned by the driver from I2C_Submit() until done.
+ */
+struct I2C_Xfer {
+	uint8_t address;									/* 7-bit slave address */
+	uint8_t reg;											/* register, used with I2C_XFER_REG */
+	uint8_t flags;										/* I2C_XFER_xxx */
+	uint8_t size;											/* count of data bytes */
+	uint8_t* data;										/* data to write / buffer for read */
+	I2C_Callback callback;						/* called from I2C0 IRQ when done, may be NULL */
+	volatile uint8_t done;						/* set by driver on completion */
+	volatile uint8_t error;						/* I2C_ERR_xxx, valid when done */
+	volatile uint8_t queued;					/* private */
+	I2C_Xfer* volatile next;					/* private */
+};
 /**
  * @brief I2C initialization.
  */
 void I2C_Init(void);
+/**
+ * @brief Queue transfer. It is executed in I2C0 interrupt, completion is
+ *				signalled by done flag and callback. Can be called from IRQ.
+ *
+ * @param Transfer descriptor.
+ * @return Errors (I2C_ERR_BUSY when descriptor is still queued).
+ */
+uint8_t I2C_Submit(I2C_Xfer* xfer);
+/**
+ * @brief Check if any transfer is queued or in progress.
+ *
+ * @return 1 if busy.
+ */
+uint8_t I2C_Busy(void);
+/**
+ * @brief Abort the transfer in progress once its deadline has passed (slave
+ *				holding the bus, lost interrupt) and start the next one. Call
+ *				periodically from a task while busy.
+ *
+ * @return Microseconds to the deadline of the transfer in progress, 0 when idle.
+ */
+uint32_t I2C_Expire(void);
+/**
+ * @brief Register function called when a transfer starts on an idle bus
+ *				(from the context of I2C_Submit).
+ *
+ * @param Callback or NULL.
+ */
+void I2C_SetNotify(void (*notify)(void));
 /**
  * @brief Send via I2C only device address (write). In response check error type.
  *
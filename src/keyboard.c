@@ -8,9 +8,11 @@
  * - Keyboard initialization
  * - Column detection for key press identification
  * - GPIO configuration for rows and columns
+ * - Non-blocking debounce: row edge starts periodic matrix sampling,
+ *   per-key integrators confirm press and release
  *-------------------------------------------------------------------------*/
 
-#include "MKL05Z4.h"
+#include "hal.h"
 #include "keyboard.h"
 #include "TPM.h"
 
@@ -19,7 +21,11 @@
  *-------------------------------------------------------------------------*/
 #define NUM_ROWS 3
 #define NUM_COLS 4
+#define NUM_KEYS (NUM_ROWS * NUM_COLS)
 #define SIGNAL_STABILIZATION_DELAY 25
+#define ROW_IRQC_FALLING 0xa
+#define INTEGRATOR_MAX 4            // Samples to confirm press/release (4 * 5 ms)
+#define KEY_QUEUE_SIZE 8            // Confirmed keys waiting for main context
 
 /*-------------------------------------------------------------------------
  * Static Arrays
@@ -27,6 +33,25 @@
 static const uint8_t rows[] = {ROW2, ROW3, ROW4};
 static const uint8_t cols[] = {COL1, COL2, COL3, COL4};
 
+// Key characters by [row index][scan column], scan column 0 drives COL4
+static const char keymap[NUM_ROWS][NUM_COLS] = {
+    {'7', '8', '9', '0'},
+    {'4', '5', '6', '#'},
+    {'1', '2', '3', 'C'}
+};
+
+/*-------------------------------------------------------------------------
+ * Static Variables
+ *-------------------------------------------------------------------------*/
+static volatile uint8_t scanning = 0;   // Row interrupts masked, sampling active
+static volatile uint32_t edge_time;     // Time of the row edge
+static volatile uint32_t scan_start;    // Time of first sample after row edge
+static uint8_t integrator[NUM_KEYS];    // Per-key debounce integrators
+static uint16_t pressed = 0;            // Confirmed key states
+EVENT_QUEUE(key_queue, KEY_QUEUE_SIZE); // EV_KEY events, timestamped with the edge
+
+static void rows_irq(uint8_t enable);
+
 /*-------------------------------------------------------------------------
  * Function: Keyboard_Init
  * Purpose: Initialize the matrix keyboard interface
@@ -42,14 +67,14 @@ void Keyboard_Init(void) {
         PORTA->PCR[rows[i]] = PORT_PCR_MUX(1) |      // GPIO mode
                              PORT_PCR_PE_MASK |       // Enable pull resistor
                              PORT_PCR_PS_MASK |       // Pull-up select
-                             PORT_PCR_IRQC(0xa);      // Interrupt on falling edge
+                             PORT_PCR_IRQC(ROW_IRQC_FALLING); // Interrupt on falling edge
     }
     
     // Configure column pins
     for (int i = 0; i < NUM_COLS; i++) {
         PORTA->PCR[cols[i]] = PORT_PCR_MUX(1);       // GPIO mode
         PTA->PDDR |= (1 << cols[i]);                 // Set as output
-        PTA->PCOR |= (1 << cols[i]);                 // Set low state
+        HAL_GPIO_CLR(PTA, 1 << cols[i]);             // Set low state
     }
     
     // Configure interrupt handling
@@ -59,43 +84,136 @@ void Keyboard_Init(void) {
 }
 
 /*-------------------------------------------------------------------------
- * Function: Col_Det
- * Purpose: Detect which column was pressed in the matrix keyboard
+ * Function: rows_irq
+ * Purpose: Enable or mask falling edge interrupts on the row pins. Also
+ *          called from the scan task, so the read-modify-write of the
+ *          PCRs runs with interrupts masked.
+ * Parameters: enable - 1 to enable, 0 to mask
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+static void rows_irq(uint8_t enable) {
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+    for (int i = 0; i < NUM_ROWS; i++) {
+        PORTA->PCR[rows[i]] = (PORTA->PCR[rows[i]] & ~(PORT_PCR_IRQC_MASK | PORT_PCR_ISF_MASK)) |
+                              PORT_PCR_IRQC(enable ? ROW_IRQC_FALLING : 0);
+    }
+    HAL_W1C(PORTA->ISFR, KEYPAD_ROW_MASK);         // Drop edges seen while masked
+    __set_PRIMASK(primask);
+}
+
+/*-------------------------------------------------------------------------
+ * Function: read_matrix
+ * Purpose: Sample all keys by driving one column low at a time
  * Parameters: None
- * Returns: int - Column number (0-3) or -1 if no column detected
+ * Returns: uint16_t - bit (row * NUM_COLS + column) set for each closed key
  *-------------------------------------------------------------------------*/
-int Col_Det(void) {
-    int column = -1;
+static uint16_t read_matrix(void) {
+    uint16_t raw = 0;
     uint32_t row_state;
     uint32_t col_mask = (1 << COL1) | (1 << COL2) | (1 << COL3) | (1 << COL4);
-    
+
     // Sequential column scanning
     for (int col = 0; col < NUM_COLS; col++) {
-        // Set all columns high
-        PTA->PSOR = col_mask;
-        
-        // Set current column low
-        switch(col) {
-            case 0: PTA->PCOR = (1 << COL4); break;
-            case 1: PTA->PCOR = (1 << COL3); break;
-            case 2: PTA->PCOR = (1 << COL2); break;
-            case 3: PTA->PCOR = (1 << COL1); break;
-        }
-        			
-				TPM0_us(SIGNAL_STABILIZATION_DELAY);
-        
+        // Set all columns high, current column low
+        HAL_GPIO_SET(PTA, col_mask);
+        HAL_GPIO_CLR(PTA, 1 << cols[NUM_COLS - 1 - col]);
+
+        TPM0_us(SIGNAL_STABILIZATION_DELAY);
+
         // Check row states
         row_state = PTA->PDIR;
-        if (!(row_state & (1 << ROW2)) || 
-            !(row_state & (1 << ROW3)) || 
-            !(row_state & (1 << ROW4))) {
-            column = col;
-            break;
+        for (int row = 0; row < NUM_ROWS; row++) {
+            if (!(row_state & (1 << rows[row]))) {
+                raw |= (1 << (row * NUM_COLS + col));
+            }
         }
     }
-    
+
     // Restore all columns to low state
-    PTA->PCOR = col_mask;
-    
-    return column;
-}
\ No newline at end of file
+    HAL_GPIO_CLR(PTA, col_mask);
+
+    return raw;
+}
+
+/*-------------------------------------------------------------------------
+ * Function: Keypad_RowIrq
+ * Purpose: Handle row edge in PORTA interrupt - only masks row interrupts
+ *          and schedules sampling after the bounce window
+ * Parameters: now - current time in ms
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+void Keypad_RowIrq(uint32_t now) {
+    rows_irq(0);
+    if (!scanning) {
+        edge_time = now;
+        scan_start = now + KEYPAD_SCAN_MS;
+        scanning = 1;
+    }
+}
+
+/*-------------------------------------------------------------------------
+ * Function: Keypad_Scanning
+ * Purpose: Check if debounce sampling is active
+ * Parameters: None
+ * Returns: uint8_t - 1 while Keypad_Scan must be called periodically
+ *-------------------------------------------------------------------------*/
+uint8_t Keypad_Scanning(void) {
+    return scanning;
+}
+
+/*-------------------------------------------------------------------------
+ * Function: Keypad_Scan
+ * Purpose: One debounce sample, called every KEYPAD_SCAN_MS while scanning.
+ *          Confirmed presses are queued for Keypad_GetKey. Row interrupts
+ *          are re-enabled when all keys are released.
+ * Parameters: now - current time in ms
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+void Keypad_Scan(uint32_t now) {
+    uint16_t raw;
+    uint8_t active = 0;
+
+    if (!scanning || (int32_t)(now - scan_start) < 0) {
+        return;
+    }
+
+    raw = read_matrix();
+    for (int k = 0; k < NUM_KEYS; k++) {
+        uint16_t bit = (1 << k);
+
+        if (raw & bit) {
+            if (integrator[k] < INTEGRATOR_MAX) integrator[k]++;
+        } else if (integrator[k] > 0) {
+            integrator[k]--;
+        }
+
+        if (integrator[k] == INTEGRATOR_MAX && !(pressed & bit)) {
+            pressed |= bit;
+            Event_Put(&key_queue, EV_KEY, keymap[k / NUM_COLS][k % NUM_COLS], 0, edge_time);
+        } else if (integrator[k] == 0) {
+            pressed &= ~bit;
+        }
+        active |= integrator[k];
+    }
+
+    if (!active) {
+        scanning = 0;
+        rows_irq(1);
+        // Key closed between the last sample and re-arming gives no edge
+        if ((PTA->PDIR & KEYPAD_ROW_MASK) != KEYPAD_ROW_MASK) {
+            Keypad_RowIrq(now);
+        }
+    }
+}
+
+/*-------------------------------------------------------------------------
+ * Function: Keypad_GetKey
+ * Purpose: Get next confirmed key press
+ * Parameters: ev - EV_KEY event, arg holds the key character
+ * Returns: uint8_t - 1 if a key was returned, 0 if none
+ *-------------------------------------------------------------------------*/
+uint8_t Keypad_GetKey(Event* ev) {
+    return Event_Get(&key_queue, ev);
+}
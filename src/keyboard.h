@@ -1,4 +1,5 @@
-#include "MKL05Z4.h"
+#include "hal.h"
+#include "events.h"
 
 #define ROW2 12 
 #define ROW3 7  
@@ -9,5 +10,11 @@
 #define COL3 5 
 #define COL4 6 
 
-int Col_Det(void);
+#define KEYPAD_SCAN_MS 5            // Debounce sampling period
+#define KEYPAD_ROW_MASK ((1 << ROW2) | (1 << ROW3) | (1 << ROW4))
+
 void Keyboard_Init(void);
+void Keypad_RowIrq(uint32_t now);
+uint8_t Keypad_Scanning(void);
+void Keypad_Scan(uint32_t now);
+uint8_t Keypad_GetKey(Event* ev);
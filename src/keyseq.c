@@ -0,0 +1,124 @@
+/*-------------------------------------------------------------------------
+ * Technika Mikroprocesorowa 2 - Project
+ * Project: Security Alarm System
+ * File: keyseq.c
+ *
+ * This file implements the keypad sequence matcher:
+ * - Keys are fed one at a time into a DFA, one table lookup per key
+ * - Recognised sequences: <code># and #<code>#, code of
+ *   KEYSEQ_MIN_DIGITS..KEYSEQ_MAX_DIGITS digits
+ * - A key that cannot continue any sequence rejects it at once; the
+ *   code value itself is only checked when the sequence is complete,
+ *   by the constant-time Codes_Lookup
+ * - The transition table is built by the compiler from the digit
+ *   limits and lives in flash
+ *-------------------------------------------------------------------------*/
+
+#include "keyseq.h"
+
+/*-------------------------------------------------------------------------
+ * Constants
+ *-------------------------------------------------------------------------*/
+// Key classes (table columns)
+#define KEY_DIGIT           0
+#define KEY_HASH            1
+#define KEY_CLEAR           2
+#define KEY_OTHER           3
+#define KEY_CLASSES         4
+
+// States: idle, n digits of <code>#, '#', n digits of #<code>#
+#define S_IDLE              0
+#define S_CODE(n)           (n)
+#define S_CMD               (KEYSEQ_MAX_DIGITS + 1)
+#define S_CMD_CODE(n)       (S_CMD + (n))
+#define S_COUNT             (S_CMD_CODE(KEYSEQ_MAX_DIGITS) + 1)
+
+// Actions, taken with the transition
+#define A_NONE              0
+#define A_DIGIT             1           // Store the digit
+#define A_CODE              2
+#define A_ARM               3
+#define A_REJECT            4
+#define A_CLEAR             5
+
+// Table entry: action in the high nibble, next state in the low one
+#define T(next, action)     ((uint8_t)(((action) << 4) | (next)))
+#define T_NEXT(t)           ((t) & 0x0F)
+#define T_ACTION(t)         ((t) >> 4)
+
+// Row for n digits entered after the sequence start 'base'
+#define DIGITS_ROW(base, n, accept) {                                       \
+    ((n) < KEYSEQ_MAX_DIGITS) ? T((base) + (n) + 1, A_DIGIT) : T(S_IDLE, A_REJECT), \
+    ((n) >= KEYSEQ_MIN_DIGITS) ? T(S_IDLE, (accept)) : T(S_IDLE, A_REJECT), \
+    T(S_IDLE, A_CLEAR),                                                     \
+    T(S_IDLE, A_REJECT) }
+
+#if S_COUNT > 16
+#error "keyseq: states do not fit a table nibble"
+#endif
+#if KEYSEQ_MIN_DIGITS < 1 || KEYSEQ_MIN_DIGITS > KEYSEQ_MAX_DIGITS || KEYSEQ_MAX_DIGITS != 6
+#error "keyseq: table rows below are written for 6 digits"
+#endif
+
+/*-------------------------------------------------------------------------
+ * Transition Table
+ *-------------------------------------------------------------------------*/
+static const uint8_t keyseq_table[S_COUNT][KEY_CLASSES] = {
+    // S_IDLE: a digit starts <code>#, '#' starts #<code>#
+    { T(S_CODE(1), A_DIGIT), T(S_CMD, A_NONE), T(S_IDLE, A_CLEAR), T(S_IDLE, A_REJECT) },
+    DIGITS_ROW(S_CODE(0), 1, A_CODE),
+    DIGITS_ROW(S_CODE(0), 2, A_CODE),
+    DIGITS_ROW(S_CODE(0), 3, A_CODE),
+    DIGITS_ROW(S_CODE(0), 4, A_CODE),
+    DIGITS_ROW(S_CODE(0), 5, A_CODE),
+    DIGITS_ROW(S_CODE(0), 6, A_CODE),
+    DIGITS_ROW(S_CMD, 0, A_ARM),
+    DIGITS_ROW(S_CMD, 1, A_ARM),
+    DIGITS_ROW(S_CMD, 2, A_ARM),
+    DIGITS_ROW(S_CMD, 3, A_ARM),
+    DIGITS_ROW(S_CMD, 4, A_ARM),
+    DIGITS_ROW(S_CMD, 5, A_ARM),
+    DIGITS_ROW(S_CMD, 6, A_ARM),
+};
+
+/*-------------------------------------------------------------------------
+ * Function: KeySeq_Reset
+ * Purpose: Drop the sequence in progress
+ * Parameters: seq - matcher
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+void KeySeq_Reset(KeySeq* seq) {
+    seq->state = S_IDLE;
+    seq->len = 0;
+}
+
+/*-------------------------------------------------------------------------
+ * Function: KeySeq_Feed
+ * Purpose: Advance the matcher by one key
+ * Parameters:
+ * seq - matcher
+ * key - key character
+ * Returns: uint8_t - KEYSEQ_xxx; after CODE / ARM the code is in
+ *          seq->digits and seq->len
+ *-------------------------------------------------------------------------*/
+uint8_t KeySeq_Feed(KeySeq* seq, char key) {
+    static const uint8_t results[] = {
+        KEYSEQ_NONE, KEYSEQ_NONE, KEYSEQ_CODE, KEYSEQ_ARM, KEYSEQ_REJECT, KEYSEQ_CLEAR
+    };
+    uint8_t cls = (key >= '0' && key <= '9') ? KEY_DIGIT :
+                  (key == '#') ? KEY_HASH :
+                  (key == 'C') ? KEY_CLEAR : KEY_OTHER;
+    uint8_t t = keyseq_table[seq->state][cls];
+    uint8_t action = T_ACTION(t);
+
+    // A new sequence starts from idle; the previous code stays readable
+    // until then
+    if (seq->state == S_IDLE) {
+        seq->len = 0;
+    }
+    if (action == A_DIGIT) {
+        seq->digits[seq->len++] = key;
+    }
+    seq->state = T_NEXT(t);
+    return results[action];
+}
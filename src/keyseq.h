@@ -0,0 +1,26 @@
+#ifndef KEYSEQ_H
+#define KEYSEQ_H
+
+#include "hal.h"
+#include "codes.h"
+
+#define KEYSEQ_MIN_DIGITS   4
+#define KEYSEQ_MAX_DIGITS   CODE_MAX_DIGITS
+
+// KeySeq_Feed results
+#define KEYSEQ_NONE         0           // Key accepted, sequence not complete
+#define KEYSEQ_CODE         1           // <code>#
+#define KEYSEQ_ARM          2           // #<code>#
+#define KEYSEQ_REJECT       3           // Sequence cannot be completed, dropped
+#define KEYSEQ_CLEAR        4           // 'C', sequence dropped
+
+typedef struct {
+    uint8_t state;
+    uint8_t len;                        // Digits valid after CODE / ARM
+    char digits[KEYSEQ_MAX_DIGITS];
+} KeySeq;
+
+void KeySeq_Reset(KeySeq* seq);
+uint8_t KeySeq_Feed(KeySeq* seq, char key);
+
+#endif /* KEYSEQ_H */
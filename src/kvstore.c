@@ -0,0 +1,318 @@
+/*-------------------------------------------------------------------------
+ * Technika Mikroprocesorowa 2 - Project
+ * Project: Security Alarm System
+ * File: kvstore.c
+ *
+ * This file implements a small key/value store in flash:
+ * - Two sectors used in turn; new values are appended as 8-byte
+ *   CRC-checked records, a sector is erased only when the other one
+ *   is full and its live values are copied over (wear levelling)
+ * - Each sector starts with a header holding a generation number; the
+ *   header is written last, so an interrupted copy leaves the old sector
+ *   in charge
+ * - Boot: active sector from the headers, append point by binary search,
+ *   values loaded into a RAM cache that serves all reads
+ *-------------------------------------------------------------------------*/
+
+#include "kvstore.h"
+#include "flash.h"
+#include <string.h>
+
+/*-------------------------------------------------------------------------
+ * Constants
+ *-------------------------------------------------------------------------*/
+#define KV_RECORD_SIZE      8
+#define KV_PER_SECTOR       (FLASH_SECTOR_SIZE / KV_RECORD_SIZE)
+#define KV_MAGIC            0x4B56      // "KV"
+#define KV_NO_SECTOR        0xFF
+#define KV_KEY_NONE         0xFF        // Erased or torn record
+
+/*-------------------------------------------------------------------------
+ * Types
+ *-------------------------------------------------------------------------*/
+typedef struct {
+    uint8_t key;                        // KV_KEY_NONE if the entry is free
+    uint8_t len;
+    uint8_t data[KV_VALUE_SIZE];
+} kv_entry_t;
+
+/*-------------------------------------------------------------------------
+ * Static Variables
+ *-------------------------------------------------------------------------*/
+static kv_entry_t cache[KV_MAX_KEYS];
+static uint8_t active = KV_NO_SECTOR;   // Sector in use
+static uint16_t generation;             // Its generation
+static uint16_t head;                   // Next free record slot
+
+/*-------------------------------------------------------------------------
+ * Function: crc16
+ * Purpose: CRC-16/CCITT (poly 0x1021, init 0xFFFF), bitwise - a record
+ *          is only 6 bytes
+ * Parameters:
+ * data - bytes
+ * len - byte count
+ * Returns: uint16_t - CRC
+ *-------------------------------------------------------------------------*/
+static uint16_t crc16(const uint8_t* data, uint8_t len) {
+    uint16_t crc = 0xFFFF;
+
+    while (len--) {
+        crc ^= (uint16_t)(*data++) << 8;
+        for (uint8_t i = 0; i < 8; i++) {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+/*-------------------------------------------------------------------------
+ * Function: record_addr
+ * Purpose: Flash address of a record slot, slot 0 is the sector header
+ * Parameters:
+ * s - sector index in the store
+ * n - slot index
+ * Returns: uint32_t - address
+ *-------------------------------------------------------------------------*/
+static uint32_t record_addr(uint8_t s, uint16_t n) {
+    return FLASH_KV_START + (uint32_t)s * FLASH_SECTOR_SIZE + (uint32_t)n * KV_RECORD_SIZE;
+}
+
+/*-------------------------------------------------------------------------
+ * Function: record_crc
+ * Purpose: CRC over key, length and data of a record
+ * Parameters:
+ * key, len - record header fields
+ * data - value longword
+ * Returns: uint16_t - CRC
+ *-------------------------------------------------------------------------*/
+static uint16_t record_crc(uint8_t key, uint8_t len, uint32_t data) {
+    uint8_t buf[2 + KV_VALUE_SIZE] = {
+        key, len, (uint8_t)data, (uint8_t)(data >> 8), (uint8_t)(data >> 16), (uint8_t)(data >> 24)
+    };
+
+    return crc16(buf, sizeof(buf));
+}
+
+/*-------------------------------------------------------------------------
+ * Function: record_read
+ * Purpose: Read and check one record
+ * Parameters:
+ * s - sector index
+ * n - slot index
+ * e - decoded record
+ * Returns: uint8_t - 1 if the record is complete and its CRC matches
+ *-------------------------------------------------------------------------*/
+static uint8_t record_read(uint8_t s, uint16_t n, kv_entry_t* e) {
+    uint32_t hdr = Flash_ReadWord(record_addr(s, n));
+    uint32_t data = Flash_ReadWord(record_addr(s, n) + 4);
+
+    e->key = (uint8_t)hdr;
+    e->len = (uint8_t)(hdr >> 8);
+    if (e->key == KV_KEY_NONE || e->key == 0 || e->len > KV_VALUE_SIZE ||
+        (uint16_t)(hdr >> 16) != record_crc(e->key, e->len, data)) {
+        return 0;
+    }
+    memcpy(e->data, &data, KV_VALUE_SIZE);  // Little endian, byte 0 first
+    return 1;
+}
+
+/*-------------------------------------------------------------------------
+ * Function: record_write
+ * Purpose: Program one record. Data goes first, the header with the CRC
+ *          last, so a torn record never passes the check.
+ * Parameters:
+ * s - sector index
+ * n - slot index
+ * e - record
+ * Returns: uint8_t - 0 on success, FLASH_ERR_xxx bits otherwise
+ *-------------------------------------------------------------------------*/
+static uint8_t record_write(uint8_t s, uint16_t n, const kv_entry_t* e) {
+    uint32_t data;
+    uint8_t err;
+
+    memcpy(&data, e->data, KV_VALUE_SIZE);
+    err = Flash_ProgramWord(record_addr(s, n) + 4, data);
+    if (err == 0) {
+        err = Flash_ProgramWord(record_addr(s, n), e->key | ((uint32_t)e->len << 8) |
+                                ((uint32_t)record_crc(e->key, e->len, data) << 16));
+    }
+    return err;
+}
+
+/*-------------------------------------------------------------------------
+ * Function: sector_generation
+ * Purpose: Check a sector header
+ * Parameters:
+ * s - sector index
+ * gen - generation of a valid sector
+ * Returns: uint8_t - 1 if the header is valid
+ *-------------------------------------------------------------------------*/
+static uint8_t sector_generation(uint8_t s, uint16_t* gen) {
+    uint32_t hdr = Flash_ReadWord(record_addr(s, 0));
+
+    if ((uint16_t)hdr != KV_MAGIC || Flash_ReadWord(record_addr(s, 0) + 4) != ~hdr) {
+        return 0;
+    }
+    *gen = (uint16_t)(hdr >> 16);
+    return 1;
+}
+
+/*-------------------------------------------------------------------------
+ * Function: cache_find
+ * Purpose: Find the cache entry of a key
+ * Parameters:
+ * key - key
+ * create - 1 to return a free entry if the key is not cached
+ * Returns: kv_entry_t* - entry, 0 if not found (or cache full)
+ *-------------------------------------------------------------------------*/
+static kv_entry_t* cache_find(uint8_t key, uint8_t create) {
+    kv_entry_t* free_entry = 0;
+
+    for (uint8_t i = 0; i < KV_MAX_KEYS; i++) {
+        if (cache[i].key == key) {
+            return &cache[i];
+        }
+        if (cache[i].key == KV_KEY_NONE && free_entry == 0) {
+            free_entry = &cache[i];
+        }
+    }
+    return create ? free_entry : 0;
+}
+
+/*-------------------------------------------------------------------------
+ * Function: compact
+ * Purpose: Move all cached values to the other sector. Its erase blocks
+ *          interrupts (~14 ms), done once per KV_PER_SECTOR - 1 writes.
+ * Parameters: None
+ * Returns: uint8_t - 0 on success, FLASH_ERR_xxx bits otherwise
+ *-------------------------------------------------------------------------*/
+static uint8_t compact(void) {
+    uint8_t target = (active == KV_NO_SECTOR) ? 0 : (uint8_t)((active + 1) % FLASH_KV_SECTORS);
+    uint16_t gen = (active == KV_NO_SECTOR) ? 0 : (uint16_t)(generation + 1);
+    uint32_t hdr = KV_MAGIC | ((uint32_t)gen << 16);
+    uint16_t n = 1;
+    uint8_t err;
+
+    if (!Flash_IsErased(record_addr(target, 0), FLASH_SECTOR_SIZE)) {
+        if ((err = Flash_EraseSector(record_addr(target, 0))) != 0) {
+            return err;
+        }
+    }
+    for (uint8_t i = 0; i < KV_MAX_KEYS; i++) {
+        if (cache[i].key != KV_KEY_NONE) {
+            if ((err = record_write(target, n++, &cache[i])) != 0) {
+                return err;
+            }
+        }
+    }
+    // Header last - until here the old sector is still the valid one
+    if ((err = Flash_ProgramWord(record_addr(target, 0) + 4, ~hdr)) != 0 ||
+        (err = Flash_ProgramWord(record_addr(target, 0), hdr)) != 0) {
+        return err;
+    }
+    active = target;
+    generation = gen;
+    head = n;
+    return 0;
+}
+
+/*-------------------------------------------------------------------------
+ * Function: Kv_Init
+ * Purpose: Find the active sector and load its values into the cache
+ * Parameters: None
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+void Kv_Init(void) {
+    uint16_t lo = 1, hi = KV_PER_SECTOR;
+
+    memset(cache, KV_KEY_NONE, sizeof(cache));
+    active = KV_NO_SECTOR;
+    for (uint8_t s = 0; s < FLASH_KV_SECTORS; s++) {
+        uint16_t gen;
+
+        // Newer generation wins, compared modulo 2^16
+        if (sector_generation(s, &gen) &&
+            (active == KV_NO_SECTOR || (int16_t)(gen - generation) > 0)) {
+            active = s;
+            generation = gen;
+        }
+    }
+    if (active == KV_NO_SECTOR) {
+        return;                         // Formatted by the first Kv_Set
+    }
+
+    // Slots are filled in order - first erased one by binary search
+    while (lo < hi) {
+        uint16_t mid = (lo + hi) / 2;
+
+        if (Flash_IsErased(record_addr(active, mid), KV_RECORD_SIZE)) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    head = lo;
+
+    // Oldest to newest, a later record of a key replaces the earlier one
+    for (uint16_t n = 1; n < head; n++) {
+        kv_entry_t e;
+        kv_entry_t* c;
+
+        if (record_read(active, n, &e) && (c = cache_find(e.key, 1)) != 0) {
+            *c = e;
+        }
+    }
+}
+
+/*-------------------------------------------------------------------------
+ * Function: Kv_Get
+ * Purpose: Read a value from the RAM cache (no flash access)
+ * Parameters:
+ * key - key
+ * buf - destination
+ * size - size of buf
+ * Returns: uint8_t - value length, 0 if the key is not stored
+ *-------------------------------------------------------------------------*/
+uint8_t Kv_Get(uint8_t key, void* buf, uint8_t size) {
+    const kv_entry_t* e = cache_find(key, 0);
+
+    if (e == 0 || e->len > size) {
+        return 0;
+    }
+    memcpy(buf, e->data, e->len);
+    return e->len;
+}
+
+/*-------------------------------------------------------------------------
+ * Function: Kv_Set
+ * Purpose: Store a value. Unchanged values are not written again.
+ * Parameters:
+ * key - key (1..254)
+ * data - value
+ * len - length, up to KV_VALUE_SIZE
+ * Returns: uint8_t - 0 on success, FLASH_ERR_xxx bits otherwise
+ *-------------------------------------------------------------------------*/
+uint8_t Kv_Set(uint8_t key, const void* data, uint8_t len) {
+    kv_entry_t* e;
+    uint8_t err;
+
+    if (key == 0 || key == KV_KEY_NONE || len > KV_VALUE_SIZE ||
+        (e = cache_find(key, 1)) == 0) {
+        return FLASH_ERR_ACCESS;
+    }
+    if (e->key == key && e->len == len && memcmp(e->data, data, len) == 0) {
+        return 0;
+    }
+    e->key = key;
+    e->len = len;
+    memset(e->data, 0xFF, KV_VALUE_SIZE);
+    memcpy(e->data, data, len);
+
+    // Full (or unformatted) - the copy to the other sector includes the new value
+    if (active == KV_NO_SECTOR || head == KV_PER_SECTOR) {
+        return compact();
+    }
+    err = record_write(active, head, e);
+    head++;                             // Slot consumed even if programming failed
+    return err;
+}
@@ -0,0 +1,16 @@
+#ifndef KVSTORE_H
+#define KVSTORE_H
+
+#include "hal.h"
+
+#define KV_VALUE_SIZE       4           // Bytes per value (one longword)
+#define KV_MAX_KEYS         40          // Distinct keys kept in the RAM cache, 6 bytes each
+
+// Keys (1..254)
+#define KV_KEY_CODE(slot)   (0x10 + (slot))     // Code table slots (codes.c)
+
+void Kv_Init(void);
+uint8_t Kv_Get(uint8_t key, void* buf, uint8_t size);
+uint8_t Kv_Set(uint8_t key, const void* data, uint8_t len);
+
+#endif /* KVSTORE_H */
@@ -1,4 +1,4 @@
-#include "MKL05Z4.h"
+#include "hal.h"
 #define RED_MASK		(1<<8)		
 #define GREEN_MASK	(1<<9)	
 #define BLUE_MASK		(1<<10)		
@@ -11,7 +11,7 @@
  * - Alarm triggering and control
  *-------------------------------------------------------------------------*/
 
-#include "MKL05Z4.h"
+#include "hal.h"
 #include "TPM.h"
 #include "leds.h"
 #include "i2c.h"
@@ -20,266 +20,423 @@
 #include "DAC.h"
 #include "keyboard.h"
 #include "alarm.h"
-#include <math.h>
-#include <string.h>
+#include "sched.h"
+#include "events.h"
+#include "filter.h"
+#include "profile.h"
+#include "eventlog.h"
+#include "kvstore.h"
+#include "codes.h"
+#include "keyseq.h"
+#include "power.h"
+#include "timer.h"
+#include "alarmfsm.h"
+#include "vibration.h"
+#include "motion.h"
 #include "frdm_bsp.h"
 
 /*-------------------------------------------------------------------------
  * Constants
  *-------------------------------------------------------------------------*/
 #define INT2_PIN_MASK    (1 << 10)
-#define ZYXDR_MASK       (1 << 3)
-#define MAX_PASSWORD     4
-#define MOTION_THRESHOLD 1.3f
-#define DISTANCE_THRESHOLD 10.0f
-#define BUTTON_DEBOUNCE_DELAY 70000
-#define KEYBOARD_DEBOUNCE_DELAY 50000
+#define USER_CODE_SLOT   0      // Code table slot changed in admin mode
+#define DISTANCE_THRESHOLD_MM 100
+
+// Filter stages: median rejects single outliers, k-of-n confirms
+#define MOTION_MEDIAN     5     // Samples (800 Hz)
+#define MOTION_CONFIRM_K  4     // Medians above threshold ...
+#define MOTION_CONFIRM_N  8     // ... out of the last N
+#define TAMPER_CONFIRM_K  2     // Vibration windows (80 ms) with a tamper signature ...
+#define TAMPER_CONFIRM_N  3     // ... out of the last N
+#define ECHO_MEDIAN       3     // Echoes (16 Hz)
+#define ECHO_CONFIRM_K    2
+#define ECHO_CONFIRM_N    3
+#define ECHO_FAR_MM       0xFFFF  // Median input for echoes beyond the threshold
+
+#define RANGING_PERIOD_MS 60    // RCW-0001 ping period (>= echo window)
+#define ENTRY_TIMEOUT_MS  10000 // Unfinished key sequence dropped after this pause
 
 /*-------------------------------------------------------------------------
  * Password Management Variables
  *-------------------------------------------------------------------------*/
-volatile char button = 0;
-char password[MAX_PASSWORD] = {'1', '2', '3', '4'};
-char admin_password[MAX_PASSWORD] = {'4', '3', '2', '1'};
-volatile uint8_t pass_counter = 0;
-char input_password[MAX_PASSWORD];
-volatile char button_buff = 0;
-volatile uint8_t button_handled = 0;
-volatile uint8_t type_count = 0;
-volatile uint8_t admin_mode = 0;
-uint8_t admin_new_password[MAX_PASSWORD];
-volatile uint8_t admin_counter = 0;
-volatile int button_pressed = 0;
+static KeySeq keyseq;              // Key sequence matcher
+static uint16_t entry_timer;       // Restarted by every key of a sequence
 
 /*-------------------------------------------------------------------------
  * Distance Sensor Variables
  *-------------------------------------------------------------------------*/
-volatile uint32_t d = 0;
-volatile float result = 0;
-volatile float tick = 0, tick_head = 0;
-volatile float distance = 0;
-volatile uint8_t measure_ready = 0;
-volatile uint32_t ps_value[] = {1, 2, 4, 8, 16, 32, 64, 128};
+#if !RCW_DUAL_EDGE
+volatile uint32_t d = 0;                // TPM1 prescaler (EXTRG_IN mode)
+#endif
+volatile uint16_t distance_mm = 0;      // Last distance, for reporting
 
 /*-------------------------------------------------------------------------
  * Accelerometer Variables
  *-------------------------------------------------------------------------*/
-static uint8_t arrayXYZ[6];
-double X, Y, Z;
-volatile int motion_detected = 0;
-static uint8_t status;
+static AccelSample sample;
 
 /*-------------------------------------------------------------------------
  * Alarm Control Variables
  *-------------------------------------------------------------------------*/
-volatile uint8_t alarm = 0;
-volatile uint8_t alarm_armed = 1;  // 1 = armed, 0 = disarmed
+static uint8_t siren_on = 0;       // Siren output state
+static uint8_t ranging_on = 0;     // Ping generator state
 
 /*-------------------------------------------------------------------------
- * Keypad Matrix Configuration
+ * Scheduler Task Ids
  *-------------------------------------------------------------------------*/
-char ButtonMatrix[3][4] = {
-    {'1', '2', '3', 'C'},
-    {'4', '5', '6', '#'},
-    {'7', '8', '9', '0'}
-};
+static uint8_t keypad_task, accel_task, echo_task;
+static uint8_t timer_task, status_task, i2c_task, log_task;
 
 /*-------------------------------------------------------------------------
- * Password Management Functions
+ * Event Queues (one producer interrupt, one consumer task each)
  *-------------------------------------------------------------------------*/
-uint8_t check_password(const char *expected_password) {
-    for (uint8_t i = 0; i < MAX_PASSWORD; i++) {
-        if (input_password[i] != expected_password[i]) {
-            return 0;  // Password incorrect
-        }
-    }
-    return 1;  // Password correct
-}
+EVENT_QUEUE(echo_queue, 8);        // TPM1_IRQHandler -> Echo_Task
+EVENT_QUEUE(motion_queue, 4);      // I2C0 IRQ (batch read) -> Accel_Task
 
+/*-------------------------------------------------------------------------
+ * Sensor Filters
+ *-------------------------------------------------------------------------*/
+MEDIAN_FILTER(motion_median, MOTION_MEDIAN);
+KOFN_FILTER(motion_confirm, MOTION_CONFIRM_K, MOTION_CONFIRM_N);
+KOFN_FILTER(tamper_confirm, TAMPER_CONFIRM_K, TAMPER_CONFIRM_N);
+MEDIAN_FILTER(echo_median, ECHO_MEDIAN);
+KOFN_FILTER(echo_confirm, ECHO_CONFIRM_K, ECHO_CONFIRM_N);
+
+/*-------------------------------------------------------------------------
+ * Password Management Functions
+ *-------------------------------------------------------------------------*/
 void handle_password_input(char button) {
-    if (admin_mode) {
-        // Administrator mode - password modification
-        if (admin_counter < MAX_PASSWORD) {
-            admin_new_password[admin_counter++] = button;
-        }
+    uint8_t result = KeySeq_Feed(&keyseq, button);
+    uint8_t role;
 
-        if (admin_counter == MAX_PASSWORD) {
-            // Save new password
-            memcpy(password, admin_new_password, MAX_PASSWORD);
-            admin_mode = 0;
-            PTB->PDOR |= (1 << 9); 
-            admin_counter = 0;
-        }
+    if (result == KEYSEQ_NONE) {
+        Timer_Start(entry_timer, ENTRY_TIMEOUT_MS);
     } else {
-        // Standard mode - password verification
-        if (pass_counter < MAX_PASSWORD) {
-            input_password[pass_counter++] = button;
+        Timer_Stop(entry_timer);
+    }
+    if (result != KEYSEQ_CODE && result != KEYSEQ_ARM) {
+        return;
+    }
+
+    if (AlarmFsm_State() == FSM_ADMIN) {
+        // Administrator mode - <new code># replaces the user code; a code
+        // already in use (e.g. the admin code) is refused and admin mode
+        // waits for another one
+        if (result == KEYSEQ_CODE &&
+            Codes_Set(USER_CODE_SLOT, keyseq.digits, keyseq.len, CODE_ROLE_USER) == 0) {
+            AlarmFsm_Event(FSM_EV_NEW_CODE);
         }
+        return;
+    }
 
-        if (pass_counter == MAX_PASSWORD) {
-            if (check_password(password)) {
-                alarm_armed = !alarm_armed;
-                alarm = 0;
-            } else if (check_password(admin_password)) {
-                // Enter administrator mode
-                PTB->PDOR &= ~(1 << 9);
-                admin_mode = 1;
-                alarm_armed = 0;
-                alarm = 0;
-                admin_counter = 0;
-            }
+    // Constant-time lookup over the whole code table
+    role = Codes_Lookup(keyseq.digits, keyseq.len);
 
-            // Reset after password check
-            pass_counter = 0;
-            memset(input_password, 0, MAX_PASSWORD);
-        }
+    if (role == CODE_ROLE_USER || role == CODE_ROLE_DURESS) {
+        // <code># toggles, #<code># only arms
+        AlarmFsm_Event((result == KEYSEQ_ARM) ? FSM_EV_ARM :
+                       (role == CODE_ROLE_DURESS) ? FSM_EV_DURESS : FSM_EV_CODE);
+    } else if ((role == CODE_ROLE_ADMIN || role == CODE_ROLE_INSTALLER) && result == KEYSEQ_CODE) {
+        // Enter administrator mode
+        AlarmFsm_Event(FSM_EV_ADMIN);
     }
 }
 
+// A started sequence was not finished in time
+static void entry_timeout(uint16_t id) {
+    (void)id;
+    KeySeq_Reset(&keyseq);
+}
+
 /*-------------------------------------------------------------------------
- * Interrupt Handlers
+ * Alarm Trigger - logs which sensor started the entry delay and its reading
  *-------------------------------------------------------------------------*/
-void Row_Int(int row_number) {
-    uint8_t column_number = Col_Det();
-    TPM0_us(KEYBOARD_DEBOUNCE_DELAY);
-    button = ButtonMatrix[row_number][column_number];
-    button_pressed = 1;
+static void trigger_alarm(uint8_t source, uint32_t value) {
+    if (AlarmFsm_State() == FSM_ARMED) {
+        Log_Put(source, 1, (value > 0xFFFF) ? 0xFFFF : (uint16_t)value, Sched_Millis());
+    }
+    AlarmFsm_Event(FSM_EV_TRIGGER);
 }
 
+// Arming state changed: outputs follow the new state
+static void Fsm_Notify(void) {
+    // Exit delay over, the owner has left: the resting reading is measured
+    // again, the unit may have been moved while disarmed
+    if (AlarmFsm_State() == FSM_ARMED) {
+        Motion_Calibrate();
+        Median_Init(&motion_median, 0);
+        KofN_Reset(&motion_confirm);
+    }
+    Sched_Signal(status_task);
+}
+
+/*-------------------------------------------------------------------------
+ * Interrupt Handlers
+ *-------------------------------------------------------------------------*/
 void PORTA_IRQHandler(void) {
+    PROF_ENTER(PROF_PORTA);
     uint32_t interrupt_flags = PORTA->ISFR;
 
-    // Handle accelerometer interrupt
+    // Handle accelerometer interrupt - start background read of the batch
     if (interrupt_flags & INT2_PIN_MASK) {
-        motion_detected = 1;
-        PORTA->ISFR |= INT2_PIN_MASK;
+        Accel_Drain();
     }
 
-    // Handle keypad row interrupts
-    if (PORTA->ISFR & (1 << ROW2)) {
-        TPM0_us(BUTTON_DEBOUNCE_DELAY);
-        if (!(PTA->PDIR & (1 << ROW2))) {
-            Row_Int(2);
-        }
-        PORTA->ISFR |= (1 << ROW2);
-    }
-    if (PORTA->ISFR & (1 << ROW3)) {
-        TPM0_us(BUTTON_DEBOUNCE_DELAY);
-        if (!(PTA->PDIR & (1 << ROW3))) {
-            Row_Int(1);
-        }
-        PORTA->ISFR |= (1 << ROW3);
-    }
-    if (PORTA->ISFR & (1 << ROW4)) {
-        TPM0_us(BUTTON_DEBOUNCE_DELAY);
-        if (!(PTA->PDIR & (1 << ROW4))) {
-            Row_Int(0);
-        }
-        PORTA->ISFR |= (1 << ROW4);
+    // Handle keypad row interrupts - only records the edge, debouncing
+    // and key decoding run later in the keypad task
+    if (interrupt_flags & KEYPAD_ROW_MASK) {
+        Keypad_RowIrq(Sched_Millis());
+        Sched_Signal(keypad_task);
     }
 
-    // Clear all interrupt flags
-		PORTA->ISFR |= (INT2_PIN_MASK | (1 << ROW2) | (1 << ROW3) | (1 << ROW4));
+    // Clear handled interrupt flags
+    HAL_W1C(PORTA->ISFR, interrupt_flags & (INT2_PIN_MASK | KEYPAD_ROW_MASK));
+    PROF_EXIT(PROF_PORTA);
 }
 
+#if RCW_DUAL_EDGE
 void TPM1_IRQHandler(void) {
+    PROF_ENTER(PROF_TPM1);
+    uint16_t ticks;
+    uint8_t ps;
+
+    // Both edges captured on TPM1 CH1, prescaler adapted by RCW-0001.c
+    if (RCW_CaptureIrq(&ticks, &ps) && RCW_EchoAccept()) {
+        uint8_t arg = ps | (RCW_InRange(ticks, ps) ? EV_ECHO_CLOSE : 0);
+
+        Event_Put(&echo_queue, EV_ECHO, arg, ticks, Sched_Millis());
+        Sched_Signal(echo_task);
+    }
+    PROF_EXIT(PROF_TPM1);
+}
+#else
+void TPM1_IRQHandler(void) {
+    PROF_ENTER(PROF_TPM1);
+    uint8_t ps = d;
     TPM1->SC = 0;  // Stop TPM1
 
     if (TPM1->STATUS & TPM_STATUS_TOF_MASK) {
         TPM1->SC = 0;
-        result = 100000;
         d = (d + 1) % 8;
     }
 
-    if (TPM1->STATUS & TPM_STATUS_CH1F_MASK) {
-        result = TPM1->CONTROLS[1].CnV;
-        measure_ready = 1;
+    // Only the first echo of the ping in flight is reported
+    if ((TPM1->STATUS & TPM_STATUS_CH1F_MASK) && RCW_EchoAccept()) {
+        // Threshold check is a single compare against the precomputed
+        // tick limit for the prescaler the echo was measured with
+        uint16_t ticks = TPM1->CONTROLS[1].CnV;
+        uint8_t arg = ps | (RCW_InRange(ticks, ps) ? EV_ECHO_CLOSE : 0);
+
+        Event_Put(&echo_queue, EV_ECHO, arg, ticks, Sched_Millis());
+        Sched_Signal(echo_task);
     }
 
     // Clear interrupt flags
-    TPM1->STATUS |= (TPM_STATUS_CH1F_MASK | TPM_STATUS_TOF_MASK);
+    HAL_W1C_OR(TPM1->STATUS, TPM_STATUS_CH1F_MASK | TPM_STATUS_TOF_MASK);
 
     // Restore TPM1 configuration
     TPM1->SC = d | TPM_SC_TOIE_MASK | TPM_SC_CMOD(1);
+    PROF_EXIT(PROF_TPM1);
+}
+#endif
+
+/*-------------------------------------------------------------------------
+ * Scheduler Tasks
+ *-------------------------------------------------------------------------*/
+// Keypad: started by a row edge, then samples the matrix every
+// KEYPAD_SCAN_MS until all keys are released
+static void Keypad_Task(void) {
+    Event ev;
+
+    Keypad_Scan(Sched_Millis());
+    while (Keypad_GetKey(&ev)) {
+        char key = (char)ev.arg;
+
+        handle_password_input(key);
+    }
+    Sched_SetPeriod(keypad_task, Keypad_Scanning() ? KEYPAD_SCAN_MS : SCHED_EVENT_ONLY);
+}
+
+// Accelerometer: runs when a batch has been read in background
+static void Accel_Task(void) {
+    AccelBatch* batch;
+    Event ev;
+
+    while (Event_Get(&motion_queue, &ev)) {
+        if ((batch = Accel_GetBatch()) == 0) {
+            continue;
+        }
+        for (uint8_t i = 0; i < batch->count; i++) {
+            int32_t peak;
+            uint8_t vib;
+
+            // Dynamic acceleration squared against a threshold squared
+            // at compile time - no floating point or sqrt on the M0+
+            Accel_Decode(&batch->raw[1 + 6 * i], &sample);
+            peak = Median_Push(&motion_median, (int32_t)Motion_Push(sample.x, sample.y, sample.z));
+
+            // Check for motion threshold, confirmed over several samples
+            if (KofN_Push(&motion_confirm, (uint32_t)peak > MOTION_THRESHOLD_SQ)) {
+                trigger_alarm(LOG_SRC_MOTION, (uint32_t)peak >> 16);
+            }
+
+            // Vibration spectrum: tool contact far below the motion
+            // threshold, ambient rumble ignored
+            vib = Vib_Push(sample.x, sample.y, sample.z);
+            if (vib != VIB_NONE && KofN_Push(&tamper_confirm, vib & VIB_TAMPER)) {
+                trigger_alarm(LOG_SRC_TAMPER, Vib_Last()->high >> 8);
+            }
+        }
+        Accel_ReleaseBatch(batch);
+    }
+}
+
+static void Accel_Notify(const AccelBatch* batch) {
+    Event_Put(&motion_queue, EV_MOTION, 0, batch->count, Sched_Millis());
+    Sched_Signal(accel_task);
+}
+
+// Distance sensor: runs when TPM1 captured one or more echoes
+static void Echo_Task(void) {
+    Event ev;
+
+    while (Event_Get(&echo_queue, &ev)) {
+        uint8_t close = (ev.arg & EV_ECHO_CLOSE) != 0;
+        int32_t median;
+
+        distance_mm = RCW_TicksToMm(ev.value, ev.arg & ~EV_ECHO_CLOSE);
+
+        // Median of the last echoes; echoes outside the exact tick
+        // threshold (including 0 = no reading) enter as far away
+        median = Median_Push(&echo_median, close ? distance_mm : ECHO_FAR_MM);
+        close = (median < DISTANCE_THRESHOLD_MM);
+
+        if (KofN_Push(&echo_confirm, close)) {
+            trigger_alarm(LOG_SRC_DISTANCE, distance_mm);
+        }
+    }
+}
+
+// I2C watchdog: a transfer that stops progressing (slave holding the
+// bus, lost interrupt) is aborted at its deadline, as it would otherwise
+// keep I2C_Busy() set - no VLPS, no accelerometer batches. Runs when the
+// bus leaves idle and then at the deadline of the transfer in progress.
+static void I2c_Task(void) {
+    uint32_t left_us = I2C_Expire();
+
+    Sched_SetPeriod(i2c_task, left_us ? (uint16_t)(left_us / 1000 + 1) : SCHED_EVENT_ONLY);
+}
+
+static void I2c_Notify(void) {
+    Sched_Signal(i2c_task);
+}
+
+// Alarm output, ranging and status LEDs, signalled when the alarm state
+// machine changes state
+static void Status_Task(void) {
+    uint8_t out = AlarmFsm_Outputs();
+
+    // Pings are generated by TPM0 while armed, no CPU time per ping
+    if ((out & FSM_OUT_RANGING) && !ranging_on) {
+        // Echoes from before the last disarm must not confirm a new alarm
+        Median_Init(&echo_median, ECHO_FAR_MM);
+        KofN_Reset(&echo_confirm);
+        ranging_on = 1;
+        RCW_Ranging_Start(RANGING_PERIOD_MS);
+    } else if (!(out & FSM_OUT_RANGING) && ranging_on) {
+        ranging_on = 0;
+        RCW_Ranging_Stop();
+    }
+
+    if ((out & FSM_OUT_SIREN) && !siren_on) {
+        siren_on = 1;
+        Power_Hold(POWER_HOLD_SIREN, 1);
+        alarm_enable();
+    } else if (!(out & FSM_OUT_SIREN) && siren_on) {
+        siren_on = 0;
+        alarm_disable();
+        Power_Hold(POWER_HOLD_SIREN, 0);
+    }
+
+    if (out & FSM_OUT_ARMED_LED) {
+        PTB->PDOR &= ~BLUE_MASK;
+    } else {
+        PTB->PDOR |= BLUE_MASK;
+    }
+    if (out & FSM_OUT_ADMIN_LED) {
+        PTB->PDOR &= ~GREEN_MASK;
+    } else {
+        PTB->PDOR |= GREEN_MASK;
+    }
+}
+
+// Event log: commits queued records; sector erases block interrupts, so
+// they wait until the sensors stop ranging and the siren stops
+static void Log_Task(void) {
+    Log_Flush(!siren_on && !(AlarmFsm_Outputs() & FSM_OUT_RANGING));
+}
+
+// Software timers: Timer_Process runs as a task when the TPM0 compare
+// reaches the next expiry, so timer callbacks run in task context
+static void Timer_Notify(void) {
+    Sched_Signal(timer_task);
 }
 
 /*-------------------------------------------------------------------------
  * Main Function
  *-------------------------------------------------------------------------*/
 int main(void) {
+    // Profiler timer must run before the first interrupt is enabled, the
+    // clocks before the first handler time-stamps an event or a driver
+    // waits on a timeout
+    Prof_Init();
+    Sched_Init();
+    Power_Init();
+    Init_TPM0();
+
     // Initialize peripherals
     LED_Init();
     I2C_Init();
     InitInterrupt();
     InitAccelerometer();
     Keyboard_Init();
-    sin_init();
     DAC_Init();
     Init_Trigger_Pin();
+#if RCW_DUAL_EDGE
+    InCap_DualEdge_Init(RCW_PS_INIT);
+#else
     InCap_OutComp_Init();
-    Init_TPM0();
-	
-		tick_head = 1000.0 / SystemCoreClock;  // Clock cycle duration in seconds
-
-    while (1) {
-        // Handle button input
-        if (button_pressed) {
-            handle_password_input(button);
-            button_pressed = 0;
-        }
+#endif
+    RCW_InitScale(SystemCoreClock, DISTANCE_THRESHOLD_MM);  // Echo tick limits per prescaler
+    alarm_disable();
 
-        if (button == 'C') {
-            memset(input_password, 0, MAX_PASSWORD);
-            pass_counter = 0;
-        }
+    // Code table from flash, lookups only ever read the RAM copy
+    Kv_Init();
+    Codes_Init();
+    KeySeq_Reset(&keyseq);
+    Timer_Init(Timer_Notify);
+    entry_timer = Timer_Create(entry_timeout);
+    AlarmFsm_Init(FSM_ARMED, Fsm_Notify);
 
-        // Control alarm state
-        if (alarm) {
-            alarm_enable();
-        } else {
-            alarm_disable();
-        }
-				
-				if (alarm_armed == 1 && alarm == 0) {
-					PTB->PDOR &= ~(1<<10);
-				} else {
-					PTB->PDOR |= (1<<10);
-				}
-				
-
-        // Check accelerometer
-        I2C_ReadReg(0x1d, 0x0, &status);
-        status &= ZYXDR_MASK;
-        if (motion_detected && status) {
-            motion_detected = 0;
-            I2C_ReadRegBlock(0x1d, 0x1, 6, arrayXYZ);
-            
-            // Calculate acceleration values
-            X = ((double)((int16_t)((arrayXYZ[0] << 8) | arrayXYZ[1]) >> 2) / (4096 >> 0));
-            Y = ((double)((int16_t)((arrayXYZ[2] << 8) | arrayXYZ[3]) >> 2) / (4096 >> 0));
-            Z = ((double)((int16_t)((arrayXYZ[4] << 8) | arrayXYZ[5]) >> 2) / (4096 >> 0));
-
-            // Check for motion threshold
-            if (alarm_armed && (fabs(X) > MOTION_THRESHOLD || 
-																fabs(Y) > MOTION_THRESHOLD || 
-																fabs(Z) > MOTION_THRESHOLD)) {
-                alarm = 1;
-            }
-        }
+    // Filters start from a resting reading: no dynamic acceleration,
+    // nothing in range
+    Motion_Init();
+    Median_Init(&motion_median, 0);
+    Vib_Init();
+    Median_Init(&echo_median, ECHO_FAR_MM);
 
-        // Distance sensor monitoring
-        if (alarm_armed) {
-            Start_Measurement();
-            if (measure_ready) {
-                measure_ready = 0;
-                tick = tick_head * ps_value[d];
-                result *= tick;
-                distance = result / 58 * 1000;
-
-                if (distance > 0 && distance < DISTANCE_THRESHOLD) {
-                    alarm = 1;
-                }
-            }
-        }
-    }
+    // Tasks in priority order - event tasks first, periodic tasks last
+    keypad_task  = Sched_AddTask(Keypad_Task, SCHED_EVENT_ONLY);
+    accel_task   = Sched_AddTask(Accel_Task, SCHED_EVENT_ONLY);
+    echo_task    = Sched_AddTask(Echo_Task, SCHED_EVENT_ONLY);
+    timer_task   = Sched_AddTask(Timer_Process, SCHED_EVENT_ONLY);
+    status_task  = Sched_AddTask(Status_Task, SCHED_EVENT_ONLY);
+    i2c_task     = Sched_AddTask(I2c_Task, SCHED_EVENT_ONLY);
+    log_task     = Sched_AddTask(Log_Task, LOG_FLUSH_MS);
+    Log_Init(Sched_Millis());           // Finds the log head, records the boot
+    Accel_SetNotify(Accel_Notify);
+    I2C_SetNotify(I2c_Notify);
+    Sched_Signal(status_task);          // Armed at start-up
+
+    Sched_Run();
 }
\ No newline at end of file
@@ -0,0 +1,91 @@
+/*-------------------------------------------------------------------------
+ * Technika Mikroprocesorowa 2 - Project
+ * Project: Security Alarm System
+ * File: motion.c
+ *
+ * This file implements gravity removal for the motion threshold:
+ * - Calibration: MOTION_CAL_SAMPLES samples at rest averaged into a
+ *   baseline per axis, started when the exit delay ends
+ * - High-pass: the baseline follows slow changes (drift, settling) as a
+ *   first-order low-pass in Q8, the output is the sample minus it
+ * - Squared magnitude of the dynamic vector, compared by the caller
+ *   against MOTION_THRESHOLD_SQ - no square root
+ * Integer only, a handful of adds, shifts and 3 multiplies per sample.
+ *-------------------------------------------------------------------------*/
+
+#include "accelerometer.h"
+#include "motion.h"
+
+/*-------------------------------------------------------------------------
+ * Constants
+ *-------------------------------------------------------------------------*/
+#define BASE_Q          8               // Baseline fraction bits
+
+/*-------------------------------------------------------------------------
+ * Static Variables
+ *-------------------------------------------------------------------------*/
+static int32_t base[3];                 // Resting reading [counts, Q8]
+static int32_t cal_sum[3];              // Calibration sums [counts]
+static uint16_t cal_left;               // Samples still to average, 0 = done
+
+/*-------------------------------------------------------------------------
+ * Function: Motion_Init
+ * Purpose: Forget the baseline and calibrate on the next samples
+ * Parameters: None
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+void Motion_Init(void) {
+    for (uint8_t a = 0; a < 3; a++) {
+        base[a] = 0;
+    }
+    Motion_Calibrate();
+}
+
+/*-------------------------------------------------------------------------
+ * Function: Motion_Calibrate
+ * Purpose: Average the next MOTION_CAL_SAMPLES samples into the baseline,
+ *          nothing is reported meanwhile; call with the sensor at rest
+ * Parameters: None
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+void Motion_Calibrate(void) {
+    for (uint8_t a = 0; a < 3; a++) {
+        cal_sum[a] = 0;
+    }
+    cal_left = MOTION_CAL_SAMPLES;
+}
+
+/*-------------------------------------------------------------------------
+ * Function: Motion_Push
+ * Purpose: Remove the baseline from one sample
+ * Parameters:
+ * x, y, z - raw 14-bit counts
+ * Returns: uint32_t - squared magnitude of the dynamic acceleration
+ *          [counts^2], 0 while calibrating
+ *-------------------------------------------------------------------------*/
+uint32_t Motion_Push(int16_t x, int16_t y, int16_t z) {
+    const int32_t in[3] = { x, y, z };
+    uint32_t mag2 = 0;
+
+    if (cal_left) {
+        for (uint8_t a = 0; a < 3; a++) {
+            cal_sum[a] += in[a];
+        }
+        if (--cal_left == 0) {
+            // Mean in Q8
+            for (uint8_t a = 0; a < 3; a++) {
+                base[a] = cal_sum[a] * (1 << BASE_Q) / MOTION_CAL_SAMPLES;
+            }
+        }
+        return 0;
+    }
+
+    for (uint8_t a = 0; a < 3; a++) {
+        int32_t d = in[a] - (base[a] >> BASE_Q);
+
+        // |d| < 2^15, d * d < 2^30; three of them stay below 2^32
+        mag2 += (uint32_t)(d * d);
+        base[a] += (in[a] * (1 << BASE_Q) - base[a]) >> MOTION_HP_SHIFT;
+    }
+    return mag2;
+}
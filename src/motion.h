@@ -0,0 +1,23 @@
+#ifndef MOTION_H
+#define MOTION_H
+
+#include "hal.h"
+
+/*-------------------------------------------------------------------------
+ * Dynamic acceleration: the resting reading (gravity, mounting tilt) is
+ * averaged once armed and then followed by a first-order high-pass, so
+ * the threshold is the same in every direction and orientation.
+ *-------------------------------------------------------------------------*/
+#define MOTION_THRESHOLD_MG     500     // Dynamic acceleration, any direction
+#define MOTION_CAL_SAMPLES      256     // Averaged at calibration (320 ms), power of two
+#define MOTION_HP_SHIFT         8       // Baseline follows with 1/256 per sample, ~0.5 Hz
+
+// Motion_Push result compared against this, counts^2 (needs accelerometer.h)
+#define MOTION_THRESHOLD_SQ     ((uint32_t)ACCEL_MG_TO_COUNTS(MOTION_THRESHOLD_MG) * \
+                                 (uint32_t)ACCEL_MG_TO_COUNTS(MOTION_THRESHOLD_MG))
+
+void Motion_Init(void);
+void Motion_Calibrate(void);
+uint32_t Motion_Push(int16_t x, int16_t y, int16_t z);
+
+#endif /* MOTION_H */
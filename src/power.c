@@ -0,0 +1,117 @@
+/*-------------------------------------------------------------------------
+ * Technika Mikroprocesorowa 2 - Project
+ * Project: Security Alarm System
+ * File: power.c
+ *
+ * This file implements the low-power idle modes:
+ * - VLPS when no peripheral needs a running clock: the keypad rows and
+ *   the accelerometer INT2 (PORTA) and the LPTMR0 wake-up still raise
+ *   interrupts, through the AWIC, so the LLWU is not needed
+ * - WAIT otherwise (siren, ranging, I2C transfer in progress)
+ * - Residency per mode: WAIT measured with PIT1 (bus clock), VLPS with
+ *   the scheduler clock (LPTMR0), run time is the rest
+ * - The TPM0 microsecond clock is advanced by each VLPS stop
+ *-------------------------------------------------------------------------*/
+
+#include "power.h"
+#include "sched.h"
+#include "i2c.h"
+#include "profile.h"
+#include "TPM.h"
+
+/*-------------------------------------------------------------------------
+ * Constants
+ *-------------------------------------------------------------------------*/
+#define STOPM_VLPS          2           // SMC_PMCTRL stop mode
+// PIT1 runs free and is shared with profile.c and sched.c; the WAIT time
+// is the difference of two reads taken across the sleep
+#define WAIT_CHANNEL        PROF_TIMER_CHANNEL
+
+/*-------------------------------------------------------------------------
+ * Static Variables
+ *-------------------------------------------------------------------------*/
+static volatile uint8_t holds = 0;
+static Power_Stats stats;
+static uint32_t wait_ticks = 0;         // WAIT time below one millisecond [PIT1 ticks]
+static uint32_t ticks_per_ms = 1;
+
+/*-------------------------------------------------------------------------
+ * Function: Power_Init
+ * Purpose: Allow VLPS (PMPROT is write-once after reset)
+ * Parameters: None
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+void Power_Init(void) {
+    uint32_t div = ((SIM->CLKDIV1 & SIM_CLKDIV1_OUTDIV4_MASK) >> SIM_CLKDIV1_OUTDIV4_SHIFT) + 1;
+
+    ticks_per_ms = SystemCoreClock / div / 1000;    // PIT1 runs on the bus clock
+    SMC->PMPROT = SMC_PMPROT_AVLP_MASK;
+    SMC->PMCTRL = (SMC->PMCTRL & ~SMC_PMCTRL_STOPM_MASK) | SMC_PMCTRL_STOPM(STOPM_VLPS);
+}
+
+/*-------------------------------------------------------------------------
+ * Function: Power_Hold
+ * Purpose: Keep the clocks of a peripheral running while idle
+ * Parameters:
+ * hold - POWER_HOLD_xxx
+ * on - 1 while the peripheral is in use
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+void Power_Hold(uint8_t hold, uint8_t on) {
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+    holds = on ? (holds | hold) : (holds & ~hold);
+    __set_PRIMASK(primask);
+}
+
+/*-------------------------------------------------------------------------
+ * Function: Power_Idle
+ * Purpose: Sleep until an interrupt. Called with interrupts masked, the
+ *          wake-up interrupt runs when the caller unmasks them.
+ * Parameters: None
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+void Power_Idle(void) {
+    if (holds == 0 && !I2C_Busy()) {
+        uint32_t start = Sched_Millis();
+        uint32_t stopped;
+
+        SCB->SCR |= SCB_SCR_SLEEPDEEP_MASK;
+        (void)SMC->PMCTRL;              // Mode write completes before WFI
+        HAL_IDLE();
+        SCB->SCR &= ~SCB_SCR_SLEEPDEEP_MASK;
+        stopped = Sched_Millis() - start;
+        TPM0_Resume(stopped * 1000);    // TPM0 had no clock
+        stats.stop_ms += stopped;
+        stats.stop_count++;
+    } else {
+        uint32_t start = PIT->CHANNEL[WAIT_CHANNEL].CVAL;
+
+        HAL_IDLE();
+        wait_ticks += start - PIT->CHANNEL[WAIT_CHANNEL].CVAL;    // Down counter
+        if (wait_ticks >= ticks_per_ms) {
+            stats.wait_ms += wait_ticks / ticks_per_ms;
+            wait_ticks %= ticks_per_ms;
+        }
+        stats.wait_count++;
+    }
+}
+
+/*-------------------------------------------------------------------------
+ * Function: Power_GetStats
+ * Purpose: Get time spent per mode since start-up
+ * Parameters: out - statistics
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+void Power_GetStats(Power_Stats* out) {
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+    *out = stats;
+    out->run_ms = Sched_Millis() - stats.wait_ms - stats.stop_ms;
+    if ((int32_t)out->run_ms < 0) {
+        out->run_ms = 0;                // Rounding of the two sleep clocks
+    }
+    __set_PRIMASK(primask);
+}
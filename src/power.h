@@ -0,0 +1,24 @@
+#ifndef POWER_H
+#define POWER_H
+
+#include "hal.h"
+
+// Reasons to stay out of VLPS: the peripheral needs the bus or FLL clock
+#define POWER_HOLD_SIREN    0x01        // DMA0, PIT0 and DAC0 stream
+#define POWER_HOLD_RANGING  0x02        // TPM0 pings, TPM1 echo capture
+#define POWER_HOLD_TIMER    0x04        // TPM0 compare of the timer wheel
+
+typedef struct {
+    uint32_t run_ms;                    // Core running
+    uint32_t wait_ms;                   // WAIT: core clock gated, bus running
+    uint32_t stop_ms;                   // VLPS: LPO, LPTMR0 and pin wake-up only
+    uint32_t wait_count;                // Entries per mode
+    uint32_t stop_count;
+} Power_Stats;
+
+void Power_Init(void);
+void Power_Hold(uint8_t hold, uint8_t on);
+void Power_Idle(void);
+void Power_GetStats(Power_Stats* out);
+
+#endif /* POWER_H */
@@ -0,0 +1,121 @@
+/*-------------------------------------------------------------------------
+ * Technika Mikroprocesorowa 2 - Project
+ * Project: Security Alarm System
+ * File: profile.c
+ *
+ * This file implements the interrupt execution-time profiler:
+ * - Timestamps from the PIT1 free-running counter (bus clock)
+ * - Per handler count, min/max/mean and a log2 histogram in RAM
+ * - Compiled only with PROFILE_ISR, otherwise the hooks are empty
+ *-------------------------------------------------------------------------*/
+
+#include "profile.h"
+
+#ifdef PROFILE_ISR
+
+#include <string.h>
+
+/*-------------------------------------------------------------------------
+ * Global Variables
+ *-------------------------------------------------------------------------*/
+// Not static: add "prof_stats" to a debugger watch window to read it
+Prof_Stats prof_stats[PROF_COUNT];
+
+static const char* const prof_names[PROF_COUNT] = {
+    "PORTA", "TPM0", "TPM1", "DMA0", "I2C0", "LPTMR0", "main"
+};
+
+/*-------------------------------------------------------------------------
+ * Function: Prof_Init
+ * Purpose: Start the PIT1 counter before the first interrupt is enabled
+ *          and clear the statistics
+ * Parameters: None
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+void Prof_Init(void) {
+    SIM->SCGC6 |= SIM_SCGC6_PIT_MASK;
+    PIT->MCR &= ~PIT_MCR_MDIS_MASK;
+    if (!(PIT->CHANNEL[PROF_TIMER_CHANNEL].TCTRL & PIT_TCTRL_TEN_MASK)) {
+        PIT->CHANNEL[PROF_TIMER_CHANNEL].LDVAL = 0xFFFFFFFF;
+        PIT->CHANNEL[PROF_TIMER_CHANNEL].TCTRL = PIT_TCTRL_TEN_MASK;
+    }
+    Prof_Reset();
+}
+
+/*-------------------------------------------------------------------------
+ * Function: Prof_Record
+ * Purpose: Add one execution time to the statistics. Each id has a single
+ *          writer (its own handler), so no interrupt masking is needed.
+ * Parameters:
+ * id - PROF_xxx
+ * ticks - execution time [PIT1 ticks]
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+void Prof_Record(uint8_t id, uint32_t ticks) {
+    Prof_Stats* s = &prof_stats[id];
+    uint8_t bucket = 0;
+
+    // Position of the highest set bit, no CLZ instruction on the M0+
+    while ((ticks >> bucket) != 0 && bucket < PROF_BUCKETS - 1) {
+        bucket++;
+    }
+    if (s->hist[bucket] != 0xFFFF) {
+        s->hist[bucket]++;
+    }
+    if (s->count == 0 || ticks < s->time_min) {
+        s->time_min = ticks;
+    }
+    if (ticks > s->time_max) {
+        s->time_max = ticks;
+    }
+    s->time_total += ticks;
+    s->count++;
+}
+
+/*-------------------------------------------------------------------------
+ * Function: Prof_Reset
+ * Purpose: Clear all statistics
+ * Parameters: None
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+void Prof_Reset(void) {
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+    memset(prof_stats, 0, sizeof(prof_stats));
+    __set_PRIMASK(primask);
+}
+
+/*-------------------------------------------------------------------------
+ * Function: Prof_Get
+ * Purpose: Get statistics of one handler
+ * Parameters: id - PROF_xxx
+ * Returns: const Prof_Stats* - statistics (times in PIT1 ticks)
+ *-------------------------------------------------------------------------*/
+const Prof_Stats* Prof_Get(uint8_t id) {
+    return &prof_stats[id];
+}
+
+/*-------------------------------------------------------------------------
+ * Function: Prof_Mean
+ * Purpose: Mean execution time of one handler
+ * Parameters: id - PROF_xxx
+ * Returns: uint32_t - mean time [PIT1 ticks], 0 if it never ran
+ *-------------------------------------------------------------------------*/
+uint32_t Prof_Mean(uint8_t id) {
+    const Prof_Stats* s = &prof_stats[id];
+
+    return (s->count != 0) ? (s->time_total / s->count) : 0;
+}
+
+/*-------------------------------------------------------------------------
+ * Function: Prof_Name
+ * Purpose: Short handler name for reports
+ * Parameters: id - PROF_xxx
+ * Returns: const char* - name
+ *-------------------------------------------------------------------------*/
+const char* Prof_Name(uint8_t id) {
+    return (id < PROF_COUNT) ? prof_names[id] : "?";
+}
+
+#endif /* PROFILE_ISR */
@@ -0,0 +1,52 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include "hal.h"
+
+#define PROF_BUCKETS        16          // Histogram bucket n holds [2^(n-1), 2^n) ticks
+#define PROF_TIMER_CHANNEL  1           // PIT1 free-running counter, shared with sched.c
+
+typedef enum {
+    PROF_PORTA = 0,                     // PORTA_IRQHandler (INT2, keypad rows)
+    PROF_TPM0,                          // TPM0_IRQHandler (ping generator)
+    PROF_TPM1,                          // TPM1_IRQHandler (echo capture)
+    PROF_DMA0,                          // DMA0_IRQHandler (siren refill)
+    PROF_I2C0,                          // I2C0_IRQHandler (transfer state machine)
+    PROF_LPTMR0,                        // LPTMR0_IRQHandler (scheduler tick)
+    PROF_MAIN,                          // Scheduler pass that ran a task
+    PROF_COUNT
+} Prof_Id;
+
+typedef struct {
+    uint32_t count;                     // Recorded runs
+    uint32_t time_total;                // Sum of execution times [PIT1 ticks]
+    uint32_t time_min;                  // Shortest execution time [PIT1 ticks]
+    uint32_t time_max;                  // Longest execution time [PIT1 ticks]
+    uint16_t hist[PROF_BUCKETS];        // log2 histogram, saturating
+} Prof_Stats;
+
+/*-------------------------------------------------------------------------
+ * Instrumentation, compiled in with -DPROFILE_ISR. PROF_ENTER must be
+ * the first statement of the measured block and PROF_EXIT the last one;
+ * nested interrupts are included in the time of the preempted handler.
+ *-------------------------------------------------------------------------*/
+#ifdef PROFILE_ISR
+#define PROF_NOW()          (PIT->CHANNEL[PROF_TIMER_CHANNEL].CVAL)
+#define PROF_ENTER(id)      uint32_t prof_start = PROF_NOW()
+#define PROF_EXIT(id)       Prof_Record((id), prof_start - PROF_NOW())   // Down counter
+
+extern Prof_Stats prof_stats[PROF_COUNT];   // Read with the debugger
+
+void Prof_Init(void);
+void Prof_Record(uint8_t id, uint32_t ticks);
+void Prof_Reset(void);
+const Prof_Stats* Prof_Get(uint8_t id);
+uint32_t Prof_Mean(uint8_t id);
+const char* Prof_Name(uint8_t id);
+#else
+#define PROF_ENTER(id)
+#define PROF_EXIT(id)       ((void)0)
+#define Prof_Init()         ((void)0)
+#endif
+
+#endif /* PROFILE_H */
@@ -0,0 +1,326 @@
+/*-------------------------------------------------------------------------
+ * Technika Mikroprocesorowa 2 - Project
+ * Project: Security Alarm System
+ * File: sched.c
+ *
+ * This file implements a cooperative run-to-completion scheduler:
+ * - Millisecond clock read from the free-running LPTMR0 counter (LPO),
+ *   no periodic tick interrupt
+ * - Periodic tasks: before sleeping, the LPTMR0 compare is set to the
+ *   earliest release, so the CPU wakes only when there is work
+ * - Event tasks signalled from interrupt handlers
+ * - Sleep in WAIT or VLPS (power.c) when no task is ready
+ * - Per-task run count and execution time (PIT1 free-running counter)
+ *-------------------------------------------------------------------------*/
+
+#include "sched.h"
+#include "profile.h"
+#include "power.h"
+
+/*-------------------------------------------------------------------------
+ * Constants
+ *-------------------------------------------------------------------------*/
+#define LPTMR_PCS_LPO       1           // LPTMR clock: 1 kHz LPO
+#define STATS_CHANNEL       PROF_TIMER_CHANNEL  // PIT channel used as execution timer
+#define SCHED_IRQ_PRIORITY  2
+#define SCHED_MAX_SLEEP_MS  30000       // Longest wake-up, well inside the 16-bit counter wrap
+
+/*-------------------------------------------------------------------------
+ * Types
+ *-------------------------------------------------------------------------*/
+typedef struct {
+    Sched_TaskFn fn;                    // Task body
+    uint16_t period;                    // Period in ms, SCHED_EVENT_ONLY if none
+    volatile uint8_t signalled;         // Set by Sched_Signal
+    uint32_t next;                      // Next release time [ms]
+    Sched_Stats stats;
+} sched_task_t;
+
+/*-------------------------------------------------------------------------
+ * Static Variables
+ *-------------------------------------------------------------------------*/
+static sched_task_t tasks[SCHED_MAX_TASKS];
+static uint8_t task_count = 0;
+static uint32_t millis = 0;             // Clock at the last counter read [ms]
+static uint16_t last_count = 0;         // LPTMR0 count at that read
+static volatile uint8_t wake_armed = 0; // Compare interrupt enabled
+static uint32_t wake_at;                // ... for this time [ms]
+
+/*-------------------------------------------------------------------------
+ * Function: LPTMR0_IRQHandler
+ * Purpose: Wake-up at a task release. TCF is left set, as CMR can only
+ *          be written while it is; the line stays off until the next
+ *          sleep sets a new compare.
+ * Parameters: None
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+void LPTMR0_IRQHandler(void) {
+    PROF_ENTER(PROF_LPTMR0);
+    NVIC_DisableIRQ(LPTMR0_IRQn);
+    wake_armed = 0;
+    PROF_EXIT(PROF_LPTMR0);
+}
+
+/*-------------------------------------------------------------------------
+ * Function: clock_read
+ * Purpose: Advance the millisecond clock by the counter increments since
+ *          the last read. Interrupts must be masked.
+ * Parameters: None
+ * Returns: uint32_t - current time [ms]
+ *-------------------------------------------------------------------------*/
+static uint32_t clock_read(void) {
+    uint16_t count = HAL_LPTMR_COUNT(LPTMR0);
+
+    millis += (uint16_t)(count - last_count);
+    last_count = count;
+    return millis;
+}
+
+/*-------------------------------------------------------------------------
+ * Function: wake_set
+ * Purpose: Set the LPTMR0 compare for a release. Interrupts must be
+ *          masked and clock_read just called.
+ * Parameters:
+ * now - current time [ms]
+ * wait - time to the release [ms], at least 2
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+static void wake_set(uint32_t now, uint32_t wait) {
+    if (wake_armed) {
+        if ((int32_t)(now + wait - wake_at) >= 0) {
+            return;                     // Set compare comes first
+        }
+        // Moving an armed compare needs a timer restart, which drops the
+        // fraction of the current millisecond. Only happens when a task
+        // gets an earlier release, e.g. the keypad starts scanning.
+        LPTMR0->CSR = 0;
+        LPTMR0->CMR = wait - 1;
+        LPTMR0->CSR = LPTMR_CSR_TFC_MASK | LPTMR_CSR_TIE_MASK;
+        LPTMR0->CSR |= LPTMR_CSR_TEN_MASK;
+        last_count = 0;
+    } else {
+        // TCF is set here. The flag rises when the counter leaves CMR,
+        // CMR is at least one count ahead, so it cannot be passed already.
+        LPTMR0->CMR = (uint16_t)(last_count + wait - 1);
+        HAL_W1C_OR(LPTMR0->CSR, LPTMR_CSR_TCF_MASK);
+    }
+    wake_at = now + wait;
+    wake_armed = 1;
+    NVIC_ClearPendingIRQ(LPTMR0_IRQn);
+    NVIC_EnableIRQ(LPTMR0_IRQn);
+}
+
+/*-------------------------------------------------------------------------
+ * Function: Sched_Init
+ * Purpose: Initialize clock and wake-up timer (LPTMR0) and execution
+ *          timer (PIT1)
+ * Parameters: None
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+void Sched_Init(void) {
+    task_count = 0;
+    millis = 0;
+    last_count = 0;
+
+    // LPTMR0: 1 kHz LPO, no prescaler, free running (TFC). The first
+    // compare at 1 ms releases the flag, later ones are set by wake_set.
+    SIM->SCGC5 |= SIM_SCGC5_LPTMR_MASK;
+    LPTMR0->CSR = 0;
+    LPTMR0->PSR = LPTMR_PSR_PCS(LPTMR_PCS_LPO) | LPTMR_PSR_PBYP_MASK;
+    LPTMR0->CMR = 0;
+    LPTMR0->CSR = LPTMR_CSR_TFC_MASK | LPTMR_CSR_TIE_MASK;
+    NVIC_SetPriority(LPTMR0_IRQn, SCHED_IRQ_PRIORITY);
+    NVIC_ClearPendingIRQ(LPTMR0_IRQn);
+    NVIC_EnableIRQ(LPTMR0_IRQn);
+    wake_at = 1;
+    wake_armed = 1;
+    LPTMR0->CSR |= LPTMR_CSR_TEN_MASK;
+
+    // PIT1: free-running 32-bit down counter on bus clock, left running
+    // if the profiler already started it
+    SIM->SCGC6 |= SIM_SCGC6_PIT_MASK;
+    PIT->MCR &= ~PIT_MCR_MDIS_MASK;
+    if (!(PIT->CHANNEL[STATS_CHANNEL].TCTRL & PIT_TCTRL_TEN_MASK)) {
+        PIT->CHANNEL[STATS_CHANNEL].LDVAL = 0xFFFFFFFF;
+        PIT->CHANNEL[STATS_CHANNEL].TCTRL = PIT_TCTRL_TEN_MASK;
+    }
+}
+
+/*-------------------------------------------------------------------------
+ * Function: Sched_AddTask
+ * Purpose: Register a task. Tasks added first have higher priority.
+ * Parameters:
+ * fn - task body, must run to completion
+ * period_ms - release period or SCHED_EVENT_ONLY
+ * Returns: uint8_t - task id used with Sched_Signal/Sched_SetPeriod
+ *-------------------------------------------------------------------------*/
+uint8_t Sched_AddTask(Sched_TaskFn fn, uint16_t period_ms) {
+    sched_task_t* t;
+
+    if (task_count >= SCHED_MAX_TASKS) {
+        while (1);                      // Static table too small - configuration error
+    }
+    t = &tasks[task_count];
+    t->fn = fn;
+    t->period = period_ms;
+    t->signalled = 0;
+    t->next = Sched_Millis() + period_ms;
+    return task_count++;
+}
+
+/*-------------------------------------------------------------------------
+ * Function: Sched_SetPeriod
+ * Purpose: Change task rate, first release one period from now
+ * Parameters:
+ * id - task id
+ * period_ms - new period or SCHED_EVENT_ONLY
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+void Sched_SetPeriod(uint8_t id, uint16_t period_ms) {
+    tasks[id].next = Sched_Millis() + period_ms;
+    tasks[id].period = period_ms;
+}
+
+/*-------------------------------------------------------------------------
+ * Function: Sched_Signal
+ * Purpose: Make a task ready, callable from interrupt handlers
+ * Parameters: id - task id
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+void Sched_Signal(uint8_t id) {
+    tasks[id].signalled = 1;
+}
+
+/*-------------------------------------------------------------------------
+ * Function: Sched_Millis
+ * Purpose: Get scheduler time, callable from interrupt handlers
+ * Parameters: None
+ * Returns: uint32_t - milliseconds since Sched_Init
+ *-------------------------------------------------------------------------*/
+uint32_t Sched_Millis(void) {
+    uint32_t primask = __get_PRIMASK();
+    uint32_t now;
+
+    __disable_irq();
+    now = clock_read();
+    __set_PRIMASK(primask);
+    return now;
+}
+
+/*-------------------------------------------------------------------------
+ * Function: Sched_GetStats
+ * Purpose: Get run count and execution time of a task
+ * Parameters: id - task id
+ * Returns: const Sched_Stats* - statistics (times in PIT1 ticks)
+ *-------------------------------------------------------------------------*/
+const Sched_Stats* Sched_GetStats(uint8_t id) {
+    return &tasks[id].stats;
+}
+
+/*-------------------------------------------------------------------------
+ * Function: Sched_TicksToUs
+ * Purpose: Convert execution time from PIT1 ticks (bus clock) to us
+ * Parameters: ticks - time in PIT1 ticks
+ * Returns: uint32_t - time in microseconds
+ *-------------------------------------------------------------------------*/
+uint32_t Sched_TicksToUs(uint32_t ticks) {
+    uint32_t div = ((SIM->CLKDIV1 & SIM_CLKDIV1_OUTDIV4_MASK) >> SIM_CLKDIV1_OUTDIV4_SHIFT) + 1;
+    uint32_t bus_mhz = SystemCoreClock / div / 1000000;
+
+    return (bus_mhz != 0) ? (ticks / bus_mhz) : ticks;
+}
+
+/*-------------------------------------------------------------------------
+ * Function: task_ready
+ * Purpose: Check if task is signalled or its period has elapsed
+ * Parameters:
+ * t - task
+ * now - current time [ms]
+ * Returns: uint8_t - 1 if the task should run
+ *-------------------------------------------------------------------------*/
+static uint8_t task_ready(const sched_task_t* t, uint32_t now) {
+    return t->signalled ||
+           (t->period != SCHED_EVENT_ONLY && (int32_t)(now - t->next) >= 0);
+}
+
+/*-------------------------------------------------------------------------
+ * Function: next_release
+ * Purpose: Time to the earliest periodic release
+ * Parameters: now - current time [ms]
+ * Returns: uint32_t - milliseconds, at most SCHED_MAX_SLEEP_MS
+ *-------------------------------------------------------------------------*/
+static uint32_t next_release(uint32_t now) {
+    uint32_t wait = SCHED_MAX_SLEEP_MS;
+
+    for (uint8_t i = 0; i < task_count; i++) {
+        if (tasks[i].period != SCHED_EVENT_ONLY && tasks[i].next - now < wait) {
+            wait = tasks[i].next - now;
+        }
+    }
+    return wait;
+}
+
+/*-------------------------------------------------------------------------
+ * Function: Sched_Run
+ * Purpose: Scheduler loop. Runs the highest priority ready task, then
+ *          rescans from the top. If idle, sleeps until an interrupt or
+ *          the next periodic release.
+ * Parameters: None
+ * Returns: Never
+ *-------------------------------------------------------------------------*/
+void Sched_Run(void) {
+    while (1) {
+        PROF_ENTER(PROF_MAIN);
+        uint32_t now = Sched_Millis();
+        uint8_t i;
+
+        for (i = 0; i < task_count; i++) {
+            sched_task_t* t = &tasks[i];
+            uint32_t start, elapsed;
+
+            if (!task_ready(t, now)) {
+                continue;
+            }
+            t->signalled = 0;
+            if (t->period != SCHED_EVENT_ONLY) {
+                t->next += t->period;
+                if ((int32_t)(now - t->next) >= 0) {
+                    t->next = now + t->period;  // Overrun - skip missed releases
+                }
+            }
+
+            start = PIT->CHANNEL[STATS_CHANNEL].CVAL;
+            t->fn();
+            elapsed = start - PIT->CHANNEL[STATS_CHANNEL].CVAL;  // Down counter
+
+            t->stats.runs++;
+            t->stats.time_total += elapsed;
+            if (elapsed > t->stats.time_max) {
+                t->stats.time_max = elapsed;
+            }
+            PROF_EXIT(PROF_MAIN);
+            break;
+        }
+
+        if (i == task_count) {
+            // Nothing ready - sleep. Interrupts are masked while checking so
+            // that a signal between the check and WFI still wakes the core.
+            // A release in the next millisecond is polled instead, the
+            // compare could be passed while it is being set.
+            __disable_irq();
+            now = clock_read();
+            for (i = 0; i < task_count && !task_ready(&tasks[i], now); i++);
+            if (i == task_count) {
+                uint32_t wait = next_release(now);
+
+                if (wait > 1) {
+                    wake_set(now, wait);
+                    Power_Idle();
+                } else {
+                    HAL_POLL();
+                }
+            }
+            __enable_irq();
+        }
+    }
+}
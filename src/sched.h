@@ -0,0 +1,21 @@
+#include "hal.h"
+
+#define SCHED_MAX_TASKS     8           // Size of the static task table
+#define SCHED_EVENT_ONLY    0           // Period of tasks that run only when signalled
+
+typedef void (*Sched_TaskFn)(void);
+
+typedef struct {
+    uint32_t runs;                      // Completed runs
+    uint32_t time_total;                // Sum of execution times [PIT1 ticks]
+    uint32_t time_max;                  // Longest execution time [PIT1 ticks]
+} Sched_Stats;
+
+void Sched_Init(void);
+uint8_t Sched_AddTask(Sched_TaskFn fn, uint16_t period_ms);
+void Sched_SetPeriod(uint8_t id, uint16_t period_ms);
+void Sched_Signal(uint8_t id);
+uint32_t Sched_Millis(void);
+const Sched_Stats* Sched_GetStats(uint8_t id);
+uint32_t Sched_TicksToUs(uint32_t ticks);
+void Sched_Run(void);
\ No newline at end of file
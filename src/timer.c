@@ -0,0 +1,414 @@
+/*-------------------------------------------------------------------------
+ * Technika Mikroprocesorowa 2 - Project
+ * Project: Security Alarm System
+ * File: timer.c
+ *
+ * This file implements one-shot software timers on a hierarchical
+ * timer wheel:
+ * - Fixed pool of TIMER_MAX nodes, no heap; slots are doubly linked
+ *   lists of pool indices, so start and stop are O(1)
+ * - 3 levels of 32 slots with a 1 ms tick: 32 ms, 1 s and 32 s ranges;
+ *   longer timers wait in the last slot and are re-inserted. A timer
+ *   moves down a level at most twice.
+ * - Time from the TPM0 microsecond clock; TPM0 CH5 compare is set to
+ *   the next tick with work - a level 0 slot holding a timer or the
+ *   cascade of an upper slot - at most TIMER_STEP_MS ahead. Occupied
+ *   slots are found from per-level bitmaps, empty ticks are skipped.
+ * - The compare interrupt only calls the notify function; expiry and
+ *   callbacks run in Timer_Process, from a scheduler task
+ * - All functions are for task context, not for interrupt handlers
+ * - TPM0 has no clock in VLPS, so a running timer holds the CPU in WAIT
+ *-------------------------------------------------------------------------*/
+
+#include "timer.h"
+#include "TPM.h"
+#include "power.h"
+
+/*-------------------------------------------------------------------------
+ * Constants
+ *-------------------------------------------------------------------------*/
+#define TIMER_CH            5           // TPM0 channel, software compare (no pin)
+#define TIMER_STEP_MS       50          // Longest compare distance, below one TPM0 wrap
+#define WHEEL_BITS          5
+#define WHEEL_SIZE          (1u << WHEEL_BITS)
+#define WHEEL_LEVELS        3
+#define WHEEL_SPAN          (1u << (WHEEL_BITS * WHEEL_LEVELS))  // 32768 ms
+#define SLOT_IDLE           0xFF        // Node not on the wheel
+
+/*-------------------------------------------------------------------------
+ * Types
+ *-------------------------------------------------------------------------*/
+typedef struct {
+    uint16_t next;                      // Slot list links, TIMER_NONE at the ends
+    uint16_t prev;
+    uint8_t slot;                       // level * WHEEL_SIZE + index, SLOT_IDLE
+    uint32_t expires;                   // Wheel tick of expiry
+    Timer_Fn fn;
+} Timer_Node;
+
+/*-------------------------------------------------------------------------
+ * Static Variables
+ *-------------------------------------------------------------------------*/
+static Timer_Node nodes[TIMER_MAX];
+static uint16_t slot_head[WHEEL_LEVELS * WHEEL_SIZE];
+static uint32_t occupied[WHEEL_LEVELS];     // Non-empty slots per level
+static uint16_t created = 0;
+static uint16_t pending = 0;                // Timers on the wheel
+static uint32_t wheel_now;                  // Last processed tick [ms]
+static uint32_t wheel_us;                   // Microsecond clock at wheel_now
+static uint32_t armed_at;                   // Tick the compare is set for
+static void (*expiry_notify)(void) = 0;
+
+// Index of the lowest set bit (de Bruijn sequence, the M0+ has no CLZ)
+static const uint8_t debruijn_bit[32] = {
+     0,  1, 28,  2, 29, 14, 24,  3, 30, 22, 20, 15, 25, 17,  4,  8,
+    31, 27, 13, 23, 21, 19, 16,  7, 26, 12, 18,  6, 11,  5, 10,  9
+};
+
+/*-------------------------------------------------------------------------
+ * Function: slot_add
+ * Purpose: Put a timer at the head of a slot list
+ * Parameters:
+ * id - timer
+ * slot - level * WHEEL_SIZE + index
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+static void slot_add(uint16_t id, uint8_t slot) {
+    Timer_Node* t = &nodes[id];
+
+    t->slot = slot;
+    t->prev = TIMER_NONE;
+    t->next = slot_head[slot];
+    if (t->next != TIMER_NONE) {
+        nodes[t->next].prev = id;
+    }
+    slot_head[slot] = id;
+    occupied[slot / WHEEL_SIZE] |= 1u << (slot % WHEEL_SIZE);
+}
+
+/*-------------------------------------------------------------------------
+ * Function: slot_remove
+ * Purpose: Unlink a timer from its slot list
+ * Parameters: id - timer on the wheel
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+static void slot_remove(uint16_t id) {
+    Timer_Node* t = &nodes[id];
+
+    if (t->prev != TIMER_NONE) {
+        nodes[t->prev].next = t->next;
+    } else {
+        slot_head[t->slot] = t->next;
+        if (t->next == TIMER_NONE) {
+            occupied[t->slot / WHEEL_SIZE] &= ~(1u << (t->slot % WHEEL_SIZE));
+        }
+    }
+    if (t->next != TIMER_NONE) {
+        nodes[t->next].prev = t->prev;
+    }
+    t->slot = SLOT_IDLE;
+}
+
+/*-------------------------------------------------------------------------
+ * Function: wheel_insert
+ * Purpose: Put a timer in the slot of its expiry, on the lowest level
+ *          whose range covers it
+ * Parameters: id - timer, expires not before wheel_now
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+static void wheel_insert(uint16_t id) {
+    uint32_t at = nodes[id].expires;
+    uint8_t level = 0;
+
+    if (at - wheel_now >= WHEEL_SPAN) {
+        at = wheel_now + WHEEL_SPAN - 1;    // Re-inserted when its slot cascades
+    }
+    while (at - wheel_now >= (1u << (WHEEL_BITS * (level + 1)))) {
+        level++;
+    }
+    slot_add(id, level * WHEEL_SIZE + ((at >> (WHEEL_BITS * level)) & (WHEEL_SIZE - 1)));
+}
+
+/*-------------------------------------------------------------------------
+ * Function: cascade
+ * Purpose: Move the timers of the current slot of a level down
+ * Parameters: level - 1 or 2
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+static void cascade(uint8_t level) {
+    uint8_t index = (wheel_now >> (WHEEL_BITS * level)) & (WHEEL_SIZE - 1);
+    uint8_t slot = level * WHEEL_SIZE + index;
+    uint16_t id = slot_head[slot];
+
+    slot_head[slot] = TIMER_NONE;
+    occupied[level] &= ~(1u << index);
+    while (id != TIMER_NONE) {
+        uint16_t next = nodes[id].next;
+
+        wheel_insert(id);
+        id = next;
+    }
+}
+
+/*-------------------------------------------------------------------------
+ * Function: slots_ahead
+ * Purpose: Distance to the next non-empty slot after the current one
+ * Parameters:
+ * bits - occupied slots of a level
+ * index - current slot
+ * Returns: uint32_t - 1..WHEEL_SIZE slots
+ *-------------------------------------------------------------------------*/
+static uint32_t slots_ahead(uint32_t bits, uint8_t index) {
+    uint8_t s = (index + 1) & (WHEEL_SIZE - 1);
+
+    if (s) {
+        bits = (bits >> s) | (bits << (WHEEL_SIZE - s));
+    }
+    return debruijn_bit[((bits & -bits) * 0x077CB531u) >> 27] + 1;
+}
+
+/*-------------------------------------------------------------------------
+ * Function: compare_set
+ * Purpose: Program the TPM0 channel (mode changes must be acknowledged
+ *          while the counter runs)
+ * Parameters:
+ * cnsc - channel mode, 0 to disable
+ * at - counter value
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+static void compare_set(uint32_t cnsc, uint16_t at) {
+    TPM0->CONTROLS[TIMER_CH].CnSC = 0;
+    while (TPM0->CONTROLS[TIMER_CH].CnSC & TPM_CnSC_MSA_MASK) HAL_POLL();
+    HAL_W1C(TPM0->STATUS, 1u << TIMER_CH);
+    if (cnsc) {
+        TPM0->CONTROLS[TIMER_CH].CnV = at;
+        TPM0->CONTROLS[TIMER_CH].CnSC = cnsc;
+    }
+}
+
+/*-------------------------------------------------------------------------
+ * Function: next_work
+ * Purpose: Ticks from wheel_now to the next occupied level 0 slot or
+ *          cascade of an occupied upper slot
+ * Parameters: None
+ * Returns: uint32_t - ticks, WHEEL_SPAN if the wheel is empty
+ *-------------------------------------------------------------------------*/
+static uint32_t next_work(void) {
+    uint32_t step = WHEEL_SPAN;
+
+    for (uint8_t level = 0; level < WHEEL_LEVELS; level++) {
+        uint8_t shift = WHEEL_BITS * level;
+        uint32_t ahead;
+
+        if (!occupied[level]) {
+            continue;
+        }
+        ahead = slots_ahead(occupied[level], (wheel_now >> shift) & (WHEEL_SIZE - 1));
+        ahead = (ahead << shift) - (wheel_now & ((1u << shift) - 1));
+        if (ahead < step) {
+            step = ahead;
+        }
+    }
+    return step;
+}
+
+/*-------------------------------------------------------------------------
+ * Function: wheel_arm
+ * Purpose: Set the compare to the next tick with work
+ * Parameters: None
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+static void wheel_arm(void) {
+    uint32_t step = next_work();
+    int32_t left;
+    uint32_t ticks;
+
+    Power_Hold(POWER_HOLD_TIMER, pending != 0);
+    if (pending == 0) {
+        compare_set(0, 0);
+        return;
+    }
+    if (step > TIMER_STEP_MS) {
+        step = TIMER_STEP_MS;
+    }
+    armed_at = wheel_now + step;
+
+    // At least two counts ahead, so the match is not passed while writing
+    left = (int32_t)(wheel_us + step * 1000 - TPM0_Micros());
+    ticks = (left > 0) ? TPM0_UsToTicks(left) : 0;
+    if (ticks < 2) {
+        ticks = 2;
+    }
+    compare_set(TPM_CnSC_MSA_MASK | TPM_CnSC_CHIE_MASK, TPM0->CNT + ticks);
+}
+
+/*-------------------------------------------------------------------------
+ * Function: wheel_sync
+ * Purpose: Catch an empty wheel up with the clock, no slot to visit
+ * Parameters: None
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+static void wheel_sync(void) {
+    uint32_t ticks = (TPM0_Micros() - wheel_us) / 1000;
+
+    wheel_now += ticks;
+    wheel_us += ticks * 1000;
+}
+
+/*-------------------------------------------------------------------------
+ * Function: compare_irq
+ * Purpose: TPM0 channel handler, the wheel is advanced by the task
+ * Parameters: ch - channel
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+static void compare_irq(uint8_t ch) {
+    (void)ch;
+    if (expiry_notify) {
+        expiry_notify();
+    }
+}
+
+/*-------------------------------------------------------------------------
+ * Function: Timer_Init
+ * Purpose: Empty the pool and the wheel, take over the TPM0 channel
+ *          (Init_TPM0 first)
+ * Parameters: notify - called from the interrupt when Timer_Process is due
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+void Timer_Init(void (*notify)(void)) {
+    for (uint8_t s = 0; s < WHEEL_LEVELS * WHEEL_SIZE; s++) {
+        slot_head[s] = TIMER_NONE;
+    }
+    for (uint8_t l = 0; l < WHEEL_LEVELS; l++) {
+        occupied[l] = 0;
+    }
+    created = 0;
+    pending = 0;
+    wheel_now = 0;
+    wheel_us = TPM0_Micros();
+    expiry_notify = notify;
+    compare_set(0, 0);
+    TPM0_SetHandler(TIMER_CH, compare_irq);
+    Power_Hold(POWER_HOLD_TIMER, 0);
+}
+
+/*-------------------------------------------------------------------------
+ * Function: Timer_Create
+ * Purpose: Take a timer from the pool
+ * Parameters: fn - callback, runs in Timer_Process
+ * Returns: uint16_t - timer id, TIMER_NONE if the pool is exhausted
+ *-------------------------------------------------------------------------*/
+uint16_t Timer_Create(Timer_Fn fn) {
+    if (created >= TIMER_MAX) {
+        return TIMER_NONE;
+    }
+    nodes[created].fn = fn;
+    nodes[created].slot = SLOT_IDLE;
+    return created++;
+}
+
+/*-------------------------------------------------------------------------
+ * Function: Timer_Start
+ * Purpose: Start or restart a one-shot timer
+ * Parameters:
+ * id - timer
+ * ms - delay, expires after ms to ms + 1 milliseconds
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+void Timer_Start(uint16_t id, uint32_t ms) {
+    Timer_Node* t = &nodes[id];
+    uint8_t first = (pending == 0);
+
+    if (t->slot != SLOT_IDLE) {
+        slot_remove(id);
+    } else {
+        if (first) {
+            wheel_sync();
+        }
+        pending++;
+    }
+
+    // The wheel may lag the clock until the task runs, count from the
+    // clock; the tick in progress does not count
+    t->expires = wheel_now + (TPM0_Micros() - wheel_us) / 1000 + ms + 1;
+    wheel_insert(id);
+    if (first || (int32_t)(t->expires - armed_at) < 0) {
+        wheel_arm();
+    }
+}
+
+/*-------------------------------------------------------------------------
+ * Function: Timer_Stop
+ * Purpose: Stop a timer, nothing happens if it is not running
+ * Parameters: id - timer
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+void Timer_Stop(uint16_t id) {
+    if (nodes[id].slot == SLOT_IDLE) {
+        return;
+    }
+    slot_remove(id);
+    pending--;
+    if (pending == 0) {
+        wheel_arm();                    // Releases the channel and the hold
+    }
+}
+
+/*-------------------------------------------------------------------------
+ * Function: Timer_Active
+ * Purpose: Check if a timer is running
+ * Parameters: id - timer
+ * Returns: uint8_t - 1 until it expires or is stopped
+ *-------------------------------------------------------------------------*/
+uint8_t Timer_Active(uint16_t id) {
+    return nodes[id].slot != SLOT_IDLE;
+}
+
+/*-------------------------------------------------------------------------
+ * Function: Timer_Process
+ * Purpose: Advance the wheel to the clock and run the callbacks of the
+ *          timers that expired, then set the next compare. Callbacks may
+ *          start and stop timers.
+ * Parameters: None
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+void Timer_Process(void) {
+    for (;;) {
+        uint32_t behind = (TPM0_Micros() - wheel_us) / 1000;
+        uint32_t step;
+
+        if (pending == 0) {
+            wheel_sync();               // Also after a callback restarted the wheel
+            break;
+        }
+        if (behind == 0) {
+            break;
+        }
+
+        // Jump over the ticks without work
+        step = next_work();
+        if (step > behind) {
+            step = behind;
+        }
+        wheel_now += step;
+        wheel_us += step * 1000;
+
+        // Upper levels first, a level 2 timer may land in level 1's slot
+        if ((wheel_now & (WHEEL_SIZE - 1)) == 0) {
+            if (((wheel_now >> WHEEL_BITS) & (WHEEL_SIZE - 1)) == 0) {
+                cascade(2);
+            }
+            cascade(1);
+        }
+
+        // A callback starting the first timer re-syncs wheel_now
+        while (slot_head[wheel_now & (WHEEL_SIZE - 1)] != TIMER_NONE) {
+            uint16_t id = slot_head[wheel_now & (WHEEL_SIZE - 1)];
+
+            slot_remove(id);
+            pending--;
+            nodes[id].fn(id);
+        }
+    }
+    wheel_arm();
+}
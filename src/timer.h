@@ -0,0 +1,20 @@
+#ifndef TIMER_H
+#define TIMER_H
+
+#include "hal.h"
+
+#ifndef TIMER_MAX
+#define TIMER_MAX           8           // Size of the static timer pool
+#endif
+#define TIMER_NONE          0xFFFF      // Timer_Create: pool exhausted
+
+typedef void (*Timer_Fn)(uint16_t id);
+
+void Timer_Init(void (*notify)(void));
+uint16_t Timer_Create(Timer_Fn fn);
+void Timer_Start(uint16_t id, uint32_t ms);
+void Timer_Stop(uint16_t id);
+uint8_t Timer_Active(uint16_t id);
+void Timer_Process(void);
+
+#endif /* TIMER_H */
@@ -0,0 +1,157 @@
+/*-------------------------------------------------------------------------
+ * Technika Mikroprocesorowa 2 - Project
+ * Project: Security Alarm System
+ * File: vibration.c
+ *
+ * This file implements the vibration signature analysis:
+ * - Goertzel filters for 9 DFT bins on each axis, integer only; the
+ *   coefficients 2cos(2 pi k / N) are Q14 constants
+ * - Gravity needs no removal: over a whole window a constant input
+ *   adds nothing to a bin k != 0
+ * - Band energies and the tamper / ambient decision once per window
+ *
+ * Budget: 27 filter updates per sample, each two 32-bit multiplies and
+ * a few adds (~15 cycles on the M0+), about 400 cycles per sample or
+ * 0.8% of the 41.9 MHz core at 800 Hz; the window end adds 27 64-bit
+ * power terms once per 80 ms.
+ *-------------------------------------------------------------------------*/
+
+#include "vibration.h"
+#include "accelerometer.h"
+
+/*-------------------------------------------------------------------------
+ * Constants
+ *-------------------------------------------------------------------------*/
+#define VIB_BINS            (VIB_LOW_BINS + VIB_HIGH_BINS)
+#define VIB_AXES            3
+#define POWER_SHIFT         10          // |X|^2 / (N/2)^2 = amplitude^2 for N = 64
+#define POWER_MAX           ((int32_t)1 << 24)  // Per bin, 1 g amplitude; band sums stay
+                                        // below 2^32 after the ratio multiply
+
+#define MG_SQUARED(mg)      ((uint32_t)ACCEL_MG_TO_COUNTS(mg) * (uint32_t)ACCEL_MG_TO_COUNTS(mg))
+
+// 2cos(2 pi k / 64) in Q14 for k = 2, 3, 4 (low band) and 8, 12, .., 28
+// (high band). State bound: |s| <= N * 8192 / sin(2 pi 2 / 64) < 2^22.
+static const int32_t coeff[VIB_BINS] = {
+    32138, 31357, 30274,
+    23170, 12540, 0, -12540, -23170, -30274
+};
+
+/*-------------------------------------------------------------------------
+ * Static Variables
+ *-------------------------------------------------------------------------*/
+static int32_t s1[VIB_AXES][VIB_BINS];  // Filter states, last two outputs
+static int32_t s2[VIB_AXES][VIB_BINS];
+static uint8_t count;                   // Samples in the current window
+static Vib_Bands bands;
+
+/*-------------------------------------------------------------------------
+ * Function: mul_q14
+ * Purpose: (c * s) >> 14 without a 64-bit product: s is split at bit 14
+ *          so both partial products fit in 32 bits (|c| < 2^15, |s| < 2^22)
+ * Parameters:
+ * c - Q14 coefficient
+ * s - filter state
+ * Returns: int32_t - product, rounded down as the 64-bit one
+ *-------------------------------------------------------------------------*/
+static inline int32_t mul_q14(int32_t c, int32_t s) {
+    return c * (s >> 14) + ((c * (s & 0x3FFF)) >> 14);
+}
+
+/*-------------------------------------------------------------------------
+ * Function: bin_power
+ * Purpose: Squared amplitude of one bin at the end of the window
+ * Parameters:
+ * a - axis
+ * b - bin
+ * Returns: uint32_t - amplitude^2 [counts^2], at most POWER_MAX
+ *-------------------------------------------------------------------------*/
+static uint32_t bin_power(uint8_t a, uint8_t b) {
+    int64_t p1 = s1[a][b];
+    int64_t p2 = s2[a][b];
+    int64_t power = p1 * p1 + p2 * p2 - ((coeff[b] * p1 * p2) >> 14);
+
+    power >>= POWER_SHIFT;
+    return (power < 0) ? 0 : (power > POWER_MAX) ? POWER_MAX : (uint32_t)power;
+}
+
+/*-------------------------------------------------------------------------
+ * Function: Vib_Init
+ * Purpose: Start a new window, band energies zero
+ * Parameters: None
+ * Returns: None
+ *-------------------------------------------------------------------------*/
+void Vib_Init(void) {
+    for (uint8_t a = 0; a < VIB_AXES; a++) {
+        for (uint8_t b = 0; b < VIB_BINS; b++) {
+            s1[a][b] = 0;
+            s2[a][b] = 0;
+        }
+    }
+    count = 0;
+    bands.low = 0;
+    bands.high = 0;
+}
+
+/*-------------------------------------------------------------------------
+ * Function: Vib_Push
+ * Purpose: Add one sample; after the last sample of a window compute the
+ *          band energies and classify the window
+ * Parameters:
+ * x, y, z - raw 14-bit counts
+ * Returns: uint8_t - VIB_NONE, or VIB_DONE with VIB_TAMPER / VIB_AMBIENT
+ *-------------------------------------------------------------------------*/
+uint8_t Vib_Push(int16_t x, int16_t y, int16_t z) {
+    const int32_t in[VIB_AXES] = { x, y, z };
+    uint32_t low = 0, high = 0;
+    uint8_t result = VIB_DONE;
+
+    for (uint8_t a = 0; a < VIB_AXES; a++) {
+        int32_t* p1 = s1[a];
+        int32_t* p2 = s2[a];
+
+        for (uint8_t b = 0; b < VIB_BINS; b++) {
+            int32_t s0 = in[a] + mul_q14(coeff[b], p1[b]) - p2[b];
+
+            p2[b] = p1[b];
+            p1[b] = s0;
+        }
+    }
+    if (++count < VIB_WINDOW) {
+        return VIB_NONE;
+    }
+
+    for (uint8_t a = 0; a < VIB_AXES; a++) {
+        for (uint8_t b = 0; b < VIB_BINS; b++) {
+            if (b < VIB_LOW_BINS) {
+                low += bin_power(a, b);
+            } else {
+                high += bin_power(a, b);
+            }
+            s1[a][b] = 0;
+            s2[a][b] = 0;
+        }
+    }
+    count = 0;
+    bands.low = low;
+    bands.high = high;
+
+    // Per-bin means compared without a division
+    if (high >= MG_SQUARED(VIB_TAMPER_MG) &&
+        high * VIB_LOW_BINS >= low * (VIB_TAMPER_RATIO * VIB_HIGH_BINS)) {
+        result |= VIB_TAMPER;
+    } else if (low >= MG_SQUARED(VIB_AMBIENT_MG)) {
+        result |= VIB_AMBIENT;
+    }
+    return result;
+}
+
+/*-------------------------------------------------------------------------
+ * Function: Vib_Last
+ * Purpose: Get the band energies of the last complete window
+ * Parameters: None
+ * Returns: const Vib_Bands* - band energies
+ *-------------------------------------------------------------------------*/
+const Vib_Bands* Vib_Last(void) {
+    return &bands;
+}
@@ -0,0 +1,39 @@
+#ifndef VIBRATION_H
+#define VIBRATION_H
+
+#include "hal.h"
+
+/*-------------------------------------------------------------------------
+ * Vibration signature of the accelerometer stream: Goertzel bins over
+ * windows of VIB_WINDOW samples at 800 Hz (12.5 Hz per bin), summed over
+ * the three axes into a low band (ambient: traffic, footsteps, machinery)
+ * and a high band (tool contact: prying, drilling, sawing).
+ *-------------------------------------------------------------------------*/
+#define VIB_WINDOW          64          // Samples per window (80 ms)
+#define VIB_LOW_BINS        3           // 25, 37.5, 50 Hz
+#define VIB_HIGH_BINS       6           // 100 .. 350 Hz in 50 Hz steps
+
+// Tamper: high band above VIB_TAMPER_MG and, per bin, VIB_TAMPER_RATIO
+// times the low band. Ambient: low band above VIB_AMBIENT_MG otherwise.
+#define VIB_TAMPER_MG       20          // Amplitude of a single tone
+#define VIB_TAMPER_RATIO    4
+#define VIB_AMBIENT_MG      20
+
+// Vib_Push results
+#define VIB_NONE            0x00        // Window not complete yet
+#define VIB_DONE            0x01        // Window complete, bands updated
+#define VIB_TAMPER          0x02
+#define VIB_AMBIENT         0x04
+
+// Band energies of the last window: sum of squared amplitudes of the
+// bins on all axes [counts^2], a tone of A counts adds A * A
+typedef struct {
+    uint32_t low;
+    uint32_t high;
+} Vib_Bands;
+
+void Vib_Init(void);
+uint8_t Vib_Push(int16_t x, int16_t y, int16_t z);
+const Vib_Bands* Vib_Last(void);
+
+#endif /* VIBRATION_H */